@@ -0,0 +1,368 @@
+// Bars.h
+#ifndef BARS_H
+#define BARS_H
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+
+#include "TickColumns.h"
+
+// intervals in epoch milliseconds, bars line up on multiples of them counted from 1970-01-01 UTC
+const int64_t barSecond = 1000;
+const int64_t barMinute = 60 * barSecond;
+const int64_t barHour = 60 * barMinute;
+const int64_t barDay = 24 * barHour;
+
+// OhlcBar
+// Every tick in [time, time + interval)
+struct OhlcBar {
+    int64_t time;
+
+    int32_t open;
+    int32_t high;
+    int32_t low;
+    int32_t close;
+
+    uint32_t tickCount;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: BarStart
+// Desc: Start of the bar time falls in, rounded down for times before the epoch too
+//---------------------------------------------------------------------------------------------------------------------
+inline int64_t BarStart(int64_t time, int64_t interval) {
+    auto start = time - time % interval;
+    return (start > time) ? start - interval : start;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: BarEnd
+// Desc: Index of the first tick in [begin, end) at or after barEnd. Gallops out from begin before binary searching so
+//       a bar of a handful of ticks costs a handful of compares and a bar of a million costs about 40.
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t BarEnd(const int64_t* time, size_t begin, size_t end, int64_t barEnd) {
+
+    size_t step = 1;
+    auto low = begin;
+    auto high = begin + 1;
+
+    while (high < end && time[high] < barEnd) {
+        low = high;
+        step *= 2;
+        high = std::min(end, begin + step);
+    }
+
+    high = std::min(high, end);
+
+    return std::lower_bound(time + low, time + high, barEnd) - time;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: AggregateOhlcRange
+// Desc: Bars for ticks [begin, end), appended to bars. One pass: each bar finds where it ends in the time column, then
+//       takes the high and low of that run of quotes in a loop with no branches in it, which vectorizes.
+//---------------------------------------------------------------------------------------------------------------------
+void AggregateOhlcRange(const int64_t* time, const int32_t* quote, size_t begin, size_t end, int64_t interval, std::vector<OhlcBar>& bars) {
+
+    auto first = begin;
+
+    while (first < end) {
+
+        OhlcBar bar;
+        bar.time = BarStart(time[first], interval);
+
+        auto last = BarEnd(time, first, end, bar.time + interval);
+
+        auto high = quote[first];
+        auto low = quote[first];
+
+        for (auto i = first + 1; i < last; i++) {
+            high = (quote[i] > high) ? quote[i] : high;
+            low = (quote[i] < low) ? quote[i] : low;
+        }
+
+        bar.open = quote[first];
+        bar.high = high;
+        bar.low = low;
+        bar.close = quote[last - 1];
+        bar.tickCount = static_cast<uint32_t>(last - first);
+
+        bars.push_back(bar);
+
+        first = last;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: MergeBar
+// Desc: Folds later, a bar for the same interval built from ticks after into's, into into
+//---------------------------------------------------------------------------------------------------------------------
+inline void MergeBar(OhlcBar& into, const OhlcBar& later) {
+    into.high = std::max(into.high, later.high);
+    into.low = std::min(into.low, later.low);
+    into.close = later.close;
+    into.tickCount += later.tickCount;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: AggregateOhlc
+// Desc: Buckets count ticks into OHLC bars interval milliseconds wide. Ticks have to be in time order, the way they
+//       are in the tick files. Intervals with no ticks get no bar. The ticks are split into a chunk per thread; a bar
+//       that straddles two chunks comes out of both halves and is merged back into one, so the result is the same
+//       whatever threadCount is.
+//---------------------------------------------------------------------------------------------------------------------
+void AggregateOhlc(const int64_t* time, const int32_t* quote, size_t count, int64_t interval, std::vector<OhlcBar>& bars, unsigned int threadCount = 0) {
+
+    bars.clear();
+
+    if (count == 0 || interval <= 0) {
+        return;
+    }
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // don't bother spinning up threads for tiny chunks
+    const size_t minChunkSize = 1 << 16;
+    auto chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, count / minChunkSize));
+
+    if (chunkCount == 1) {
+        AggregateOhlcRange(time, quote, 0, count, interval, bars);
+        return;
+    }
+
+    std::vector<std::vector<OhlcBar>> chunkBars(chunkCount);
+    std::vector<std::thread> workers;
+
+    auto aggregateChunk = [time, quote, count, interval, chunkCount, &chunkBars] (size_t chunk) {
+        AggregateOhlcRange(time, quote, (count * chunk) / chunkCount, (count * (chunk + 1)) / chunkCount, interval, chunkBars[chunk]);
+    };
+
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        workers.emplace_back(aggregateChunk, chunk);
+    }
+
+    // the calling thread takes the first chunk
+    aggregateChunk(0);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    size_t total = 0;
+    for (auto& chunk : chunkBars) {
+        total += chunk.size();
+    }
+
+    bars.reserve(total);
+
+    for (auto& chunk : chunkBars) {
+
+        auto next = chunk.begin();
+
+        if (!bars.empty() && next != chunk.end() && next->time == bars.back().time) {
+            MergeBar(bars.back(), *next);
+            ++next;
+        }
+
+        bars.insert(bars.end(), next, chunk.end());
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: AggregateOhlc
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------
+void AggregateOhlc(const TickColumns& ticks, int64_t interval, std::vector<OhlcBar>& bars, unsigned int threadCount = 0) {
+    AggregateOhlc(ticks.Time(), ticks.Quote(), ticks.size(), interval, bars, threadCount);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: BarBuilder
+// Desc: Keeps bars up to date as live ticks come in. A tick inside the open bar only touches that bar, a tick past its
+//       end rolls over to a new one, and a late tick updates whichever earlier bar it falls in. Every bar that's
+//       changed since the last ClearDirty is at or after FirstDirty so a plot only has to rebuild those.
+//---------------------------------------------------------------------------------------------------------------------
+class BarBuilder {
+
+    int64_t interval;
+
+    std::vector<OhlcBar> bars;
+
+    // end of the open bar, saves working out which bar every tick falls in
+    int64_t openBarEnd;
+
+    size_t firstDirty;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: BarBuilder
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    BarBuilder(int64_t interval = barMinute) : interval(std::max<int64_t>(1, interval)), openBarEnd(0), firstDirty(0) {}
+
+    int64_t Interval() const { return this->interval; }
+    const std::vector<OhlcBar>& Bars() const { return this->bars; }
+
+    bool IsDirty() const { return this->firstDirty < this->bars.size(); }
+    size_t FirstDirty() const { return this->firstDirty; }
+    void ClearDirty() { this->firstDirty = this->bars.size(); }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Reset
+    // Desc: Drops every bar and starts again at a new interval
+    //-----------------------------------------------------------------------------------------------------------------
+    void Reset(int64_t interval) {
+        this->interval = std::max<int64_t>(1, interval);
+        this->bars.clear();
+        this->openBarEnd = 0;
+        this->firstDirty = 0;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Assign
+    // Desc: Starts from bars already aggregated at this interval, e.g. by AggregateOhlc over the history so far
+    //-----------------------------------------------------------------------------------------------------------------
+    void Assign(const std::vector<OhlcBar>& bars) {
+        this->bars = bars;
+        this->openBarEnd = this->bars.empty() ? 0 : this->bars.back().time + this->interval;
+        this->firstDirty = 0;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Add
+    // Desc: One tick
+    //-----------------------------------------------------------------------------------------------------------------
+    void Add(int64_t time, int32_t quote) {
+
+        if (!this->bars.empty() && time < this->openBarEnd) {
+
+            auto& bar = this->bars.back();
+
+            if (time >= bar.time) {
+                bar.high = std::max(bar.high, quote);
+                bar.low = std::min(bar.low, quote);
+                bar.close = quote;
+                bar.tickCount++;
+
+                this->firstDirty = std::min(this->firstDirty, this->bars.size() - 1);
+                return;
+            }
+
+            this->AddLate(time, quote);
+            return;
+        }
+
+        OhlcBar bar = {BarStart(time, this->interval), quote, quote, quote, quote, 1};
+
+        this->bars.push_back(bar);
+        this->openBarEnd = bar.time + this->interval;
+        this->firstDirty = std::min(this->firstDirty, this->bars.size() - 1);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Add
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void Add(const DateTimePricePair& dateTimePricePair) {
+        this->Add(ToEpochMillis(dateTimePricePair), static_cast<int32_t>(dateTimePricePair.quote));
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Add
+    // Desc: A batch of ticks in time order. The run that lands in the open bar is folded in with the same loop
+    //       AggregateOhlcRange uses and anything after it is aggregated straight onto the end.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Add(const int64_t* time, const int32_t* quote, size_t count) {
+
+        size_t first = 0;
+
+        // late ticks go one at a time, they're rare
+        while (first < count && !this->bars.empty() && time[first] < this->bars.back().time) {
+            this->AddLate(time[first], quote[first]);
+            first++;
+        }
+
+        if (first == count) {
+            return;
+        }
+
+        auto dirty = this->bars.size();
+
+        if (!this->bars.empty() && time[first] < this->openBarEnd) {
+
+            auto last = BarEnd(time, first, count, this->openBarEnd);
+            auto& bar = this->bars.back();
+
+            auto high = bar.high;
+            auto low = bar.low;
+
+            for (auto i = first; i < last; i++) {
+                high = (quote[i] > high) ? quote[i] : high;
+                low = (quote[i] < low) ? quote[i] : low;
+            }
+
+            bar.high = high;
+            bar.low = low;
+            bar.close = quote[last - 1];
+            bar.tickCount += static_cast<uint32_t>(last - first);
+            dirty--;
+
+            first = last;
+        }
+
+        AggregateOhlcRange(time, quote, first, count, this->interval, this->bars);
+
+        this->openBarEnd = this->bars.back().time + this->interval;
+        this->firstDirty = std::min(this->firstDirty, dirty);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Add
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void Add(const DateTimePricePair* ticks, size_t count) {
+
+        std::vector<int64_t> time(count);
+        std::vector<int32_t> quote(count);
+
+        for (size_t i = 0; i < count; i++) {
+            time[i] = ToEpochMillis(ticks[i]);
+            quote[i] = static_cast<int32_t>(ticks[i].quote);
+        }
+
+        this->Add(time.data(), quote.data(), count);
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddLate
+    // Desc: A tick from before the open bar. It can raise a high or lower a low but it isn't the open or the close of
+    //       the bar it lands in, since ticks either side of it have already been seen. A tick in a gap with no bar
+    //       gets one of its own.
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddLate(int64_t time, int32_t quote) {
+
+        auto start = BarStart(time, this->interval);
+
+        auto bar = std::lower_bound(this->bars.begin(), this->bars.end(), start, [] (const OhlcBar& bar, int64_t time) { return bar.time < time; });
+
+        if (bar != this->bars.end() && bar->time == start) {
+            bar->high = std::max(bar->high, quote);
+            bar->low = std::min(bar->low, quote);
+            bar->tickCount++;
+        } else {
+            OhlcBar inserted = {start, quote, quote, quote, quote, 1};
+            bar = this->bars.insert(bar, inserted);
+        }
+
+        this->firstDirty = std::min(this->firstDirty, static_cast<size_t>(bar - this->bars.begin()));
+    }
+};
+
+#endif // BARS_H
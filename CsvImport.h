@@ -1,4 +1,7 @@
 // CsvImport.h
+#ifndef CSVIMPORT_H
+#define CSVIMPORT_H
+
 #include <iterator>
 #include <iostream>
 #include <fstream>
@@ -10,6 +13,25 @@
 #include <chrono>
 #include <ctime>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <functional>
+
+#include "MappedFile.h"
+#include "CsvScan.h"
+
+// size of the block CsvStreamReader reads from the file at a time
+const unsigned int bufferSize = 1 << 16;
+
+// number of comma separated columns per row, we only care about the date (3) and the quote (4)
+const unsigned int numHeaders = 5;
+
+// CsvImportMode
+enum class CsvImportMode {
+    Stream,             // single threaded std::ifstream reads through StreamReadBlock
+    MappedParallel      // memory mapped, newline aligned chunks parsed on every core by MappedReadParallel
+};
 
 // DateTimePricePair
 struct DateTimePricePair {
@@ -71,110 +93,529 @@ void FastParse(const char* str, DateTimePricePair* dateTimePricePair) {
 	}
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FastParseFixed
+// Desc: Parses a "YYYY-MM-DD HH:MM:SS.mmm" timestamp straight out of [begin, end) without copying it or calling
+//       into libc. Returns false and leaves dateTimePricePair alone if the field isn't in exactly that layout.
+//---------------------------------------------------------------------------------------------------------------------
+bool FastParseFixed(const char* begin, const char* end, DateTimePricePair* dateTimePricePair) {
+
+	const char layout[] = "0000-00-00 00:00:00.000";
+
+	if (end - begin != sizeof(layout) - 1) {
+		return false;
+	}
+
+	// every separator has to be where we expect it and every other character has to be a digit. Fold all of the
+	// checks together so there's a single branch at the end
+	unsigned int bad = 0;
+	for (unsigned int i = 0; i < sizeof(layout) - 1; i++) {
+		unsigned int digit = static_cast<unsigned char>(begin[i]) - '0';
+		bad |= (layout[i] == '0') ? (digit > 9) : (begin[i] != layout[i]);
+	}
+
+	if (bad) {
+		return false;
+	}
+
+	auto d = reinterpret_cast<const unsigned char*>(begin);
+
+	dateTimePricePair->year = (d[0] - '0') * 1000 + (d[1] - '0') * 100 + (d[2] - '0') * 10 + (d[3] - '0');
+	dateTimePricePair->month = (d[5] - '0') * 10 + (d[6] - '0');
+	dateTimePricePair->day = (d[8] - '0') * 10 + (d[9] - '0');
+	dateTimePricePair->hour = (d[11] - '0') * 10 + (d[12] - '0');
+	dateTimePricePair->minute = (d[14] - '0') * 10 + (d[15] - '0');
+	dateTimePricePair->second = (d[17] - '0') * 10 + (d[18] - '0');
+	dateTimePricePair->millisec = (d[20] - '0') * 100 + (d[21] - '0') * 10 + (d[22] - '0');
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ParseDateTime
+// Desc: Takes the FastParseFixed path when it can and falls back to FastParse for anything else
+//---------------------------------------------------------------------------------------------------------------------
+void ParseDateTime(const char* begin, const char* end, DateTimePricePair* dateTimePricePair) {
+
+	// a trailing '\r' from a windows line ending doesn't change the layout
+	if (end > begin && end[-1] == '\r') {
+		end--;
+	}
+
+	if (FastParseFixed(begin, end, dateTimePricePair)) {
+		return;
+	}
+
+	// FastParse wants a terminated string and the caller's buffer might be read only
+	char dateStrBuffer[32];
+	auto length = std::min<size_t>(end - begin, sizeof(dateStrBuffer) - 1);
+
+	memcpy(dateStrBuffer, begin, length);
+	dateStrBuffer[length] = 0;
+
+	FastParse(dateStrBuffer, dateTimePricePair);
+}
+
 //----------------------------------------------------------------------------------------------------------
-// Name: StreamReadBlock
-// Desc:
+// Name: ParseQuote
+// Desc: Reads a fixed point quote like "1.23456" as the integer 123456 without copying it out first
 //----------------------------------------------------------------------------------------------------------
-std::vector<DateTimePricePair> StreamReadBlock(std::string& filepath) {
-    
-    std::ifstream filestream(filepath);
+unsigned int ParseQuote(const char* begin, const char* end) {
+    unsigned int quote = 0; 
 
-    if (!filestream.is_open()) {
-        
-        std::cout << "Error opening file."; 
-        return;
-    }
-    std::vector<DateTimePricePair> dateTimePricePairs; 
-    dateTimePricePairs.clear(); 
+    for (auto c = begin; c < end; c++) {
+        if (*c == '.') {
+            continue; 
+        }
 
-    char buffer[bufferSize];
-    memset(buffer, 0, sizeof(buffer));
+        if (*c < '0' || *c > '9') {
+            break; 
+        }
 
-    // We want to ignore the headers so discard characters until the first newline
-    unsigned int offset = 0;
-    while (filestream.get() != '\n') {
-        offset++;
+        quote = (quote * 10) + (*c - '0'); 
     }
 
-    unsigned int bufferOffset = 0; 
-    unsigned int headerCounter = 0; 
+    return quote; 
+}
+
+//----------------------------------------------------------------------------------------------------------
+// Name: CsvStreamReader
+// Desc: Reads a tick csv a block at a time and hands rows out in batches. Memory use is one block no
+//       matter how big the file is. In follow mode reaching the end of the file isn't the end: the next
+//       ReadBatch picks up whatever has been appended since, and a half written last row is held back
+//       until its newline arrives.
+//----------------------------------------------------------------------------------------------------------
+class CsvStreamReader {
+
+    std::ifstream filestream; 
+    std::string filepath; 
+
+    std::vector<char> buffer; 
+    unsigned int bufferEnd;         // number of valid bytes in buffer
+    unsigned int scanIndex;         // next byte to look at for a delimiter
+    unsigned int lastCommaIndex;    // start of the field we're in the middle of
+
+    unsigned int headerCounter; 
+    bool headerSkipped; 
+    bool follow; 
+
+    uint64_t bytesRead; 
 
     DateTimePricePair dateTimePricePair;
-    
-    while (filestream) {
 
-        filestream.read(&buffer[bufferOffset], sizeof(buffer) - bufferOffset);
-        unsigned int lastCommaIndex = 0; 
+public:
 
-        for (auto i = 0; i < sizeof(buffer); i++) {
+    //------------------------------------------------------------------------------------------------------
+    // Name: CsvStreamReader
+    // Desc:
+    //------------------------------------------------------------------------------------------------------
+    CsvStreamReader(bool follow = false, unsigned int blockSize = bufferSize) 
+        : buffer(blockSize), bufferEnd(0), scanIndex(0), lastCommaIndex(0), headerCounter(0), headerSkipped(false), follow(follow), bytesRead(0) {}
 
-            // read until we find a ',' then insert a null terminator
-            if (buffer[i] == ',' || buffer[i] == '\n') {
-                
-                char lastChar = buffer[i];
-                buffer[i] = 0; 
+    //------------------------------------------------------------------------------------------------------
+    // Name: Open
+    // Desc:
+    //------------------------------------------------------------------------------------------------------
+    bool Open(const std::string& filepath) {
+        
+        this->filestream.close(); 
+        this->filestream.clear(); 
+        this->filestream.open(filepath, std::ios::binary); 
+
+        if (!this->filestream.is_open()) {
+            
+            std::cout << "Error opening file " << filepath << "\n"; 
+            return false;
+        }
+
+        this->filepath = filepath; 
+        this->bufferEnd = 0; 
+        this->scanIndex = 0; 
+        this->lastCommaIndex = 0; 
+        this->headerCounter = 0; 
+        this->headerSkipped = false; 
+        this->bytesRead = 0; 
+
+        return true; 
+    }
 
-                if (headerCounter == 3) {
-                    FastParse(&buffer[lastCommaIndex], &dateTimePricePair); 
+    //------------------------------------------------------------------------------------------------------
+    // Name: ReadBatch
+    // Desc: Appends up to maxRows rows onto batch and returns how many were added. Returns 0 once there's
+    //       nothing more to read right now; in follow mode a later call may find more.
+    //------------------------------------------------------------------------------------------------------
+    size_t ReadBatch(std::vector<DateTimePricePair>& batch, size_t maxRows) {
 
-                } else if (headerCounter == 4) {
+        size_t rowCount = 0; 
 
-                    // do this to avoid constructing an std::string
-                    char bidStrBuffer[32];
-                    unsigned int counter = lastCommaIndex; 
-                    unsigned int copyCounter = 0; 
+        while (rowCount < maxRows) {
 
-                    while (buffer[counter]) {
-                        if (buffer[counter] != '.') {
-                            bidStrBuffer[copyCounter] = buffer[counter]; 
-                            copyCounter++; 
-                        }
+            auto bufferBegin = this->buffer.data(); 
+            auto bufferEnd = bufferBegin + this->bufferEnd; 
 
-                        counter++; 
-                    }
+            for (auto delimiter = FindDelimiter(bufferBegin + this->scanIndex, bufferEnd); delimiter < bufferEnd && rowCount < maxRows; 
+                delimiter = FindDelimiter(delimiter + 1, bufferEnd)) {
 
-                    bidStrBuffer[copyCounter] = 0; 
+                unsigned int i = delimiter - bufferBegin; 
+                char lastChar = this->buffer[i];
 
-                    dateTimePricePair.quote = std::atoi(bidStrBuffer);
-                    dateTimePricePairs.push_back(dateTimePricePair);
+                this->scanIndex = i + 1; 
+
+                // We want to ignore the headers so discard everything up to the first newline
+                if (!this->headerSkipped) {
+                    this->headerSkipped = (lastChar == '\n'); 
+                    this->lastCommaIndex = i + 1; 
+                    continue; 
+                }
+
+                if (this->headerCounter == 3) {
+                    ParseDateTime(&this->buffer[this->lastCommaIndex], &this->buffer[i], &this->dateTimePricePair); 
+
+                } else if (this->headerCounter == 4) {
+
+                    this->dateTimePricePair.quote = ParseQuote(&this->buffer[this->lastCommaIndex], &this->buffer[i]);
+                    batch.push_back(this->dateTimePricePair);
+                    rowCount++; 
                 }
 
-                if (headerCounter >= (numHeaders - 1) || lastChar == '\n') {
-                    headerCounter = 0;
+                if (this->headerCounter >= (numHeaders - 1) || lastChar == '\n') {
+                    this->headerCounter = 0;
 
                 } else {
 
-                    headerCounter++;
+                    this->headerCounter++;
                 }
 
-                lastCommaIndex = i + 1; // plus one because we want the element after
+                this->lastCommaIndex = i + 1; // plus one because we want the element after
             }
-            // we're at the last element
-            else {
-                
-                if (i == sizeof(buffer) - 1) {
 
-                    // copy the remaining characters back to the beginning of the buffer
-                    memcpy(buffer, &buffer[lastCommaIndex], i - lastCommaIndex + 1);
-                    bufferOffset = i - lastCommaIndex + 1; 
+            if (rowCount >= maxRows) {
+                break; 
+            }
 
-                    lastCommaIndex = 0; 
+            if (!this->Refill()) {
+                
+                // the last row might not end with a newline, but when following it might just not be finished yet
+                if (!this->follow) {
+                    rowCount += this->FlushLastRow(batch); 
                 }
+
+                break; 
             }
+        }
+
+        return rowCount; 
+    }
+
+    //------------------------------------------------------------------------------------------------------
+    // Name: WasTruncated
+    // Desc: True if the file is now shorter than what we've already read, i.e. it was rotated or rewritten
+    //------------------------------------------------------------------------------------------------------
+    bool WasTruncated() const {
+        std::ifstream sizeStream(this->filepath, std::ios::binary | std::ios::ate); 
+        return sizeStream.is_open() && static_cast<uint64_t>(sizeStream.tellg()) < this->bytesRead; 
+    }
+
+    const std::string& Filepath() const { return this->filepath; }
+
+private:
+
+    //------------------------------------------------------------------------------------------------------
+    // Name: Refill
+    // Desc: Copies the partial field at the end back to the beginning of the buffer and reads more after
+    //       it. Returns false if nothing new could be read.
+    //------------------------------------------------------------------------------------------------------
+    bool Refill() {
+
+        auto carry = this->bufferEnd - this->lastCommaIndex; 
 
+        if (carry == this->buffer.size()) {
+            std::cout << "Field longer than read buffer."; 
+            
+            // drop it, we'd never make progress otherwise
+            carry = 0; 
         }
+
+        memmove(this->buffer.data(), &this->buffer[this->bufferEnd - carry], carry);
+
+        this->bufferEnd = carry; 
+        this->scanIndex = carry; 
+        this->lastCommaIndex = 0; 
+
+        // a previous read might have hit the end of the file, clear that so we can see if it's grown since
+        this->filestream.clear(); 
+        this->filestream.read(&this->buffer[this->bufferEnd], this->buffer.size() - this->bufferEnd);
+        
+        auto count = static_cast<unsigned int>(this->filestream.gcount()); 
+        
+        this->bufferEnd += count; 
+        this->bytesRead += count; 
+
+        return count > 0; 
+    }
+
+    //------------------------------------------------------------------------------------------------------
+    // Name: FlushLastRow
+    // Desc:
+    //------------------------------------------------------------------------------------------------------
+    size_t FlushLastRow(std::vector<DateTimePricePair>& batch) {
+
+        if (this->headerSkipped && this->headerCounter == 4 && this->bufferEnd > this->lastCommaIndex) {
+            
+            this->dateTimePricePair.quote = ParseQuote(&this->buffer[this->lastCommaIndex], &this->buffer[this->bufferEnd]);
+            batch.push_back(this->dateTimePricePair);
+
+            this->lastCommaIndex = this->bufferEnd; 
+            this->headerCounter = 0; 
+            return 1; 
+        }
+
+        return 0; 
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------
+// Name: StreamReadBlock
+// Desc:
+//----------------------------------------------------------------------------------------------------------
+std::vector<DateTimePricePair> StreamReadBlock(std::string& filepath) {
+    
+    CsvStreamReader reader; 
+
+    if (!reader.Open(filepath)) {
+        return {};
     }
 
-    filestream.close();
+    std::vector<DateTimePricePair> dateTimePricePairs; 
+    reader.ReadBatch(dateTimePricePairs, std::numeric_limits<size_t>::max()); 
 
     return dateTimePricePairs; 
 }
+
+//----------------------------------------------------------------------------------------------------------
+// Name: StreamCsv
+// Desc: Reads the file in batches of batchSize rows and hands each batch to callback. Return false from
+//       the callback to stop early. Only one batch is ever held in memory.
+//----------------------------------------------------------------------------------------------------------
+bool StreamCsv(const std::string& filepath, size_t batchSize, std::function<bool(const std::vector<DateTimePricePair>& batch)> callback) {
+
+    CsvStreamReader reader; 
+
+    if (!reader.Open(filepath)) {
+        return false; 
+    }
+
+    std::vector<DateTimePricePair> batch; 
+    batch.reserve(batchSize); 
+
+    while (reader.ReadBatch(batch, batchSize) > 0) {
+
+        if (!callback(batch)) {
+            break; 
+        }
+
+        batch.clear(); 
+    }
+
+    return true; 
+}
+
+//----------------------------------------------------------------------------------------------------------
+// Name: FollowCsv
+// Desc: Like StreamCsv but keeps going after the end of the file, polling every pollIntervalMs for rows
+//       appended since. Starts over from the top if the file is truncated. Runs until stop is set or the
+//       callback returns false.
+//----------------------------------------------------------------------------------------------------------
+bool FollowCsv(
+    const std::string& filepath, 
+    size_t batchSize, 
+    unsigned int pollIntervalMs, 
+    const std::atomic<bool>& stop, 
+    std::function<bool(const std::vector<DateTimePricePair>& batch)> callback) {
+
+    CsvStreamReader reader(true); 
+
+    if (!reader.Open(filepath)) {
+        return false; 
+    }
+
+    std::vector<DateTimePricePair> batch; 
+    batch.reserve(batchSize); 
+
+    while (!stop) {
+
+        if (reader.ReadBatch(batch, batchSize) > 0) {
+            
+            if (!callback(batch)) {
+                break; 
+            }
+
+            batch.clear(); 
+            continue; 
+        }
+
+        if (reader.WasTruncated() && !reader.Open(filepath)) {
+            return false; 
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(pollIntervalMs)); 
+    }
+
+    return true; 
+}
+
+//----------------------------------------------------------------------------------------------------------
+// Name: ParseCsvChunk
+// Desc: Parses every row in [begin, end) and push_back's them onto rows. begin must point at the start of
+//       a row. Rows are laid out the same way StreamReadBlock expects them.
+//----------------------------------------------------------------------------------------------------------
+template <typename Rows>
+void ParseCsvChunk(const char* begin, const char* end, Rows& rows) {
+    
+    DateTimePricePair dateTimePricePair;
+    
+    auto fieldBegin = begin; 
+    unsigned int headerCounter = 0; 
+
+    while (fieldBegin < end) {
+        
+        auto fieldEnd = FindDelimiter(fieldBegin, end); 
+
+        if (headerCounter == 3) {
+            ParseDateTime(fieldBegin, fieldEnd, &dateTimePricePair);
+
+        } else if (headerCounter == 4) {
+            
+            dateTimePricePair.quote = ParseQuote(fieldBegin, fieldEnd); 
+            rows.push_back(dateTimePricePair); 
+        }
+
+        if (headerCounter >= (numHeaders - 1) || fieldEnd == end || *fieldEnd == '\n') {
+            headerCounter = 0;
+
+        } else {
+
+            headerCounter++;
+        }
+
+        fieldBegin = fieldEnd + 1; 
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------
+// Name: AppendRows
+// Desc: Moves every row in src onto the end of dst
+//----------------------------------------------------------------------------------------------------------
+void AppendRows(std::vector<DateTimePricePair>& dst, std::vector<DateTimePricePair>& src) {
+    dst.insert(dst.end(), src.begin(), src.end()); 
+}
+
+//----------------------------------------------------------------------------------------------------------
+// Name: MappedReadParallel
+// Desc: Maps the file, splits it into newline aligned chunks and parses them on every core. The results
+//       are merged back together in file order so the output matches StreamReadBlock. Rows can be any
+//       container with reserve, push_back(DateTimePricePair), size and an AppendRows overload.
+//----------------------------------------------------------------------------------------------------------
+template <typename Rows = std::vector<DateTimePricePair>>
+Rows MappedReadParallel(std::string& filepath, unsigned int threadCount = 0) {
+
+    MappedFile file; 
+
+    if (!file.Open(filepath)) {
+        return Rows(); 
+    }
+
+    auto begin = file.Data(); 
+    auto end = file.Data() + file.Size(); 
+
+    // We want to ignore the headers so skip to the first newline
+    auto firstRow = (begin != nullptr) ? static_cast<const char*>(memchr(begin, '\n', end - begin)) : nullptr; 
+
+    if (firstRow == nullptr) {
+        return Rows(); 
+    }
+
+    firstRow++; 
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency()); 
+    }
+
+    // don't bother spinning up threads for tiny chunks
+    const size_t minChunkSize = 1 << 16; 
+    auto dataSize = static_cast<size_t>(end - firstRow); 
+    auto chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, dataSize / minChunkSize)); 
+
+    // move each chunk boundary forward to the start of the next row 
+    std::vector<const char*> boundaries(chunkCount + 1); 
+    boundaries[0] = firstRow; 
+    boundaries[chunkCount] = end; 
+
+    for (size_t i = 1; i < chunkCount; i++) {
+        
+        auto boundary = std::max(firstRow + (dataSize / chunkCount) * i, boundaries[i - 1]);
+        auto newline = static_cast<const char*>(memchr(boundary, '\n', end - boundary)); 
+        
+        boundaries[i] = (newline != nullptr) ? newline + 1 : end; 
+    }
+
+    // estimate the row count from the first row so each chunk only allocates once
+    auto firstRowEnd = static_cast<const char*>(memchr(firstRow, '\n', end - firstRow)); 
+    auto rowLength = (firstRowEnd != nullptr) ? static_cast<size_t>(firstRowEnd - firstRow) + 1 : dataSize; 
+
+    std::vector<Rows> chunkResults(chunkCount); 
+    std::vector<std::thread> workers; 
+
+    auto parseChunk = [&boundaries, &chunkResults, rowLength] (size_t chunk) {
+        
+        auto chunkSize = static_cast<size_t>(boundaries[chunk + 1] - boundaries[chunk]); 
+        
+        chunkResults[chunk].reserve(chunkSize / std::max<size_t>(rowLength, 1) + 16); 
+        ParseCsvChunk(boundaries[chunk], boundaries[chunk + 1], chunkResults[chunk]); 
+    };
+
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        workers.emplace_back(parseChunk, chunk); 
+    }
+
+    // the calling thread takes the first chunk
+    parseChunk(0); 
+
+    for (auto& worker : workers) {
+        worker.join(); 
+    }
+
+    if (chunkCount == 1) {
+        return std::move(chunkResults[0]); 
+    }
+
+    size_t total = 0; 
+    for (auto& chunkResult : chunkResults) {
+        total += chunkResult.size(); 
+    }
+
+    Rows rows; 
+    rows.reserve(total); 
+
+    for (auto& chunkResult : chunkResults) {
+        AppendRows(rows, chunkResult); 
+    }
+
+    return rows; 
+}
     
 //----------------------------------------------------------------------------------------------------------
-// Name: StreamReadBlock
+// Name: ImportCsv
 // Desc:
 //----------------------------------------------------------------------------------------------------------
-std::vector<DateTimePricePair> ImportCsv(std::string& filepath) {
+std::vector<DateTimePricePair> ImportCsv(std::string& filepath, CsvImportMode mode = CsvImportMode::Stream) {
+    
+    if (mode == CsvImportMode::MappedParallel) {
+        return MappedReadParallel(filepath); 
+    }
+
     auto csv = StreamReadBlock(filepath); 
     return csv; 
-}
\ No newline at end of file
+}
+
+#endif // CSVIMPORT_H
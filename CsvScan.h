@@ -0,0 +1,120 @@
+// CsvScan.h
+#ifndef CSVSCAN_H
+#define CSVSCAN_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CSVSCAN_X86
+#endif
+
+// FindDelimiterFunc
+typedef const char* (*FindDelimiterFunc)(const char* begin, const char* end);
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FindDelimiterScalar
+// Desc: Returns the first ',' or '\n' in [begin, end), or end if there isn't one
+//---------------------------------------------------------------------------------------------------------------------
+const char* FindDelimiterScalar(const char* begin, const char* end) {
+
+    for (auto c = begin; c < end; c++) {
+        if (*c == ',' || *c == '\n') {
+            return c;
+        }
+    }
+
+    return end;
+}
+
+#ifdef CSVSCAN_X86
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FindDelimiterSSE2
+// Desc: Same as FindDelimiterScalar, 16 bytes at a time
+//---------------------------------------------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+const char* FindDelimiterSSE2(const char* begin, const char* end) {
+
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    auto c = begin;
+
+    for (; c + 16 <= end; c += 16) {
+
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+        auto matches = _mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline));
+        auto mask = static_cast<unsigned int>(_mm_movemask_epi8(matches));
+
+        if (mask != 0) {
+            return c + __builtin_ctz(mask);
+        }
+    }
+
+    return FindDelimiterScalar(c, end);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FindDelimiterAVX2
+// Desc: Same as FindDelimiterScalar, 32 bytes at a time
+//---------------------------------------------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+const char* FindDelimiterAVX2(const char* begin, const char* end) {
+
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    auto c = begin;
+
+    for (; c + 32 <= end; c += 32) {
+
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+        auto matches = _mm256_or_si256(_mm256_cmpeq_epi8(block, comma), _mm256_cmpeq_epi8(block, newline));
+        auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(matches));
+
+        if (mask != 0) {
+            return c + __builtin_ctz(mask);
+        }
+    }
+
+    // the tail call skips the vzeroupper the compiler puts before a ret, and legacy SSE code after dirty upper halves
+    // runs several times slower for the rest of the program
+    _mm256_zeroupper();
+
+    return FindDelimiterSSE2(c, end);
+}
+
+#endif // CSVSCAN_X86
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SelectFindDelimiter
+// Desc: Picks the widest FindDelimiter the cpu we're running on supports
+//---------------------------------------------------------------------------------------------------------------------
+FindDelimiterFunc SelectFindDelimiter() {
+#ifdef CSVSCAN_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return FindDelimiterAVX2;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return FindDelimiterSSE2;
+    }
+#endif
+
+    return FindDelimiterScalar;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FindDelimiter
+// Desc: Returns the first ',' or '\n' in [begin, end), or end if there isn't one
+//---------------------------------------------------------------------------------------------------------------------
+inline const char* FindDelimiter(const char* begin, const char* end) {
+    static const FindDelimiterFunc findDelimiter = SelectFindDelimiter();
+    return findDelimiter(begin, end);
+}
+
+#endif // CSVSCAN_H
@@ -0,0 +1,282 @@
+// Decimation.h
+#ifndef DECIMATION_H
+#define DECIMATION_H
+
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DECIMATION_SSE2
+#endif
+
+// M4Column
+// The four values that decide what a pixel column looks like when a line is drawn through every sample in it
+struct M4Column {
+    double first;
+    double min;
+    double max;
+    double last;
+};
+
+// below this many samples per thread DecimateM4 doesn't bother splitting the columns up, starting a thread costs
+// about as much as scanning them
+const size_t decimateChunkSize = 1 << 18;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: M4ColumnStart
+// Desc: Index of the first sample that lands in column when count samples are spread over width columns
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t M4ColumnStart(size_t column, size_t count, size_t width) {
+    return static_cast<size_t>((static_cast<unsigned long long>(column) * count) / width);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SampleRange
+// Desc: Folds yData[begin, end) into min/max, which the caller seeds. Plain doubles, floats and int32s go through the
+//       SSE2 overloads below, anything else yData[i] works on comes through here.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Samples>
+inline void SampleRange(const Samples& yData, size_t begin, size_t end, double& min, double& max) {
+
+    auto low = min;
+    auto high = max;
+
+    for (auto i = begin; i < end; i++) {
+        double value = yData[i];
+        low = (value < low) ? value : low;
+        high = (value > high) ? value : high;
+    }
+
+    min = low;
+    max = high;
+}
+
+#ifdef DECIMATION_SSE2
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SampleRange
+// Desc: Four doubles per iteration in two pairs of accumulators so the min/max latency chains overlap. _mm_min_pd
+//       keeps the accumulator when a sample is NaN, same as the scalar loop.
+//---------------------------------------------------------------------------------------------------------------------
+inline void SampleRange(const double* yData, size_t begin, size_t end, double& min, double& max) {
+
+    auto i = begin;
+
+    if (end - begin >= 8) {
+
+        auto min0 = _mm_set1_pd(min);
+        auto max0 = _mm_set1_pd(max);
+        auto min1 = min0;
+        auto max1 = max0;
+
+        for (; i + 4 <= end; i += 4) {
+            auto a = _mm_loadu_pd(yData + i);
+            auto b = _mm_loadu_pd(yData + i + 2);
+
+            min0 = _mm_min_pd(a, min0);
+            max0 = _mm_max_pd(a, max0);
+            min1 = _mm_min_pd(b, min1);
+            max1 = _mm_max_pd(b, max1);
+        }
+
+        double lanes[2];
+
+        _mm_storeu_pd(lanes, _mm_min_pd(min0, min1));
+        min = std::min(lanes[0], lanes[1]);
+
+        _mm_storeu_pd(lanes, _mm_max_pd(max0, max1));
+        max = std::max(lanes[0], lanes[1]);
+    }
+
+    SampleRange<const double*>(yData, i, end, min, max);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SampleRange
+// Desc: Eight floats per iteration, widened once at the end
+//---------------------------------------------------------------------------------------------------------------------
+inline void SampleRange(const float* yData, size_t begin, size_t end, double& min, double& max) {
+
+    auto i = begin;
+
+    if (end - begin >= 16) {
+
+        // seeded from the first sample rather than min/max so a seed outside float's range can't overflow
+        auto min0 = _mm_set1_ps(yData[i]);
+        auto max0 = min0;
+        auto min1 = min0;
+        auto max1 = min0;
+
+        for (; i + 8 <= end; i += 8) {
+            auto a = _mm_loadu_ps(yData + i);
+            auto b = _mm_loadu_ps(yData + i + 4);
+
+            min0 = _mm_min_ps(a, min0);
+            max0 = _mm_max_ps(a, max0);
+            min1 = _mm_min_ps(b, min1);
+            max1 = _mm_max_ps(b, max1);
+        }
+
+        float lanes[4];
+
+        _mm_storeu_ps(lanes, _mm_min_ps(min0, min1));
+        min = std::min<double>(min, std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3])));
+
+        _mm_storeu_ps(lanes, _mm_max_ps(max0, max1));
+        max = std::max<double>(max, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+    }
+
+    SampleRange<const float*>(yData, i, end, min, max);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SampleRange
+// Desc: Four int32s per iteration. SSE2 has no integer min/max so it's a compare and a masked select.
+//---------------------------------------------------------------------------------------------------------------------
+inline void SampleRange(const int32_t* yData, size_t begin, size_t end, double& min, double& max) {
+
+    auto i = begin;
+
+    if (end - begin >= 8) {
+
+        auto low = _mm_set1_epi32(yData[i]);
+        auto high = low;
+
+        for (; i + 4 <= end; i += 4) {
+            auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yData + i));
+
+            auto below = _mm_cmplt_epi32(value, low);
+            auto above = _mm_cmpgt_epi32(value, high);
+
+            low = _mm_or_si128(_mm_and_si128(below, value), _mm_andnot_si128(below, low));
+            high = _mm_or_si128(_mm_and_si128(above, value), _mm_andnot_si128(above, high));
+        }
+
+        int32_t lows[4];
+        int32_t highs[4];
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lows), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(highs), high);
+
+        min = std::min<double>(min, *std::min_element(lows, lows + 4));
+        max = std::max<double>(max, *std::max_element(highs, highs + 4));
+    }
+
+    SampleRange<const int32_t*>(yData, i, end, min, max);
+}
+
+// non-const pointers would otherwise pick the generic template
+inline void SampleRange(double* yData, size_t begin, size_t end, double& min, double& max) { SampleRange(static_cast<const double*>(yData), begin, end, min, max); }
+inline void SampleRange(float* yData, size_t begin, size_t end, double& min, double& max) { SampleRange(static_cast<const float*>(yData), begin, end, min, max); }
+inline void SampleRange(int32_t* yData, size_t begin, size_t end, double& min, double& max) { SampleRange(static_cast<const int32_t*>(yData), begin, end, min, max); }
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: DecimateM4Columns
+// Desc: Columns [firstColumn, lastColumn) of DecimateM4
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Samples>
+void DecimateM4Columns(const Samples& yData, size_t count, size_t width, size_t firstColumn, size_t lastColumn, M4Column* columns) {
+
+    for (auto column = firstColumn; column < lastColumn; column++) {
+
+        auto start = M4ColumnStart(column, count, width);
+        auto end = M4ColumnStart(column + 1, count, width);
+
+        double first = yData[start];
+        double min = first;
+        double max = first;
+
+        SampleRange(yData, start + 1, end, min, max);
+
+        columns[column].first = first;
+        columns[column].min = min;
+        columns[column].max = max;
+        columns[column].last = yData[end - 1];
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: DecimateM4ChunkCount
+// Desc: How many column chunks DecimateM4 splits count samples over with threadCount threads, 1 when the series is too
+//       small for threads to pay for themselves
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t DecimateM4ChunkCount(size_t count, size_t width, unsigned int threadCount) {
+    return std::max<size_t>(1, std::min<size_t>(std::min<size_t>(threadCount, width), count / decimateChunkSize));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: DecimateM4
+// Desc: Reduces count samples to width columns of first/min/max/last. Drawing a vertical line from min to max in each
+//       column and joining each column's first to the previous column's last gives the same pixels as drawing every
+//       sample, for O(width) draw calls. Expects count >= width. yData is a double* or anything else yData[i] works
+//       on and gives a number, e.g. a StridedSamples over someone else's buffer. It's the one pass over every sample
+//       a plot makes, so big series are split by column across pool's threads. Allocates nothing once columns is
+//       width long, so it's the one to call every frame.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Samples>
+void DecimateM4(const Samples& yData, size_t count, size_t width, std::vector<M4Column>& columns, ThreadPool& pool) {
+
+    columns.resize(width);
+
+    auto chunkCount = DecimateM4ChunkCount(count, width, pool.ThreadCount());
+    auto output = columns.data();
+
+    pool.ParallelFor(chunkCount, [&yData, count, width, chunkCount, output] (size_t chunk) {
+        DecimateM4Columns(yData, count, width, (width * chunk) / chunkCount, (width * (chunk + 1)) / chunkCount, output);
+    });
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: DecimateM4
+// Desc: As above over threadCount threads (0 for one per core) started for this call, for one off decimation with no
+//       pool to hand. Anything that decimates every frame should keep a ThreadPool and pass that instead.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Samples>
+void DecimateM4(const Samples& yData, size_t count, size_t width, std::vector<M4Column>& columns, unsigned int threadCount = 0) {
+
+    columns.resize(width);
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    auto chunkCount = DecimateM4ChunkCount(count, width, threadCount);
+    auto output = columns.data();
+
+    std::vector<std::thread> workers;
+
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        workers.emplace_back([yData, count, width, chunk, chunkCount, output] () {
+            DecimateM4Columns(yData, count, width, (width * chunk) / chunkCount, (width * (chunk + 1)) / chunkCount, output);
+        });
+    }
+
+    DecimateM4Columns(yData, count, width, 0, width / chunkCount, output);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: M4ColumnsRange
+// Desc: min/max over every column, which is the exact range of the samples they came from
+//---------------------------------------------------------------------------------------------------------------------
+inline void M4ColumnsRange(const std::vector<M4Column>& columns, double& min, double& max) {
+
+    min = columns[0].min;
+    max = columns[0].max;
+
+    for (auto& column : columns) {
+        min = std::min(min, column.min);
+        max = std::max(max, column.max);
+    }
+}
+
+#endif // DECIMATION_H
@@ -0,0 +1,572 @@
+// FontCache.h
+#ifndef FONTCACHE_H
+#define FONTCACHE_H
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "SDL.h"
+#include "SDL_ttf.h"
+
+#include "RenderBatch.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: TtfMutex
+// Desc: SDL_ttf shares one FreeType library between every font so nothing in it is safe to call from two threads at
+//       once. Everything in here that touches a TTF_Font holds this.
+//---------------------------------------------------------------------------------------------------------------------
+std::recursive_mutex& TtfMutex() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FontCacheMap
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------
+std::map<std::pair<std::string, unsigned int>, TTF_Font*>& FontCacheMap() {
+    static std::map<std::pair<std::string, unsigned int>, TTF_Font*> fonts;
+    return fonts;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GetFont
+// Desc: Opens each (font file, size) once per process and hands the same TTF_Font back after that. Don't close it,
+//       ClearFontCache does that. Failed opens aren't cached so a missing font can turn up later.
+//---------------------------------------------------------------------------------------------------------------------
+TTF_Font* GetFont(const std::string& fontName, unsigned int size) {
+
+    std::lock_guard<std::recursive_mutex> lock(TtfMutex());
+
+    auto& fonts = FontCacheMap();
+    auto key = std::make_pair(fontName, size);
+    auto found = fonts.find(key);
+
+    if (found != fonts.end()) {
+        return found->second;
+    }
+
+    auto font = TTF_OpenFont(fontName.c_str(), size);
+
+    if (font == nullptr) {
+        std::cout << "TTF_OpenFont failed: " << TTF_GetError() << "\n";
+        return nullptr;
+    }
+
+    fonts[key] = font;
+    return font;
+}
+
+// GlyphInfo
+struct GlyphInfo {
+    SDL_Rect source;    // where the glyph is in the atlas
+    int advance;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GlyphAtlas
+// Desc: Every printable ascii glyph of one font/size rendered once, white, into a single texture. Text is then quads
+//       out of that texture tinted by vertex color, so a frame full of labels is one SDL_RenderGeometry call instead
+//       of a rasterize + texture upload per label.
+//---------------------------------------------------------------------------------------------------------------------
+class GlyphAtlas {
+
+    static const int firstGlyph = 32;
+    static const int lastGlyph = 126;
+    static const int atlasWidth = 512;
+
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+
+    int textureWidth;
+    int textureHeight;
+    int lineHeight;
+
+    GlyphInfo glyphs[lastGlyph - firstGlyph + 1];
+
+#ifdef RENDERBATCH_GEOMETRY
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+#endif
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: GlyphAtlas
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    GlyphAtlas(SDL_Renderer* renderer, TTF_Font* font) : renderer(renderer), texture(nullptr), textureWidth(0), textureHeight(0), lineHeight(0) {
+
+        memset(this->glyphs, 0, sizeof(this->glyphs));
+
+        if (font == nullptr) {
+            return;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(TtfMutex());
+
+        SDL_Color white = {0xff, 0xff, 0xff, 0xff};
+        SDL_Surface* glyphSurfaces[lastGlyph - firstGlyph + 1];
+
+        this->lineHeight = TTF_FontHeight(font);
+
+        // shelf pack the glyphs left to right, top to bottom
+        int x = 0;
+        int y = 0;
+        int shelfHeight = 0;
+
+        for (auto glyph = firstGlyph; glyph <= lastGlyph; glyph++) {
+
+            auto& info = this->glyphs[glyph - firstGlyph];
+            auto surface = TTF_RenderGlyph_Blended(font, glyph, white);
+
+            glyphSurfaces[glyph - firstGlyph] = surface;
+
+            TTF_GlyphMetrics(font, glyph, nullptr, nullptr, nullptr, nullptr, &info.advance);
+
+            if (surface == nullptr) {
+                continue;
+            }
+
+            if (x + surface->w > atlasWidth) {
+                x = 0;
+                y += shelfHeight + 1;
+                shelfHeight = 0;
+            }
+
+            info.source.x = x;
+            info.source.y = y;
+            info.source.w = surface->w;
+            info.source.h = surface->h;
+
+            x += surface->w + 1;
+            shelfHeight = std::max(shelfHeight, surface->h);
+        }
+
+        this->textureWidth = atlasWidth;
+        this->textureHeight = y + shelfHeight;
+
+        auto atlasSurface = SDL_CreateRGBSurface(0, this->textureWidth, std::max(1, this->textureHeight), 32, rmaskAtlas(), gmaskAtlas(), bmaskAtlas(), amaskAtlas());
+
+        for (auto glyph = firstGlyph; glyph <= lastGlyph; glyph++) {
+
+            auto surface = glyphSurfaces[glyph - firstGlyph];
+
+            if (surface == nullptr) {
+                continue;
+            }
+
+            if (atlasSurface != nullptr) {
+                // copy the alpha across rather than blending it onto nothing
+                SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+                SDL_BlitSurface(surface, nullptr, atlasSurface, &this->glyphs[glyph - firstGlyph].source);
+            }
+
+            SDL_FreeSurface(surface);
+        }
+
+        if (atlasSurface == nullptr) {
+            std::cout << "SDL_CreateRGBSurface failed\n";
+            return;
+        }
+
+        this->texture = SDL_CreateTextureFromSurface(renderer, atlasSurface);
+        PROFILE_COUNT(ProfileCounter::TextureUploads, 1);
+        SDL_SetTextureBlendMode(this->texture, SDL_BLENDMODE_BLEND);
+
+        SDL_FreeSurface(atlasSurface);
+    }
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ~GlyphAtlas
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    ~GlyphAtlas() {
+        SDL_DestroyTexture(this->texture);
+    }
+
+    SDL_Texture* Texture() const { return this->texture; }
+    int LineHeight() const { return this->lineHeight; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: MeasureText
+    // Desc: Width in pixels text would take up at scale 1
+    //-----------------------------------------------------------------------------------------------------------------
+    int MeasureText(const char* text) const {
+
+        int width = 0;
+
+        for (auto c = *text; c != '\0'; c = *++text) {
+            if (c >= firstGlyph && c <= lastGlyph) {
+                width += this->glyphs[c - firstGlyph].advance;
+            }
+        }
+
+        return width;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddText
+    // Desc: Queues text with its top left corner at (x, y). scale stretches it, 1 is the size the atlas was built at.
+    //       Nothing is drawn until Flush, unless SDL is too old for SDL_RenderGeometry in which case each glyph is
+    //       copied right away.
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddText(float x, float y, const char* text, SDL_Color color, float scale = 1.0f) {
+
+        if (this->texture == nullptr) {
+            return;
+        }
+
+#ifndef RENDERBATCH_GEOMETRY
+        SDL_SetTextureColorMod(this->texture, color.r, color.g, color.b);
+#endif
+
+        for (auto c = *text; c != '\0'; c = *++text) {
+
+            if (c < firstGlyph || c > lastGlyph) {
+                continue;
+            }
+
+            auto& glyph = this->glyphs[c - firstGlyph];
+
+            if (glyph.source.w > 0) {
+                this->AddQuad(x, y, glyph.source, color, scale);
+            }
+
+            x += glyph.advance * scale;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Flush
+    // Desc: Draws everything queued by AddText in one call
+    //-----------------------------------------------------------------------------------------------------------------
+    void Flush() {
+#ifdef RENDERBATCH_GEOMETRY
+        if (!this->indices.empty()) {
+            SDL_RenderGeometry(this->renderer, this->texture, this->vertices.data(), static_cast<int>(this->vertices.size()), this->indices.data(), static_cast<int>(this->indices.size()));
+            PROFILE_COUNT(ProfileCounter::DrawCalls, 1);
+            PROFILE_COUNT(ProfileCounter::Vertices, this->indices.size());
+        }
+
+        this->vertices.clear();
+        this->indices.clear();
+#endif
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddQuad
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddQuad(float x, float y, const SDL_Rect& source, SDL_Color color, float scale) {
+
+        auto w = source.w * scale;
+        auto h = source.h * scale;
+
+#ifdef RENDERBATCH_GEOMETRY
+        auto u1 = (float) source.x / this->textureWidth;
+        auto v1 = (float) source.y / this->textureHeight;
+        auto u2 = (float) (source.x + source.w) / this->textureWidth;
+        auto v2 = (float) (source.y + source.h) / this->textureHeight;
+
+        auto base = static_cast<int>(this->vertices.size());
+
+        SDL_Vertex quad[4];
+        quad[0].position.x = x;     quad[0].position.y = y;     quad[0].tex_coord.x = u1; quad[0].tex_coord.y = v1;
+        quad[1].position.x = x + w; quad[1].position.y = y;     quad[1].tex_coord.x = u2; quad[1].tex_coord.y = v1;
+        quad[2].position.x = x + w; quad[2].position.y = y + h; quad[2].tex_coord.x = u2; quad[2].tex_coord.y = v2;
+        quad[3].position.x = x;     quad[3].position.y = y + h; quad[3].tex_coord.x = u1; quad[3].tex_coord.y = v2;
+
+        for (auto& vertex : quad) {
+            vertex.color = color;
+            this->vertices.push_back(vertex);
+        }
+
+        const int quadIndices[] = {0, 1, 2, 0, 2, 3};
+
+        for (auto index : quadIndices) {
+            this->indices.push_back(base + index);
+        }
+#else
+        SDL_Rect dest = {(int) x, (int) y, (int) w, (int) h};
+        SDL_RenderCopy(this->renderer, this->texture, &source, &dest);
+#endif
+    }
+
+    // same byte layout as the masks in PlotUtility.h, repeated here so this header stands on its own
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    static uint32_t rmaskAtlas() { return 0xff000000; }
+    static uint32_t gmaskAtlas() { return 0x00ff0000; }
+    static uint32_t bmaskAtlas() { return 0x0000ff00; }
+    static uint32_t amaskAtlas() { return 0x000000ff; }
+#else
+    static uint32_t rmaskAtlas() { return 0x000000ff; }
+    static uint32_t gmaskAtlas() { return 0x0000ff00; }
+    static uint32_t bmaskAtlas() { return 0x00ff0000; }
+    static uint32_t amaskAtlas() { return 0xff000000; }
+#endif
+};
+
+// GlyphMask
+struct GlyphMask {
+    int width;
+    int height;
+    int advance;
+
+    // width * height coverage values, 0 to 255
+    std::vector<uint8_t> coverage;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GlyphMasks
+// Desc: GlyphAtlas for a PixelCanvas: the same printable ascii glyphs but kept as 8 bit coverage bitmaps in memory
+//       instead of a texture, so they can be drawn without a renderer.
+//---------------------------------------------------------------------------------------------------------------------
+class GlyphMasks {
+
+    static const int firstGlyph = 32;
+    static const int lastGlyph = 126;
+
+    GlyphMask glyphs[lastGlyph - firstGlyph + 1];
+    int lineHeight;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: GlyphMasks
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    GlyphMasks(TTF_Font* font) : lineHeight(0) {
+
+        for (auto& glyph : this->glyphs) {
+            glyph.width = 0;
+            glyph.height = 0;
+            glyph.advance = 0;
+        }
+
+        if (font == nullptr) {
+            return;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(TtfMutex());
+
+        SDL_Color white = {0xff, 0xff, 0xff, 0xff};
+        this->lineHeight = TTF_FontHeight(font);
+
+        for (auto c = firstGlyph; c <= lastGlyph; c++) {
+
+            auto& glyph = this->glyphs[c - firstGlyph];
+            TTF_GlyphMetrics(font, c, nullptr, nullptr, nullptr, nullptr, &glyph.advance);
+
+            // blended glyphs are 32 bit with the coverage in alpha
+            auto surface = TTF_RenderGlyph_Blended(font, c, white);
+
+            if (surface == nullptr) {
+                continue;
+            }
+
+            glyph.width = surface->w;
+            glyph.height = surface->h;
+            glyph.coverage.resize(static_cast<size_t>(surface->w) * surface->h);
+
+            SDL_LockSurface(surface);
+
+            for (auto y = 0; y < surface->h; y++) {
+
+                auto row = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch);
+
+                for (auto x = 0; x < surface->w; x++) {
+                    glyph.coverage[y * surface->w + x] = static_cast<uint8_t>((row[x] & surface->format->Amask) >> surface->format->Ashift);
+                }
+            }
+
+            SDL_UnlockSurface(surface);
+            SDL_FreeSurface(surface);
+        }
+    }
+
+    GlyphMasks(const GlyphMasks&) = delete;
+    GlyphMasks& operator=(const GlyphMasks&) = delete;
+
+    int LineHeight() const { return this->lineHeight; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: MeasureText
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    int MeasureText(const char* text) const {
+
+        int width = 0;
+
+        for (auto c = *text; c != '\0'; c = *++text) {
+            if (c >= firstGlyph && c <= lastGlyph) {
+                width += this->glyphs[c - firstGlyph].advance;
+            }
+        }
+
+        return width;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddText
+    // Desc: Records text on canvas with its top left corner at (x, y) in color (0xRRGGBBAA). rotateLeft runs it
+    //       bottom to top with (x, y) as the top left of the rotated block. The masks are referenced, not copied, so
+    //       render the canvas before ClearFontCache.
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddText(PixelCanvas& canvas, int x, int y, const char* text, uint32_t color, bool rotateLeft = false) const {
+
+        auto packed = PackCanvasColor(color >> 24, (color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff);
+
+        // rotated, the pen starts at the bottom and moves up
+        auto pen = rotateLeft ? y + this->MeasureText(text) : x;
+
+        for (auto c = *text; c != '\0'; c = *++text) {
+
+            if (c < firstGlyph || c > lastGlyph) {
+                continue;
+            }
+
+            auto& glyph = this->glyphs[c - firstGlyph];
+
+            if (rotateLeft) {
+                pen -= glyph.advance;
+
+                if (glyph.width > 0) {
+                    canvas.DrawMask(glyph.coverage.data(), glyph.width, glyph.height, glyph.width, x, pen + glyph.advance - glyph.width, packed, true);
+                }
+            } else {
+                if (glyph.width > 0) {
+                    canvas.DrawMask(glyph.coverage.data(), glyph.width, glyph.height, glyph.width, pen, y, packed);
+                }
+
+                pen += glyph.advance;
+            }
+        }
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GlyphMasksMap
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------
+std::map<std::pair<std::string, unsigned int>, std::unique_ptr<GlyphMasks>>& GlyphMasksMap() {
+    static std::map<std::pair<std::string, unsigned int>, std::unique_ptr<GlyphMasks>> masks;
+    return masks;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GetGlyphMasks
+// Desc: One set per (font file, size), they live as long as the font cache
+//---------------------------------------------------------------------------------------------------------------------
+GlyphMasks* GetGlyphMasks(const std::string& fontName, unsigned int size) {
+
+    std::lock_guard<std::recursive_mutex> lock(TtfMutex());
+
+    auto& masks = GlyphMasksMap();
+    auto key = std::make_pair(fontName, size);
+    auto found = masks.find(key);
+
+    if (found != masks.end()) {
+        return found->second.get();
+    }
+
+    auto font = GetFont(fontName, size);
+
+    if (font == nullptr) {
+        return nullptr;
+    }
+
+    auto& glyphs = masks[key];
+    glyphs.reset(new GlyphMasks(font));
+
+    return glyphs.get();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GlyphAtlasMap
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------
+std::map<std::tuple<SDL_Renderer*, std::string, unsigned int>, std::unique_ptr<GlyphAtlas>>& GlyphAtlasMap() {
+    static std::map<std::tuple<SDL_Renderer*, std::string, unsigned int>, std::unique_ptr<GlyphAtlas>> atlases;
+    return atlases;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GetGlyphAtlas
+// Desc: One atlas per (renderer, font file, size), built the first time it's asked for. Textures belong to a
+//       renderer so call ClearGlyphAtlases before destroying one.
+//---------------------------------------------------------------------------------------------------------------------
+GlyphAtlas* GetGlyphAtlas(SDL_Renderer* renderer, const std::string& fontName, unsigned int size) {
+
+    std::lock_guard<std::recursive_mutex> lock(TtfMutex());
+
+    auto& atlases = GlyphAtlasMap();
+    auto key = std::make_tuple(renderer, fontName, size);
+    auto found = atlases.find(key);
+
+    if (found != atlases.end()) {
+        return found->second.get();
+    }
+
+    auto font = GetFont(fontName, size);
+
+    if (font == nullptr) {
+        return nullptr;
+    }
+
+    auto& atlas = atlases[key];
+    atlas.reset(new GlyphAtlas(renderer, font));
+
+    return atlas.get();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ClearGlyphAtlases
+// Desc: Drops every atlas made for renderer
+//---------------------------------------------------------------------------------------------------------------------
+void ClearGlyphAtlases(SDL_Renderer* renderer) {
+
+    std::lock_guard<std::recursive_mutex> lock(TtfMutex());
+
+    auto& atlases = GlyphAtlasMap();
+
+    for (auto atlas = atlases.begin(); atlas != atlases.end(); ) {
+        if (std::get<0>(atlas->first) == renderer) {
+            atlas = atlases.erase(atlas);
+        } else {
+            atlas++;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ClearFontCache
+// Desc: Closes every cached font and drops every atlas and mask. Call before TTF_Quit.
+//---------------------------------------------------------------------------------------------------------------------
+void ClearFontCache() {
+
+    std::lock_guard<std::recursive_mutex> lock(TtfMutex());
+
+    GlyphAtlasMap().clear();
+    GlyphMasksMap().clear();
+
+    for (auto& font : FontCacheMap()) {
+        TTF_CloseFont(font.second);
+    }
+
+    FontCacheMap().clear();
+}
+
+#endif // FONTCACHE_H
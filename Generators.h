@@ -0,0 +1,807 @@
+// Generators.h
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <iostream>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "Bars.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GENERATORS_SSE2
+#endif
+
+// samples are generated this many at a time, each chunk from its own counters, so the output only depends on the
+// seed and not on how many threads made it
+const size_t generatorChunk = 1 << 16;
+
+// normals are worked out this many pairs at a time, small enough for the scratch to stay on the stack
+const size_t normalBlock = 128;
+
+// the 64 bit golden ratio, which steps the counters so consecutive ones differ in every bit
+const uint64_t goldenGamma = 0x9e3779b97f4a7c15ull;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: MixBits
+// Desc: SplitMix64's finalizer, every input bit flips about half the output bits
+//---------------------------------------------------------------------------------------------------------------------
+inline uint64_t MixBits(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: CounterRng
+// Desc: Random bits as a function of (seed, stream, counter) rather than a state that has to be stepped through, so
+//       any sample can be made on any thread without generating the ones before it. It's SplitMix64 started at a key
+//       mixed from the seed and stream, which is fine for test data but no good for anything secret.
+//---------------------------------------------------------------------------------------------------------------------
+class CounterRng {
+
+    uint64_t key;
+
+public:
+
+    CounterRng(uint64_t seed = 0, uint64_t stream = 0) : key(MixBits(MixBits(seed) + stream * goldenGamma)) {}
+
+    uint64_t Bits(uint64_t counter) const {
+        return MixBits(this->key + (counter + 1) * goldenGamma);
+    }
+
+    // [0, 1) in steps of 2^-53
+    double Uniform(uint64_t counter) const {
+        return static_cast<double>(this->Bits(counter) >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+// log(2) split so e * ln2High is exact for any double's exponent
+const double ln2High = 6.93147180369123816490e-01;
+const double ln2Low = 1.90821492927058770002e-10;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GeneratorLog
+// Desc: log(x) for a positive normal x to about an ulp, without a call to the C library so it vectorizes. x is split
+//       into 2^e * m with m in [sqrt(0.5), sqrt(2)) and log(m) comes from the series in s = (m - 1) / (m + 1). The
+//       SSE2 version does the same operations in the same order so both give the same bits.
+//---------------------------------------------------------------------------------------------------------------------
+inline double GeneratorLog(double x) {
+
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+
+    auto e = static_cast<double>(static_cast<int32_t>(bits >> 52) - 1023);
+
+    bits = (bits & 0x000fffffffffffffull) | 0x3ff0000000000000ull;
+
+    double m;
+    memcpy(&m, &bits, sizeof(m));
+
+    if (m > 1.41421356237309504880) {
+        m *= 0.5;
+        e += 1.0;
+    }
+
+    auto s = (m - 1.0) / (m + 1.0);
+    auto s2 = s * s;
+
+    auto p = 2.0 / 19.0;
+    p = 2.0 / 17.0 + s2 * p;
+    p = 2.0 / 15.0 + s2 * p;
+    p = 2.0 / 13.0 + s2 * p;
+    p = 2.0 / 11.0 + s2 * p;
+    p = 2.0 / 9.0 + s2 * p;
+    p = 2.0 / 7.0 + s2 * p;
+    p = 2.0 / 5.0 + s2 * p;
+    p = 2.0 / 3.0 + s2 * p;
+
+    return e * ln2High + (s * (2.0 + s2 * p) + e * ln2Low);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GeneratorSinCos
+// Desc: sin and cos of a turn, i.e. of 2 pi turn, for turn in [0, 1). The turn is cut into quarters and the
+//       polynomials only ever see [-pi/4, pi/4], the quarter picks which one is which and their signs.
+//---------------------------------------------------------------------------------------------------------------------
+inline void GeneratorSinCos(double turn, double& sine, double& cosine) {
+
+    auto t = turn * 4.0;
+    auto quarter = static_cast<int32_t>(t + 0.5);
+
+    auto a = (t - static_cast<double>(quarter)) * 1.57079632679489661923;
+    auto a2 = a * a;
+
+    auto s = a * (1.0 + a2 * (-1.0 / 6.0 + a2 * (1.0 / 120.0 + a2 * (-1.0 / 5040.0 + a2 * (1.0 / 362880.0 +
+        a2 * (-1.0 / 39916800.0 + a2 * (1.0 / 6227020800.0 + a2 * (-1.0 / 1307674368000.0))))))));
+    auto c = 1.0 + a2 * (-1.0 / 2.0 + a2 * (1.0 / 24.0 + a2 * (-1.0 / 720.0 + a2 * (1.0 / 40320.0 + a2 * (-1.0 / 3628800.0 +
+        a2 * (1.0 / 479001600.0 + a2 * (-1.0 / 87178291200.0 + a2 * (1.0 / 20922789888000.0))))))));
+
+    auto x = (quarter & 1) ? s : c;
+    auto y = (quarter & 1) ? c : s;
+
+    cosine = ((quarter + 1) & 2) ? -x : x;
+    sine = (quarter & 2) ? -y : y;
+}
+
+#ifdef GENERATORS_SSE2
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GeneratorLog2
+// Desc: GeneratorLog on both lanes
+//---------------------------------------------------------------------------------------------------------------------
+inline __m128d GeneratorLog2(__m128d x) {
+
+    auto one = _mm_set1_pd(1.0);
+    auto bits = _mm_castpd_si128(x);
+
+    // the exponents sit in the low half of each 64 bit lane, move them together to convert them
+    auto exponent = _mm_shuffle_epi32(_mm_srli_epi64(bits, 52), _MM_SHUFFLE(3, 3, 2, 0));
+    auto e = _mm_cvtepi32_pd(_mm_sub_epi32(exponent, _mm_set1_epi32(1023)));
+
+    auto mantissa = _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000fffffffffffffll)), _mm_set1_epi64x(0x3ff0000000000000ll));
+    auto m = _mm_castsi128_pd(mantissa);
+
+    auto big = _mm_cmpgt_pd(m, _mm_set1_pd(1.41421356237309504880));
+    m = _mm_mul_pd(m, _mm_or_pd(_mm_and_pd(big, _mm_set1_pd(0.5)), _mm_andnot_pd(big, one)));
+    e = _mm_add_pd(e, _mm_and_pd(big, one));
+
+    auto s = _mm_div_pd(_mm_sub_pd(m, one), _mm_add_pd(m, one));
+    auto s2 = _mm_mul_pd(s, s);
+
+    auto p = _mm_set1_pd(2.0 / 19.0);
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 17.0), _mm_mul_pd(s2, p));
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 15.0), _mm_mul_pd(s2, p));
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 13.0), _mm_mul_pd(s2, p));
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 11.0), _mm_mul_pd(s2, p));
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 9.0), _mm_mul_pd(s2, p));
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 7.0), _mm_mul_pd(s2, p));
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 5.0), _mm_mul_pd(s2, p));
+    p = _mm_add_pd(_mm_set1_pd(2.0 / 3.0), _mm_mul_pd(s2, p));
+
+    auto logM = _mm_mul_pd(s, _mm_add_pd(_mm_set1_pd(2.0), _mm_mul_pd(s2, p)));
+
+    return _mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(ln2High)), _mm_add_pd(logM, _mm_mul_pd(e, _mm_set1_pd(ln2Low))));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GeneratorSinCos2
+// Desc: GeneratorSinCos on both lanes
+//---------------------------------------------------------------------------------------------------------------------
+inline void GeneratorSinCos2(__m128d turn, __m128d& sine, __m128d& cosine) {
+
+    auto t = _mm_mul_pd(turn, _mm_set1_pd(4.0));
+    auto quarter = _mm_cvttpd_epi32(_mm_add_pd(t, _mm_set1_pd(0.5)));
+
+    auto a = _mm_mul_pd(_mm_sub_pd(t, _mm_cvtepi32_pd(quarter)), _mm_set1_pd(1.57079632679489661923));
+    auto a2 = _mm_mul_pd(a, a);
+
+    auto s = _mm_set1_pd(-1.0 / 1307674368000.0);
+    s = _mm_add_pd(_mm_set1_pd(1.0 / 6227020800.0), _mm_mul_pd(a2, s));
+    s = _mm_add_pd(_mm_set1_pd(-1.0 / 39916800.0), _mm_mul_pd(a2, s));
+    s = _mm_add_pd(_mm_set1_pd(1.0 / 362880.0), _mm_mul_pd(a2, s));
+    s = _mm_add_pd(_mm_set1_pd(-1.0 / 5040.0), _mm_mul_pd(a2, s));
+    s = _mm_add_pd(_mm_set1_pd(1.0 / 120.0), _mm_mul_pd(a2, s));
+    s = _mm_add_pd(_mm_set1_pd(-1.0 / 6.0), _mm_mul_pd(a2, s));
+    s = _mm_mul_pd(a, _mm_add_pd(_mm_set1_pd(1.0), _mm_mul_pd(a2, s)));
+
+    auto c = _mm_set1_pd(1.0 / 20922789888000.0);
+    c = _mm_add_pd(_mm_set1_pd(-1.0 / 87178291200.0), _mm_mul_pd(a2, c));
+    c = _mm_add_pd(_mm_set1_pd(1.0 / 479001600.0), _mm_mul_pd(a2, c));
+    c = _mm_add_pd(_mm_set1_pd(-1.0 / 3628800.0), _mm_mul_pd(a2, c));
+    c = _mm_add_pd(_mm_set1_pd(1.0 / 40320.0), _mm_mul_pd(a2, c));
+    c = _mm_add_pd(_mm_set1_pd(-1.0 / 720.0), _mm_mul_pd(a2, c));
+    c = _mm_add_pd(_mm_set1_pd(1.0 / 24.0), _mm_mul_pd(a2, c));
+    c = _mm_add_pd(_mm_set1_pd(-1.0 / 2.0), _mm_mul_pd(a2, c));
+    c = _mm_add_pd(_mm_set1_pd(1.0), _mm_mul_pd(a2, c));
+
+    // each quarter's 32 bit value copied to both halves of its lane, so the comparisons give 64 bit masks
+    auto lanes = _mm_shuffle_epi32(quarter, _MM_SHUFFLE(1, 1, 0, 0));
+    auto bitSet = [&lanes] (__m128i value, int bit) {
+        auto mask = _mm_set1_epi32(bit);
+        return _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(value, mask), mask));
+    };
+
+    auto swap = bitSet(lanes, 1);
+    auto negateCos = bitSet(_mm_add_epi32(lanes, _mm_set1_epi32(1)), 2);
+    auto negateSin = bitSet(lanes, 2);
+
+    auto x = _mm_or_pd(_mm_and_pd(swap, s), _mm_andnot_pd(swap, c));
+    auto y = _mm_or_pd(_mm_and_pd(swap, c), _mm_andnot_pd(swap, s));
+
+    auto sign = _mm_set1_pd(-0.0);
+
+    cosine = _mm_xor_pd(x, _mm_and_pd(negateCos, sign));
+    sine = _mm_xor_pd(y, _mm_and_pd(negateSin, sign));
+}
+
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GeneratorLogs
+// Desc: out[i] = log(in[i]) for count positive normal values, two at a time with SSE2
+//---------------------------------------------------------------------------------------------------------------------
+inline void GeneratorLogs(const double* in, size_t count, double* out) {
+
+    size_t i = 0;
+
+#ifdef GENERATORS_SSE2
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(out + i, GeneratorLog2(_mm_loadu_pd(in + i)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = GeneratorLog(in[i]);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: NormalPairs
+// Desc: Standard normals 2 * firstPair on, 2 * pairCount of them, by Box-Muller: pair p comes from counters 2p and 2p+1
+//       and gives one normal from the cosine and one from the sine
+//---------------------------------------------------------------------------------------------------------------------
+inline void NormalPairs(const CounterRng& rng, uint64_t firstPair, size_t pairCount, double* out) {
+
+    double radius[normalBlock];
+    double turn[normalBlock];
+
+    for (size_t block = 0; block < pairCount; block += normalBlock) {
+
+        auto count = std::min(normalBlock, pairCount - block);
+        auto pair = firstPair + block;
+
+        // 1 - u is in (0, 1], which log is happy with
+        for (size_t p = 0; p < count; p++) {
+            radius[p] = 1.0 - rng.Uniform(2 * (pair + p));
+            turn[p] = rng.Uniform(2 * (pair + p) + 1);
+        }
+
+        GeneratorLogs(radius, count, radius);
+
+        auto blockOut = out + 2 * block;
+        size_t p = 0;
+
+#ifdef GENERATORS_SSE2
+        for (; p + 2 <= count; p += 2) {
+
+            auto r = _mm_sqrt_pd(_mm_mul_pd(_mm_set1_pd(-2.0), _mm_loadu_pd(radius + p)));
+
+            __m128d sine;
+            __m128d cosine;
+            GeneratorSinCos2(_mm_loadu_pd(turn + p), sine, cosine);
+
+            auto z0 = _mm_mul_pd(r, cosine);
+            auto z1 = _mm_mul_pd(r, sine);
+
+            _mm_storeu_pd(blockOut + 2 * p, _mm_unpacklo_pd(z0, z1));
+            _mm_storeu_pd(blockOut + 2 * p + 2, _mm_unpackhi_pd(z0, z1));
+        }
+#endif
+
+        for (; p < count; p++) {
+
+            auto r = std::sqrt(-2.0 * radius[p]);
+
+            double sine;
+            double cosine;
+            GeneratorSinCos(turn[p], sine, cosine);
+
+            blockOut[2 * p] = r * cosine;
+            blockOut[2 * p + 1] = r * sine;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GenerateNormals
+// Desc: Standard normals begin to begin + count of rng's sequence into out. Normal i is always the same number however
+//       the sequence is cut up.
+//---------------------------------------------------------------------------------------------------------------------
+inline void GenerateNormals(const CounterRng& rng, uint64_t begin, size_t count, double* out) {
+
+    if (count == 0) {
+        return;
+    }
+
+    // odd ends belong to a pair that's only half wanted
+    auto end = begin + count;
+
+    if (begin % 2 != 0) {
+        double pair[2];
+        NormalPairs(rng, begin / 2, 1, pair);
+        *out++ = pair[1];
+        begin++;
+    }
+
+    auto pairCount = static_cast<size_t>((end - begin) / 2);
+    NormalPairs(rng, begin / 2, pairCount, out);
+
+    if ((end - begin) % 2 != 0) {
+        double pair[2];
+        NormalPairs(rng, (end - 1) / 2, 1, pair);
+        out[2 * pairCount] = pair[0];
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ForEachChunk
+// Desc: func(chunk) for every chunk in [0, chunkCount) over threadCount threads (0 for one per core), the calling
+//       thread being one of them. Thread t takes chunks t, t + threads, ... so they all finish about together.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Func>
+void ForEachChunk(size_t chunkCount, unsigned int threadCount, const Func& func) {
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    auto threads = std::max<size_t>(1, std::min<size_t>(threadCount, chunkCount));
+
+    auto run = [&func, chunkCount, threads] (size_t first) {
+        for (auto chunk = first; chunk < chunkCount; chunk += threads) {
+            func(chunk);
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (size_t thread = 1; thread < threads; thread++) {
+        workers.emplace_back(run, thread);
+    }
+
+    run(0);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: DecayWeight
+// Desc: weight * phi, flushed to 0 once it's too small to be a normal double. Left alone it would get stuck on the
+//       smallest denormal, which rounds back to itself and costs a microcode assist on every multiply after.
+//---------------------------------------------------------------------------------------------------------------------
+inline double DecayWeight(double weight, double phi) {
+    weight *= phi;
+    return (std::fabs(weight) < std::numeric_limits<double>::min()) ? 0.0 : weight;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GenerateAr1
+// Desc: count samples of x[i] = mean + phi * x[i-1] + stddev * z[i] starting from x[-1] = 0, a random walk for
+//       phi = 1. Each chunk runs the recurrence from 0, then the value it should have started from is carried in,
+//       which phi^(j+1) of at sample j of the chunk.
+//---------------------------------------------------------------------------------------------------------------------
+inline std::vector<double> GenerateAr1(uint64_t seed, size_t count, double phi, double stddev, double mean, unsigned int threadCount = 0) {
+
+    std::vector<double> x(count);
+
+    auto chunkCount = (count + generatorChunk - 1) / generatorChunk;
+    auto data = x.data();
+
+    CounterRng rng(seed);
+
+    // phi to the length of the chunk and what the chunk ended on from 0
+    std::vector<double> decay(chunkCount);
+    std::vector<double> last(chunkCount);
+
+    ForEachChunk(chunkCount, threadCount, [&] (size_t chunk) {
+
+        auto begin = chunk * generatorChunk;
+        auto end = std::min(count, begin + generatorChunk);
+
+        GenerateNormals(rng, begin, end - begin, data + begin);
+
+        double value = 0.0;
+        double weight = 1.0;
+
+        for (auto i = begin; i < end; i++) {
+            value = mean + phi * value + stddev * data[i];
+            data[i] = value;
+            weight = DecayWeight(weight, phi);
+        }
+
+        decay[chunk] = weight;
+        last[chunk] = value;
+    });
+
+    std::vector<double> carry(chunkCount, 0.0);
+
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        carry[chunk] = last[chunk - 1] + decay[chunk - 1] * carry[chunk - 1];
+    }
+
+    ForEachChunk(chunkCount, threadCount, [&] (size_t chunk) {
+
+        if (carry[chunk] == 0.0) {
+            return;
+        }
+
+        auto begin = chunk * generatorChunk;
+        auto end = std::min(count, begin + generatorChunk);
+
+        double weight = phi;
+
+        for (auto i = begin; i < end && weight != 0.0; i++) {
+            data[i] += weight * carry[chunk];
+            weight = DecayWeight(weight, phi);
+        }
+    });
+
+    return x;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: GenerateGbm
+// Desc: count prices of geometric Brownian motion from start, drift and volatility per unit time and dt between
+//       samples. The log prices are a running sum, made per chunk and then offset by the chunks before.
+//---------------------------------------------------------------------------------------------------------------------
+inline std::vector<double> GenerateGbm(uint64_t seed, size_t count, double start, double drift, double volatility, double dt, unsigned int threadCount = 0) {
+
+    std::vector<double> prices(count);
+
+    auto chunkCount = (count + generatorChunk - 1) / generatorChunk;
+    auto data = prices.data();
+
+    auto step = (drift - 0.5 * volatility * volatility) * dt;
+    auto scale = volatility * std::sqrt(dt);
+
+    CounterRng rng(seed);
+    std::vector<double> sums(chunkCount);
+
+    ForEachChunk(chunkCount, threadCount, [&] (size_t chunk) {
+
+        auto begin = chunk * generatorChunk;
+        auto end = std::min(count, begin + generatorChunk);
+
+        GenerateNormals(rng, begin, end - begin, data + begin);
+
+        // the first price is start itself
+        double sum = 0.0;
+
+        for (auto i = std::max<size_t>(begin, 1); i < end; i++) {
+            sum += step + scale * data[i];
+            data[i] = sum;
+        }
+
+        if (begin == 0) {
+            data[0] = 0.0;
+        }
+
+        sums[chunk] = sum;
+    });
+
+    std::vector<double> offsets(chunkCount, 0.0);
+
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        offsets[chunk] = offsets[chunk - 1] + sums[chunk - 1];
+    }
+
+    ForEachChunk(chunkCount, threadCount, [&] (size_t chunk) {
+
+        auto begin = chunk * generatorChunk;
+        auto end = std::min(count, begin + generatorChunk);
+
+        for (auto i = begin; i < end; i++) {
+            data[i] = start * std::exp(offsets[chunk] + data[i]);
+        }
+    });
+
+    return prices;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: AppendTickRow
+// Desc: One row the way StreamReadBlock wants it, "id,EURUSD,FX,2017-01-02 09:30:00.125,1.23456", written by hand
+//       since snprintf costs more than everything else about a row put together. day is the row's civil date,
+//       worked out once per day by the caller.
+//---------------------------------------------------------------------------------------------------------------------
+inline char* AppendTickRow(char* out, uint64_t id, int64_t year, unsigned int month, unsigned int day, int64_t msOfDay, uint32_t quote) {
+
+    auto digits = [] (char* at, uint64_t value, int width) {
+        for (auto i = width - 1; i >= 0; i--) {
+            at[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        return at + width;
+    };
+
+    char idText[20];
+    auto idEnd = idText + sizeof(idText);
+    auto idBegin = idEnd;
+
+    do {
+        *--idBegin = static_cast<char>('0' + id % 10);
+        id /= 10;
+    } while (id != 0);
+
+    memcpy(out, idBegin, idEnd - idBegin);
+    out += idEnd - idBegin;
+
+    memcpy(out, ",EURUSD,FX,", 11);
+    out += 11;
+
+    out = digits(out, static_cast<uint64_t>(year), 4);
+    *out++ = '-';
+    out = digits(out, month, 2);
+    *out++ = '-';
+    out = digits(out, day, 2);
+    *out++ = ' ';
+    out = digits(out, msOfDay / barHour, 2);
+    *out++ = ':';
+    out = digits(out, (msOfDay / barMinute) % 60, 2);
+    *out++ = ':';
+    out = digits(out, (msOfDay / barSecond) % 60, 2);
+    *out++ = '.';
+    out = digits(out, msOfDay % barSecond, 3);
+    *out++ = ',';
+
+    // 5 decimals always, so the importer reads back the same integer
+    auto whole = quote / 100000;
+    auto wholeEnd = (whole >= 10000) ? 5 : (whole >= 1000) ? 4 : (whole >= 100) ? 3 : (whole >= 10) ? 2 : 1;
+
+    out = digits(out, whole, wholeEnd);
+    *out++ = '.';
+    out = digits(out, quote % 100000, 5);
+    *out++ = '\n';
+
+    return out;
+}
+
+// longest row AppendTickRow writes
+const size_t tickRowMaxLength = 20 + 11 + 24 + 12 + 1;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FormatTickRows
+// Desc: Rows firstId on for count ticks into text, which is cleared first
+//---------------------------------------------------------------------------------------------------------------------
+inline void FormatTickRows(const int64_t* time, const int32_t* quote, uint64_t firstId, size_t count, std::string& text) {
+
+    text.resize(count * tickRowMaxLength);
+
+    auto out = &text[0];
+
+    int64_t dayStart = -1;
+    int64_t year = 0;
+    unsigned int month = 0;
+    unsigned int day = 0;
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (time[i] < dayStart || time[i] >= dayStart + barDay) {
+            dayStart = BarStart(time[i], barDay);
+            CivilFromDays(dayStart / barDay, year, month, day);
+        }
+
+        out = AppendTickRow(out, firstId + i, year, month, day, time[i] - dayStart, static_cast<uint32_t>(quote[i]));
+    }
+
+    text.resize(out - text.data());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: WriteChunkedCsv
+// Desc: Writes the header and then text for chunks [0, chunkCount) in order. format(chunk, text) fills a chunk's text
+//       on threadCount threads, a round of them at a time, so only a round's worth of text is ever held.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Format>
+bool WriteChunkedCsv(const std::string& filepath, size_t chunkCount, unsigned int threadCount, const Format& format) {
+
+    auto file = fopen(filepath.c_str(), "wb");
+
+    if (file == nullptr) {
+        std::cout << "Error opening file.";
+        return false;
+    }
+
+    fputs("Id,Symbol,Exchange,DateTime,Bid\n", file);
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::string> texts(threadCount);
+    auto ok = true;
+
+    for (size_t round = 0; round < chunkCount && ok; round += threadCount) {
+
+        auto roundCount = std::min<size_t>(threadCount, chunkCount - round);
+
+        ForEachChunk(roundCount, threadCount, [&] (size_t i) { format(round + i, texts[i]); });
+
+        for (size_t i = 0; i < roundCount && ok; i++) {
+            ok = fwrite(texts[i].data(), 1, texts[i].size(), file) == texts[i].size();
+        }
+    }
+
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok) {
+        std::cout << "Error writing " << filepath << "\n";
+    }
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: WriteTickCsv
+// Desc: Tick columns out as a csv file StreamReadBlock and the other importers read back to the same columns. Quotes
+//       are fixed point with 5 decimals, as the importer reads them.
+//---------------------------------------------------------------------------------------------------------------------
+inline bool WriteTickCsv(const std::string& filepath, const int64_t* time, const int32_t* quote, size_t count, unsigned int threadCount = 0) {
+
+    auto chunkCount = (count + generatorChunk - 1) / generatorChunk;
+
+    return WriteChunkedCsv(filepath, chunkCount, threadCount, [time, quote, count] (size_t chunk, std::string& text) {
+        auto begin = chunk * generatorChunk;
+        FormatTickRows(time + begin, quote + begin, begin, std::min(generatorChunk, count - begin), text);
+    });
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: TickGenerator
+// Desc: Made up ticks: Poisson arrivals at ticksPerSecond on average from startTime, and a price doing geometric
+//       Brownian motion with tickVolatility standard deviation of log return per tick and no drift. Times and prices
+//       are running sums, so every chunk's totals are worked out first and then each chunk is made knowing where it
+//       starts, which lets the csv writer make billions of ticks without holding more than a few chunks of them.
+//---------------------------------------------------------------------------------------------------------------------
+class TickGenerator {
+
+    CounterRng priceRng;
+    CounterRng timeRng;
+
+    int64_t startTime;
+    double meanGap;
+    double startPrice;
+    double tickVolatility;
+
+public:
+
+    TickGenerator(uint64_t seed, int64_t startTime, double ticksPerSecond, double startPrice, double tickVolatility) :
+        priceRng(seed, 0), timeRng(seed, 1), startTime(startTime), meanGap(barSecond / ticksPerSecond), startPrice(startPrice), tickVolatility(tickVolatility) {}
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Generate
+    // Desc: count ticks into time and quote, quotes fixed point with 5 decimals
+    //-----------------------------------------------------------------------------------------------------------------
+    void Generate(size_t count, std::vector<int64_t>& time, std::vector<int32_t>& quote, unsigned int threadCount = 0) const {
+
+        time.resize(count);
+        quote.resize(count);
+
+        std::vector<double> timeOffsets;
+        std::vector<double> priceOffsets;
+        this->ChunkOffsets(count, threadCount, timeOffsets, priceOffsets);
+
+        auto timeData = time.data();
+        auto quoteData = quote.data();
+
+        ForEachChunk(timeOffsets.size(), threadCount, [&] (size_t chunk) {
+            this->GenerateChunk(chunk, count, timeOffsets[chunk], priceOffsets[chunk], timeData + chunk * generatorChunk, quoteData + chunk * generatorChunk);
+        });
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: WriteCsv
+    // Desc: count ticks straight to a csv file in the layout StreamReadBlock expects, the same ticks Generate makes
+    //-----------------------------------------------------------------------------------------------------------------
+    bool WriteCsv(const std::string& filepath, size_t count, unsigned int threadCount = 0) const {
+
+        std::vector<double> timeOffsets;
+        std::vector<double> priceOffsets;
+        this->ChunkOffsets(count, threadCount, timeOffsets, priceOffsets);
+
+        return WriteChunkedCsv(filepath, timeOffsets.size(), threadCount, [&] (size_t chunk, std::string& text) {
+
+            std::vector<int64_t> time(generatorChunk);
+            std::vector<int32_t> quote(generatorChunk);
+
+            auto begin = chunk * generatorChunk;
+            this->GenerateChunk(chunk, count, timeOffsets[chunk], priceOffsets[chunk], time.data(), quote.data());
+
+            FormatTickRows(time.data(), quote.data(), begin, std::min(generatorChunk, count - begin), text);
+        });
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ChunkSums
+    // Desc: Running sums of the gaps in ms and of the log returns over the chunk, each starting from 0
+    //-----------------------------------------------------------------------------------------------------------------
+    void ChunkSums(size_t chunk, size_t count, std::vector<double>& gaps, std::vector<double>& returns) const {
+
+        auto begin = chunk * generatorChunk;
+        auto length = std::min(generatorChunk, count - begin);
+
+        gaps.resize(length);
+        returns.resize(length);
+
+        for (size_t i = 0; i < length; i++) {
+            gaps[i] = 1.0 - this->timeRng.Uniform(begin + i);
+        }
+
+        GeneratorLogs(gaps.data(), length, gaps.data());
+        GenerateNormals(this->priceRng, begin, length, returns.data());
+
+        // the first tick is at startTime and startPrice
+        auto step = -0.5 * this->tickVolatility * this->tickVolatility;
+
+        double gapSum = 0.0;
+        double returnSum = 0.0;
+
+        for (size_t i = (begin == 0) ? 1 : 0; i < length; i++) {
+            gapSum -= this->meanGap * gaps[i];
+            returnSum += step + this->tickVolatility * returns[i];
+
+            gaps[i] = gapSum;
+            returns[i] = returnSum;
+        }
+
+        if (begin == 0) {
+            gaps[0] = 0.0;
+            returns[0] = 0.0;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ChunkOffsets
+    // Desc: Where every chunk's time and log price start relative to the first tick
+    //-----------------------------------------------------------------------------------------------------------------
+    void ChunkOffsets(size_t count, unsigned int threadCount, std::vector<double>& timeOffsets, std::vector<double>& priceOffsets) const {
+
+        auto chunkCount = (count + generatorChunk - 1) / generatorChunk;
+
+        std::vector<double> timeSums(chunkCount);
+        std::vector<double> priceSums(chunkCount);
+
+        ForEachChunk(chunkCount, threadCount, [&] (size_t chunk) {
+            std::vector<double> gaps;
+            std::vector<double> returns;
+            this->ChunkSums(chunk, count, gaps, returns);
+
+            timeSums[chunk] = gaps.back();
+            priceSums[chunk] = returns.back();
+        });
+
+        timeOffsets.assign(chunkCount, 0.0);
+        priceOffsets.assign(chunkCount, 0.0);
+
+        for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+            timeOffsets[chunk] = timeOffsets[chunk - 1] + timeSums[chunk - 1];
+            priceOffsets[chunk] = priceOffsets[chunk - 1] + priceSums[chunk - 1];
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: GenerateChunk
+    // Desc: One chunk's ticks, given where its time and log price start. Times are floored to the ms, so ticks closer
+    //       together than that share a timestamp.
+    //-----------------------------------------------------------------------------------------------------------------
+    void GenerateChunk(size_t chunk, size_t count, double timeOffset, double priceOffset, int64_t* time, int32_t* quote) const {
+
+        std::vector<double> gaps;
+        std::vector<double> returns;
+        this->ChunkSums(chunk, count, gaps, returns);
+
+        for (size_t i = 0; i < gaps.size(); i++) {
+
+            time[i] = this->startTime + static_cast<int64_t>(std::floor(timeOffset + gaps[i]));
+
+            auto price = std::llround(this->startPrice * std::exp(priceOffset + returns[i]) * 100000.0);
+            quote[i] = static_cast<int32_t>(std::min<long long>(std::max<long long>(price, 1), INT32_MAX));
+        }
+    }
+};
+
+#endif // GENERATORS_H
@@ -0,0 +1,361 @@
+// HeadlessRender.h
+#ifndef HEADLESSRENDER_H
+#define HEADLESSRENDER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <unordered_set>
+
+#include "SDL.h"
+#include "SDL_ttf.h"
+
+#include "CsvImport.h"
+#include "ImageWriter.h"
+#include "TickColumns.h"
+#include "SDLPlot.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: HeadlessConfig
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------
+struct HeadlessConfig {
+    int width;
+    int height;
+
+    // 0 for one per core
+    unsigned int threadCount;
+
+    std::string outputDirectory;
+
+    // "png" or "ppm"
+    std::string format;
+
+    // "sdl" for the SDL software renderer, "canvas" for PixelCanvas
+    std::string backend;
+
+    // margins etc, the size comes from width/height
+    SDLPlotConfiguration plotConfiguration;
+
+    HeadlessConfig() : width(1280), height(720), threadCount(0), outputDirectory("."), format("png"), backend("sdl") {
+        this->plotConfiguration.grid = false;
+        this->plotConfiguration.leftMargin = 50;
+        this->plotConfiguration.rightMargin = 50;
+        this->plotConfiguration.topMargin = 50;
+        this->plotConfiguration.bottomMargin = 50;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: HeadlessOutputName
+// Desc: The csv file's name without its directory or extension
+//---------------------------------------------------------------------------------------------------------------------
+std::string HeadlessOutputName(const std::string& csvPath) {
+
+    auto nameBegin = csvPath.find_last_of("/\\");
+    auto name = (nameBegin == std::string::npos) ? csvPath : csvPath.substr(nameBegin + 1);
+
+    auto extension = name.find_last_of('.');
+
+    if (extension != std::string::npos && extension > 0) {
+        name = name.substr(0, extension);
+    }
+
+    return name;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: HeadlessOutputPath
+// Desc: outputDirectory/<csv file name without extension>.<format>
+//---------------------------------------------------------------------------------------------------------------------
+std::string HeadlessOutputPath(const std::string& csvPath, const HeadlessConfig& config) {
+    return config.outputDirectory + "/" + HeadlessOutputName(csvPath) + "." + config.format;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: HeadlessOutputPaths
+// Desc: HeadlessOutputPath for every csv file, except that files whose names would collide, like a/EURUSD.csv and
+//       b/EURUSD.csv, get _2, _3... on the end of all but the first so no chart overwrites another
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<std::string> HeadlessOutputPaths(const std::vector<std::string>& csvFiles, const HeadlessConfig& config) {
+
+    std::vector<std::string> outputPaths;
+    std::unordered_set<std::string> used;
+
+    // every plain name is taken first so a renamed file can't land on a later file's name
+    for (auto& csvFile : csvFiles) {
+        used.insert(HeadlessOutputName(csvFile));
+    }
+
+    std::unordered_set<std::string> written;
+
+    for (auto& csvFile : csvFiles) {
+
+        auto name = HeadlessOutputName(csvFile);
+
+        if (!written.insert(name).second) {
+
+            auto base = name;
+
+            for (unsigned int suffix = 2; used.count(name) != 0; suffix++) {
+                name = base + "_" + std::to_string(suffix);
+            }
+
+            used.insert(name);
+            written.insert(name);
+
+            std::cout << "Writing " << csvFile << " as " << name << "." << config.format << ", another file has the same name\n";
+        }
+
+        outputPaths.push_back(config.outputDirectory + "/" + name + "." + config.format);
+    }
+
+    return outputPaths;
+}
+
+// ChartTicks
+// A csv file's timestamps (epoch ms) and quotes, along with the reader and row batch they're loaded through. All of it is
+// kept between charts, so once the buffers have grown to fit the biggest file so far, loading another only allocates
+// whatever opening the file does.
+struct ChartTicks {
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+
+    CsvStreamReader reader;
+    std::vector<DateTimePricePair> batch;
+};
+
+// rows LoadTicks reads at a time
+const size_t chartBatchRows = 1 << 16;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: LoadTicks
+// Desc: The time and quote columns of a csv file, into ticks. Returns false if the file can't be opened.
+//---------------------------------------------------------------------------------------------------------------------
+bool LoadTicks(const std::string& csvPath, ChartTicks& ticks) {
+
+    ticks.time.clear();
+    ticks.quote.clear();
+
+    if (!ticks.reader.Open(csvPath)) {
+        return false;
+    }
+
+    ticks.batch.clear();
+
+    while (ticks.reader.ReadBatch(ticks.batch, chartBatchRows) > 0) {
+
+        for (auto& row : ticks.batch) {
+            ticks.time.push_back(ToEpochMillis(row));
+            ticks.quote.push_back(static_cast<int32_t>(row.quote));
+        }
+
+        ticks.batch.clear();
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: DrawChart
+// Desc: Everything that goes on a chart, whichever backend plot draws with. Quotes go on a time axis so gaps in the
+//       file show, unless its timestamps are out of order.
+//---------------------------------------------------------------------------------------------------------------------
+void DrawChart(SDLPlot& plot, const ChartTicks& ticks) {
+
+    plot.Draw();
+
+    auto count = ticks.quote.size();
+
+    if (count == 0) {
+        return;
+    }
+
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    auto tBegin = ticks.time.front();
+    auto tEnd = ticks.time.back() + 1;
+
+    if (tEnd - tBegin > 1 && std::is_sorted(ticks.time.begin(), ticks.time.end())) {
+
+        auto view = SeriesView(SeriesColumn(ticks.quote.data()), count, SeriesColumn(ticks.time.data()));
+        auto window = plot.PlotTimeWindow(view, tBegin, tEnd, color);
+
+        plot.DrawTimeTickLabels(tBegin, tEnd, window.min, window.max);
+        return;
+    }
+
+    double min;
+    double max;
+
+    auto view = SeriesView(SeriesColumn(ticks.quote.data()), count);
+    ColumnRange(view.y, 0, count, min, max);
+
+    plot.Plot(view, color);
+    plot.DrawTickLabels(0, count - 1, min, max);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: WriteImage
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------
+bool WriteImage(const std::string& outputPath, const std::string& format, SDL_Surface* surface) {
+    return (format == "ppm") ? WritePPM(outputPath, surface) : WritePNG(outputPath, surface);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: RenderChartHeadless
+// Desc: One csv file through plot into surface, then out to outputPath. ticks is scratch space kept by the caller.
+//       Returns false without writing anything if the file can't be read.
+//---------------------------------------------------------------------------------------------------------------------
+bool RenderChartHeadless(SDL_Renderer* renderer, SDL_Surface* surface, SDLPlot& plot, const std::string& csvPath, const std::string& outputPath, const std::string& format, ChartTicks& ticks) {
+
+    if (!LoadTicks(csvPath, ticks)) {
+        return false;
+    }
+
+    SDL_SetRenderDrawColor(renderer, 0x2f, 0x2f, 0x2f, 0xff);
+    SDL_RenderClear(renderer);
+
+    DrawChart(plot, ticks);
+
+    // the software renderer queues commands too, make sure they've hit the surface before reading it
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+    SDL_RenderFlush(renderer);
+#endif
+
+    return WriteImage(outputPath, format, surface);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: RenderChartOnCanvas
+// Desc: RenderChartHeadless for the PixelCanvas backend. surface wraps canvas's pixels.
+//---------------------------------------------------------------------------------------------------------------------
+bool RenderChartOnCanvas(PixelCanvas& canvas, SDL_Surface* surface, SDLPlot& plot, const std::string& csvPath, const std::string& outputPath, const std::string& format, ChartTicks& ticks) {
+
+    if (!LoadTicks(csvPath, ticks)) {
+        return false;
+    }
+
+    canvas.Clear(PackCanvasColor(0x2f, 0x2f, 0x2f, 0xff));
+    DrawChart(plot, ticks);
+    canvas.Render();
+
+    return WriteImage(outputPath, format, surface);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: RenderChartsHeadless
+// Desc: Renders every csv file to an image without a window, display or vsync. Each worker thread has its own
+//       surface, software renderer (or PixelCanvas) and SDLPlot and takes the next file off a shared counter until
+//       there are none left. Needs TTF_Init but not SDL_INIT_VIDEO. Returns how many charts were written.
+//---------------------------------------------------------------------------------------------------------------------
+unsigned int RenderChartsHeadless(const std::vector<std::string>& csvFiles, const HeadlessConfig& config) {
+
+    auto threadCount = config.threadCount;
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    threadCount = std::max(1u, std::min<unsigned int>(threadCount, csvFiles.size()));
+
+    auto outputPaths = HeadlessOutputPaths(csvFiles, config);
+
+    std::atomic<size_t> nextFile(0);
+    std::atomic<unsigned int> rendered(0);
+
+    auto canvasWorker = [&csvFiles, &outputPaths, &config, &nextFile, &rendered] () {
+
+        // rows of a canvas are the same bytes as an rmask/gmask/bmask/amask surface
+        PixelCanvas canvas(config.width, config.height);
+        auto surface = SDL_CreateRGBSurfaceFrom(canvas.Pixels(), config.width, config.height, 32, canvas.Pitch(), rmask, gmask, bmask, amask);
+
+        auto plotConfiguration = config.plotConfiguration;
+        plotConfiguration.plotWidth = config.width;
+        plotConfiguration.plotHeight = config.height;
+
+        SDLPlot plot(&canvas, plotConfiguration);
+        ChartTicks ticks;
+
+        for (auto file = nextFile++; file < csvFiles.size(); file = nextFile++) {
+
+            if (RenderChartOnCanvas(canvas, surface, plot, csvFiles[file], outputPaths[file], config.format, ticks)) {
+                rendered++;
+            } else {
+                std::cout << "Failed to render " << csvFiles[file] << "\n";
+            }
+        }
+
+        SDL_FreeSurface(surface);
+    };
+
+    auto rendererWorker = [&csvFiles, &outputPaths, &config, &nextFile, &rendered] () {
+
+        auto surface = SDL_CreateRGBSurface(0, config.width, config.height, 32, rmask, gmask, bmask, amask);
+        auto renderer = (surface != nullptr) ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+
+        if (renderer == nullptr) {
+            std::cout << "Couldn't create a software renderer: " << SDL_GetError() << "\n";
+            SDL_FreeSurface(surface);
+            return;
+        }
+
+        {
+            auto plotConfiguration = config.plotConfiguration;
+            plotConfiguration.plotWidth = config.width;
+            plotConfiguration.plotHeight = config.height;
+
+            SDLPlot plot(renderer, plotConfiguration);
+            ChartTicks ticks;
+
+            for (auto file = nextFile++; file < csvFiles.size(); file = nextFile++) {
+
+                if (RenderChartHeadless(renderer, surface, plot, csvFiles[file], outputPaths[file], config.format, ticks)) {
+                    rendered++;
+                } else {
+                    std::cout << "Failed to render " << csvFiles[file] << "\n";
+                }
+            }
+        }
+
+        ClearGlyphAtlases(renderer);
+
+        SDL_DestroyRenderer(renderer);
+        SDL_FreeSurface(surface);
+    };
+
+    std::function<void()> worker = rendererWorker;
+
+    if (config.backend == "canvas") {
+        worker = canvasWorker;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 1; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Rendered " << rendered << " charts with " << config.backend << " on " << threadCount << " threads in " << seconds << " s ("
+        << ((seconds > 0.0) ? rendered / seconds : 0.0) << " charts/s)\n";
+
+    return rendered;
+}
+
+#endif // HEADLESSRENDER_H
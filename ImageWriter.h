@@ -0,0 +1,261 @@
+// ImageWriter.h
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "SDL.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SurfaceToRGB
+// Desc: Tightly packed 8 bit RGB rows of surface, whatever its pixel format is
+//---------------------------------------------------------------------------------------------------------------------
+bool SurfaceToRGB(SDL_Surface* surface, std::vector<uint8_t>& rgb) {
+
+    if (surface == nullptr || surface->format == nullptr) {
+        return false;
+    }
+
+    rgb.resize(static_cast<size_t>(surface->w) * surface->h * 3);
+
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) != 0) {
+        return false;
+    }
+
+    // 32 bit surfaces with 8 bit channels are the common case and get shifted apart directly, anything else goes
+    // through SDL_GetRGB a pixel at a time
+    auto format = surface->format;
+    auto bytesPerPixel = format->BytesPerPixel;
+    auto out = rgb.data();
+
+    if (bytesPerPixel == 4 && format->Rloss == 0 && format->Gloss == 0 && format->Bloss == 0) {
+
+        for (auto y = 0; y < surface->h; y++) {
+
+            auto row = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch);
+
+            for (auto x = 0; x < surface->w; x++) {
+                out[0] = static_cast<uint8_t>(row[x] >> format->Rshift);
+                out[1] = static_cast<uint8_t>(row[x] >> format->Gshift);
+                out[2] = static_cast<uint8_t>(row[x] >> format->Bshift);
+                out += 3;
+            }
+        }
+
+        if (SDL_MUSTLOCK(surface)) {
+            SDL_UnlockSurface(surface);
+        }
+
+        return true;
+    }
+
+    for (auto y = 0; y < surface->h; y++) {
+
+        auto row = static_cast<const uint8_t*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch;
+
+        for (auto x = 0; x < surface->w; x++) {
+
+            uint32_t pixel = 0;
+            auto source = row + x * bytesPerPixel;
+
+            switch (bytesPerPixel) {
+                case 1: pixel = *source; break;
+                case 2: pixel = *reinterpret_cast<const uint16_t*>(source); break;
+                case 3: pixel = (SDL_BYTEORDER == SDL_BIG_ENDIAN) ? (source[0] << 16 | source[1] << 8 | source[2]) : (source[2] << 16 | source[1] << 8 | source[0]); break;
+                default: pixel = *reinterpret_cast<const uint32_t*>(source); break;
+            }
+
+            SDL_GetRGB(pixel, surface->format, out, out + 1, out + 2);
+            out += 3;
+        }
+    }
+
+    if (SDL_MUSTLOCK(surface)) {
+        SDL_UnlockSurface(surface);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: WritePPM
+// Desc: Binary (P6) PPM
+//---------------------------------------------------------------------------------------------------------------------
+bool WritePPM(const std::string& filepath, SDL_Surface* surface) {
+
+    std::vector<uint8_t> rgb;
+
+    if (!SurfaceToRGB(surface, rgb)) {
+        return false;
+    }
+
+    std::ofstream filestream(filepath, std::ios::binary | std::ios::trunc);
+
+    if (!filestream.is_open()) {
+        std::cout << "Error opening file.";
+        return false;
+    }
+
+    filestream << "P6\n" << surface->w << " " << surface->h << "\n255\n";
+    filestream.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+
+    return static_cast<bool>(filestream);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: Crc32
+// Desc: The CRC every PNG chunk ends with
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+
+    static const struct Table {
+        uint32_t entries[256];
+
+        Table() {
+            for (uint32_t n = 0; n < 256; n++) {
+                auto c = n;
+                for (auto k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                this->entries[n] = c;
+            }
+        }
+    } table;
+
+    crc = ~crc;
+
+    for (size_t i = 0; i < size; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: PngChunk
+// Desc: Length, type, data and CRC of one chunk
+//---------------------------------------------------------------------------------------------------------------------
+void PngChunk(std::ofstream& filestream, const char* type, const std::vector<uint8_t>& data) {
+
+    auto writeBigEndian = [&filestream] (uint32_t value) {
+        uint8_t bytes[4] = {(uint8_t) (value >> 24), (uint8_t) (value >> 16), (uint8_t) (value >> 8), (uint8_t) value};
+        filestream.write(reinterpret_cast<const char*>(bytes), 4);
+    };
+
+    writeBigEndian(static_cast<uint32_t>(data.size()));
+    filestream.write(type, 4);
+    filestream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    auto crc = Crc32(reinterpret_cast<const uint8_t*>(type), 4);
+    crc = Crc32(data.data(), data.size(), crc);
+
+    writeBigEndian(crc);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: WritePNG
+// Desc: 8 bit RGB PNG. There's no zlib here so the image data goes in stored (uncompressed) deflate blocks, which
+//       every PNG reader handles. The files come out about the size of a PPM; recompress them afterwards if that
+//       matters.
+//---------------------------------------------------------------------------------------------------------------------
+bool WritePNG(const std::string& filepath, SDL_Surface* surface) {
+
+    std::vector<uint8_t> rgb;
+
+    if (!SurfaceToRGB(surface, rgb)) {
+        return false;
+    }
+
+    std::ofstream filestream(filepath, std::ios::binary | std::ios::trunc);
+
+    if (!filestream.is_open()) {
+        std::cout << "Error opening file.";
+        return false;
+    }
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    filestream.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    auto pushBigEndian = [] (std::vector<uint8_t>& data, uint32_t value) {
+        data.push_back(value >> 24);
+        data.push_back(value >> 16);
+        data.push_back(value >> 8);
+        data.push_back(value);
+    };
+
+    // width, height, bit depth 8, color type 2 (RGB), deflate, adaptive filtering, no interlace
+    std::vector<uint8_t> header;
+    pushBigEndian(header, surface->w);
+    pushBigEndian(header, surface->h);
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    PngChunk(filestream, "IHDR", header);
+
+    // every scanline starts with its filter type, 0 is none
+    auto rowSize = static_cast<size_t>(surface->w) * 3;
+
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve((rowSize + 1) * surface->h);
+
+    for (auto y = 0; y < surface->h; y++) {
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), rgb.begin() + y * rowSize, rgb.begin() + (y + 1) * rowSize);
+    }
+
+    // zlib stream: header, stored blocks of at most 65535 bytes, adler32 of the uncompressed data
+    const size_t maxBlock = 65535;
+
+    std::vector<uint8_t> zlib;
+    zlib.reserve(scanlines.size() + (scanlines.size() / maxBlock + 1) * 5 + 6);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    for (size_t offset = 0; offset < scanlines.size() || offset == 0; offset += maxBlock) {
+
+        auto length = std::min(maxBlock, scanlines.size() - offset);
+        auto last = (offset + length >= scanlines.size());
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(length & 0xff);
+        zlib.push_back(length >> 8);
+        zlib.push_back(~length & 0xff);
+        zlib.push_back((~length >> 8) & 0xff);
+
+        zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+
+        // 5552 bytes is as many as can be summed before b could overflow
+        for (size_t run = offset; run < offset + length; run += 5552) {
+
+            auto runEnd = std::min(offset + length, run + 5552);
+
+            for (auto i = run; i < runEnd; i++) {
+                a += scanlines[i];
+                b += a;
+            }
+
+            a %= 65521;
+            b %= 65521;
+        }
+
+        if (last) {
+            break;
+        }
+    }
+
+    pushBigEndian(zlib, (b << 16) | a);
+
+    PngChunk(filestream, "IDAT", zlib);
+    PngChunk(filestream, "IEND", std::vector<uint8_t>());
+
+    return static_cast<bool>(filestream);
+}
+
+#endif // IMAGEWRITER_H
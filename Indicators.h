@@ -0,0 +1,387 @@
+// Indicators.h
+#ifndef INDICATORS_H
+#define INDICATORS_H
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "Bars.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define INDICATORS_SSE2
+#endif
+
+// IndicatorType
+enum class IndicatorType {
+    Sma,                // mean of the last period samples
+    Ema,                // exponential average, alpha = 2 / (period + 1)
+    Bollinger,          // Sma with bands width standard deviations above and below
+    Rsi,                // Wilder's relative strength index, 0 to 100
+    Vwap                // volume weighted average price since the start of the session
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: IndicatorSpec
+// Desc: Which indicator and its parameters, e.g. IndicatorSpec::Bollinger(20, 2.0)
+//---------------------------------------------------------------------------------------------------------------------
+struct IndicatorSpec {
+    IndicatorType type;
+    size_t period;
+    double width;
+    int64_t session;    // Vwap starts over on multiples of this in the time column, 0 never
+
+    static IndicatorSpec Sma(size_t period) { return IndicatorSpec{IndicatorType::Sma, std::max<size_t>(1, period), 0.0, 0}; }
+    static IndicatorSpec Ema(size_t period) { return IndicatorSpec{IndicatorType::Ema, std::max<size_t>(1, period), 0.0, 0}; }
+    static IndicatorSpec Bollinger(size_t period, double width) { return IndicatorSpec{IndicatorType::Bollinger, std::max<size_t>(1, period), width, 0}; }
+    static IndicatorSpec Rsi(size_t period) { return IndicatorSpec{IndicatorType::Rsi, std::max<size_t>(1, period), 0.0, 0}; }
+    static IndicatorSpec Vwap(int64_t session = barDay) { return IndicatorSpec{IndicatorType::Vwap, 1, 0.0, session}; }
+
+    // Bollinger gives the middle, upper and lower line, everything else one
+    size_t OutputCount() const { return (this->type == IndicatorType::Bollinger) ? 3 : 1; }
+
+    // on the same scale as the prices it's computed from, so it belongs drawn over them
+    bool OnPriceScale() const { return this->type != IndicatorType::Rsi; }
+};
+
+// UnitVolume
+// Every sample counts the same, for ticks without a size. Vwap is then the session's mean price.
+struct UnitVolume {
+    double operator[](size_t) const { return 1.0; }
+};
+
+// NoTime
+// No time column, a Vwap session never ends
+struct NoTime {
+    int64_t operator[](size_t) const { return 0; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: Indicator
+// Desc: An indicator's running state, O(1) per sample however long the period: Sma and Bollinger keep the last
+//       period samples in a ring buffer with their running sum and sum of squares, Ema, Rsi and Vwap a couple of
+//       running values. Feed it a whole column with AddBatch and then keep going a tick at a time with Add, the
+//       results are the same to the bit either way. Until period samples have been seen the windowed ones average
+//       over what there is so the output lines up with the input from the first sample.
+//---------------------------------------------------------------------------------------------------------------------
+class Indicator {
+
+    IndicatorSpec spec;
+    size_t count;
+
+    // Sma and Bollinger, samples are kept relative to the first one so the sum of squares doesn't lose the variance
+    // of a price far from zero
+    std::vector<double> window;
+    size_t next;
+    double shift;
+    double sum;
+    double sumSquares;
+
+    // Ema
+    double alpha;
+    double average;
+
+    // Rsi
+    double previous;
+    double averageGain;
+    double averageLoss;
+
+    // Vwap
+    double priceVolume;
+    double volume;
+    int64_t sessionStart;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Indicator
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    Indicator(const IndicatorSpec& spec) : spec(spec) {
+        this->Reset();
+    }
+
+    const IndicatorSpec& Spec() const { return this->spec; }
+    size_t size() const { return this->count; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Reset
+    // Desc: Back to before the first sample
+    //-----------------------------------------------------------------------------------------------------------------
+    void Reset() {
+
+        this->count = 0;
+
+        this->window.assign((this->spec.type == IndicatorType::Sma || this->spec.type == IndicatorType::Bollinger) ? this->spec.period : 0, 0.0);
+        this->next = 0;
+        this->shift = 0.0;
+        this->sum = 0.0;
+        this->sumSquares = 0.0;
+
+        this->alpha = 2.0 / (this->spec.period + 1.0);
+        this->average = 0.0;
+
+        this->previous = 0.0;
+        this->averageGain = 0.0;
+        this->averageLoss = 0.0;
+
+        this->priceVolume = 0.0;
+        this->volume = 0.0;
+        this->sessionStart = 0;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Add
+    // Desc: One more sample, writes OutputCount() results to out
+    //-----------------------------------------------------------------------------------------------------------------
+    void Add(double price, double* out, double volume = 1.0, int64_t time = 0) {
+
+        double* outputs[3] = {out, out + 1, out + 2};
+        this->AddBatch(&price, &volume, &time, 0, 1, outputs);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddBatch
+    // Desc: prices[begin, end), with volumes and times for Vwap. Result k of sample i goes to outputs[k][i - begin].
+    //       The columns are anything indexable, so imported int32 quote columns or fields of bars are read in place.
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Prices, typename Volumes, typename Times>
+    void AddBatch(const Prices& prices, const Volumes& volumes, const Times& times, size_t begin, size_t end, double* const* outputs) {
+
+        if (begin >= end) {
+            return;
+        }
+
+        switch (this->spec.type) {
+            case IndicatorType::Sma:
+                this->AddSma(prices, begin, end, outputs[0]);
+                break;
+            case IndicatorType::Ema:
+                this->AddEma(prices, begin, end, outputs[0]);
+                break;
+            case IndicatorType::Bollinger:
+                this->AddBollinger(prices, begin, end, outputs[0], outputs[1], outputs[2]);
+                break;
+            case IndicatorType::Rsi:
+                this->AddRsi(prices, begin, end, outputs[0]);
+                break;
+            case IndicatorType::Vwap:
+                this->AddVwap(prices, volumes, times, begin, end, outputs[0]);
+                break;
+        }
+
+        this->count += end - begin;
+    }
+
+    template <typename Prices>
+    void AddBatch(const Prices& prices, size_t begin, size_t end, double* const* outputs) {
+        this->AddBatch(prices, UnitVolume(), NoTime(), begin, end, outputs);
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddSma
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Prices>
+    void AddSma(const Prices& prices, size_t begin, size_t end, double* out) {
+
+        if (this->count == 0) {
+            this->shift = prices[begin];
+        }
+
+        auto period = this->spec.period;
+        auto seen = this->count;
+
+        for (auto i = begin; i < end; i++, seen++) {
+
+            double value = prices[i] - this->shift;
+
+            this->sum += value - this->window[this->next];
+            this->window[this->next] = value;
+            this->next = (this->next + 1 == period) ? 0 : this->next + 1;
+
+            out[i - begin] = this->shift + this->sum / static_cast<double>(std::min(seen + 1, period));
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddBollinger
+    // Desc: Running sums into the output arrays first, then the means and bands out of them, two at a time with SSE2
+    //       once the window is full and the divisor stops changing
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Prices>
+    void AddBollinger(const Prices& prices, size_t begin, size_t end, double* middle, double* upper, double* lower) {
+
+        if (this->count == 0) {
+            this->shift = prices[begin];
+        }
+
+        auto period = this->spec.period;
+        auto count = end - begin;
+
+        for (size_t i = 0; i < count; i++) {
+
+            double value = prices[begin + i] - this->shift;
+            double old = this->window[this->next];
+
+            this->sum += value - old;
+            this->sumSquares += value * value - old * old;
+
+            this->window[this->next] = value;
+            this->next = (this->next + 1 == period) ? 0 : this->next + 1;
+
+            middle[i] = this->sum;
+            upper[i] = this->sumSquares;
+        }
+
+        // samples before the window fills divide by how many there are so far
+        auto warmUp = (this->count < period) ? std::min(count, period - this->count) : 0;
+
+        for (size_t i = 0; i < warmUp; i++) {
+            this->Bands(static_cast<double>(this->count + i + 1), middle[i], upper[i], lower[i]);
+        }
+
+        size_t i = warmUp;
+        double n = static_cast<double>(period);
+
+#ifdef INDICATORS_SSE2
+        auto divisor = _mm_set1_pd(n);
+        auto shift = _mm_set1_pd(this->shift);
+        auto width = _mm_set1_pd(this->spec.width);
+        auto zero = _mm_setzero_pd();
+
+        for (; i + 2 <= count; i += 2) {
+
+            auto mean = _mm_div_pd(_mm_loadu_pd(middle + i), divisor);
+            auto variance = _mm_max_pd(_mm_sub_pd(_mm_div_pd(_mm_loadu_pd(upper + i), divisor), _mm_mul_pd(mean, mean)), zero);
+            auto band = _mm_mul_pd(width, _mm_sqrt_pd(variance));
+
+            mean = _mm_add_pd(shift, mean);
+
+            _mm_storeu_pd(middle + i, mean);
+            _mm_storeu_pd(upper + i, _mm_add_pd(mean, band));
+            _mm_storeu_pd(lower + i, _mm_sub_pd(mean, band));
+        }
+#endif
+
+        for (; i < count; i++) {
+            this->Bands(n, middle[i], upper[i], lower[i]);
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Bands
+    // Desc: middle and upper come in holding the sum and sum of squares of n samples and go out as the mean and band.
+    //       Same operations in the same order as the SSE2 loop so both give the same bits.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Bands(double n, double& middle, double& upper, double& lower) const {
+
+        auto mean = middle / n;
+        auto variance = std::max(upper / n - mean * mean, 0.0);
+        auto band = this->spec.width * std::sqrt(variance);
+
+        mean = this->shift + mean;
+
+        middle = mean;
+        upper = mean + band;
+        lower = mean - band;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddEma
+    // Desc: Each value depends on the one before, so this is a plain loop rather than a vector one
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Prices>
+    void AddEma(const Prices& prices, size_t begin, size_t end, double* out) {
+
+        if (this->count == 0) {
+            this->average = prices[begin];
+        }
+
+        auto alpha = this->alpha;
+        auto average = this->average;
+
+        for (auto i = begin; i < end; i++) {
+            average += alpha * (prices[i] - average);
+            out[i - begin] = average;
+        }
+
+        this->average = average;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddRsi
+    // Desc: Average gain and loss are plain means over the first period changes and Wilder smoothed after that
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Prices>
+    void AddRsi(const Prices& prices, size_t begin, size_t end, double* out) {
+
+        auto period = static_cast<double>(this->spec.period);
+        auto seen = this->count;
+
+        for (auto i = begin; i < end; i++, seen++) {
+
+            double price = prices[i];
+
+            if (seen == 0) {
+                this->previous = price;
+                out[i - begin] = 50.0;
+                continue;
+            }
+
+            auto change = price - this->previous;
+            auto gain = std::max(change, 0.0);
+            auto loss = std::max(-change, 0.0);
+
+            this->previous = price;
+
+            auto divisor = std::min(static_cast<double>(seen), period);
+
+            this->averageGain += (gain - this->averageGain) / divisor;
+            this->averageLoss += (loss - this->averageLoss) / divisor;
+
+            if (this->averageLoss == 0.0) {
+                out[i - begin] = (this->averageGain == 0.0) ? 50.0 : 100.0;
+            } else {
+                out[i - begin] = 100.0 - 100.0 / (1.0 + this->averageGain / this->averageLoss);
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddVwap
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Prices, typename Volumes, typename Times>
+    void AddVwap(const Prices& prices, const Volumes& volumes, const Times& times, size_t begin, size_t end, double* out) {
+
+        auto session = this->spec.session;
+        auto seen = this->count;
+
+        for (auto i = begin; i < end; i++, seen++) {
+
+            double price = prices[i];
+            double volume = volumes[i];
+
+            auto start = (session > 0) ? BarStart(static_cast<int64_t>(times[i]), session) : 0;
+
+            if (seen == 0 || start != this->sessionStart) {
+                this->sessionStart = start;
+                this->priceVolume = 0.0;
+                this->volume = 0.0;
+            }
+
+            this->priceVolume += price * volume;
+            this->volume += volume;
+
+            out[i - begin] = (this->volume > 0.0) ? this->priceVolume / this->volume : price;
+        }
+    }
+};
+
+#endif // INDICATORS_H
@@ -0,0 +1,175 @@
+// MappedFile.h
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <iostream>
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: MappedFile
+// Desc: Read only view of a whole file mapped into memory. The mapping is released when the object goes out of scope.
+//---------------------------------------------------------------------------------------------------------------------
+class MappedFile {
+
+    const char* data;
+    size_t size;
+
+#ifdef _WIN32
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: MappedFile
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    MappedFile() : data(nullptr), size(0) {
+#ifdef _WIN32
+        this->fileHandle = INVALID_HANDLE_VALUE;
+        this->mappingHandle = nullptr;
+#else
+        this->fileDescriptor = -1;
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ~MappedFile
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    ~MappedFile() {
+        this->Close();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Open
+    // Desc: Maps the whole file. Returns false if the file could not be opened or mapped. An empty file opens
+    //       successfully with Data() == nullptr and Size() == 0.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Open(const std::string& filepath) {
+
+        this->Close();
+
+#ifdef _WIN32
+        this->fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if (this->fileHandle == INVALID_HANDLE_VALUE) {
+            std::cout << "Error opening file.";
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(this->fileHandle, &fileSize)) {
+            this->Close();
+            return false;
+        }
+
+        this->size = static_cast<size_t>(fileSize.QuadPart);
+
+        if (this->size == 0) {
+            return true;
+        }
+
+        this->mappingHandle = CreateFileMappingA(this->fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (this->mappingHandle == nullptr) {
+            std::cout << "Error mapping file.";
+            this->Close();
+            return false;
+        }
+
+        this->data = static_cast<const char*>(MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+        this->fileDescriptor = open(filepath.c_str(), O_RDONLY);
+
+        if (this->fileDescriptor < 0) {
+            std::cout << "Error opening file.";
+            return false;
+        }
+
+        struct stat fileStat;
+        if (fstat(this->fileDescriptor, &fileStat) != 0) {
+            this->Close();
+            return false;
+        }
+
+        this->size = static_cast<size_t>(fileStat.st_size);
+
+        if (this->size == 0) {
+            return true;
+        }
+
+        auto mapped = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->fileDescriptor, 0);
+        this->data = (mapped == MAP_FAILED) ? nullptr : static_cast<const char*>(mapped);
+
+        if (this->data != nullptr) {
+            // we scan front to back so let the kernel read ahead aggressively
+            madvise(mapped, this->size, MADV_SEQUENTIAL);
+        }
+#endif
+
+        if (this->data == nullptr) {
+            std::cout << "Error mapping file.";
+            this->Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Close
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void Close() {
+#ifdef _WIN32
+        if (this->data != nullptr) {
+            UnmapViewOfFile(this->data);
+        }
+
+        if (this->mappingHandle != nullptr) {
+            CloseHandle(this->mappingHandle);
+        }
+
+        if (this->fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(this->fileHandle);
+        }
+
+        this->mappingHandle = nullptr;
+        this->fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (this->data != nullptr) {
+            munmap(const_cast<char*>(this->data), this->size);
+        }
+
+        if (this->fileDescriptor >= 0) {
+            close(this->fileDescriptor);
+        }
+
+        this->fileDescriptor = -1;
+#endif
+        this->data = nullptr;
+        this->size = 0;
+    }
+
+    const char* Data() const { return this->data; }
+    size_t Size() const { return this->size; }
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,368 @@
+// MinMaxPyramid.h
+#ifndef MINMAXPYRAMID_H
+#define MINMAXPYRAMID_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "Decimation.h"
+
+// MinMax
+struct MinMax {
+    double min;
+    double max;
+};
+
+// MinMaxPyramidHeader
+// On disk layout: header followed by every level's nodes, finest level first
+struct MinMaxPyramidHeader {
+    char magic[8];
+
+    uint32_t version;
+    uint32_t blockSize;
+
+    uint64_t count;
+    uint64_t levelCount;
+};
+
+const char minMaxPyramidMagic[8] = {'S', 'D', 'L', 'P', 'Y', 'R', 'D', 0};
+const uint32_t minMaxPyramidVersion = 1;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: MinMaxPyramid
+// Desc: Level of detail index over a series. Level 0 holds the min/max of each block of blockSize samples and every
+//       level above holds the min/max of pairs of nodes below it, so the min/max of any range comes out of
+//       O(blockSize + log N) reads. First/last of a range are single reads of the series itself so they aren't
+//       stored. The pyramid doesn't own the series; every call that needs samples takes them, as a double* or
+//       anything else indexable the same way.
+//---------------------------------------------------------------------------------------------------------------------
+class MinMaxPyramid {
+
+    static const size_t blockSize = 64;
+
+    std::vector<std::vector<MinMax>> levels;
+    size_t count;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: MinMaxPyramid
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    MinMaxPyramid() : count(0) {}
+
+    size_t size() const { return this->count; }
+    size_t LevelCount() const { return this->levels.size(); }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Build
+    // Desc: Builds the pyramid over yData[0, count). The finest level is split across threadCount threads (0 for one
+    //       per core), everything above it is tiny in comparison.
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Samples>
+    void Build(const Samples& yData, size_t count, unsigned int threadCount = 0) {
+
+        this->count = count;
+        this->levels.clear();
+
+        if (count == 0) {
+            return;
+        }
+
+        this->levels.emplace_back((count + blockSize - 1) / blockSize);
+
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        auto blockCount = this->levels[0].size();
+        auto chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, blockCount / 1024));
+
+        std::vector<std::thread> workers;
+
+        for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+            workers.emplace_back([this, yData, chunk, chunkCount, blockCount] () {
+                this->BuildBlocks(yData, (blockCount * chunk) / chunkCount, (blockCount * (chunk + 1)) / chunkCount);
+            });
+        }
+
+        this->BuildBlocks(yData, 0, blockCount / chunkCount);
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        this->BuildLevelsAbove(0);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Append
+    // Desc: yData has grown to newCount samples, the first size() of which the pyramid already covers. Only the last
+    //       block and the nodes above the new samples are recomputed.
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Samples>
+    void Append(const Samples& yData, size_t newCount) {
+
+        if (this->levels.empty()) {
+            this->Build(yData, newCount, 1);
+            return;
+        }
+
+        if (newCount <= this->count) {
+            return;
+        }
+
+        auto firstDirty = this->count / blockSize;
+
+        this->count = newCount;
+        this->levels[0].resize((newCount + blockSize - 1) / blockSize);
+
+        this->BuildBlocks(yData, firstDirty, this->levels[0].size());
+        this->BuildLevelsAbove(firstDirty);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Query
+    // Desc: Exact min/max of yData[begin, end)
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Samples>
+    MinMax Query(const Samples& yData, size_t begin, size_t end) const {
+
+        MinMax result = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+
+        // partial blocks at either end come straight from the samples
+        auto headEnd = std::min(end, ((begin + blockSize - 1) / blockSize) * blockSize);
+        Scan(yData, begin, headEnd, result);
+
+        if (headEnd >= end) {
+            return result;
+        }
+
+        auto tailBegin = std::max(headEnd, (end / blockSize) * blockSize);
+        Scan(yData, tailBegin, end, result);
+
+        // whole blocks in between, climbing a level whenever a pair of nodes can be taken as their parent
+        auto lo = headEnd / blockSize;
+        auto hi = tailBegin / blockSize;
+
+        for (size_t level = 0; lo < hi; level++) {
+
+            auto& nodes = this->levels[level];
+
+            if (lo & 1) {
+                Combine(result, nodes[lo++]);
+            }
+
+            if (hi & 1) {
+                Combine(result, nodes[--hi]);
+            }
+
+            lo >>= 1;
+            hi >>= 1;
+        }
+
+        return result;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: QueryM4
+    // Desc: Same columns DecimateM4 would produce for yData[begin, end) but in O(width * log N). Expects
+    //       end - begin >= width.
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Samples>
+    void QueryM4(const Samples& yData, size_t begin, size_t end, size_t width, std::vector<M4Column>& columns) const {
+
+        columns.resize(width);
+
+        auto rangeCount = end - begin;
+
+        for (size_t column = 0; column < width; column++) {
+
+            auto start = begin + M4ColumnStart(column, rangeCount, width);
+            auto stop = begin + M4ColumnStart(column + 1, rangeCount, width);
+
+            auto minMax = this->Query(yData, start, stop);
+
+            columns[column].first = yData[start];
+            columns[column].min = minMax.min;
+            columns[column].max = minMax.max;
+            columns[column].last = yData[stop - 1];
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Save
+    // Desc: Writes the pyramid out so it can sit next to the data it indexes
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Save(const std::string& filepath) const {
+
+        std::ofstream filestream(filepath, std::ios::binary | std::ios::trunc);
+
+        if (!filestream.is_open()) {
+            std::cout << "Error opening file.";
+            return false;
+        }
+
+        MinMaxPyramidHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, minMaxPyramidMagic, sizeof(header.magic));
+
+        header.version = minMaxPyramidVersion;
+        header.blockSize = blockSize;
+        header.count = this->count;
+        header.levelCount = this->levels.size();
+
+        filestream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (auto& level : this->levels) {
+            filestream.write(reinterpret_cast<const char*>(level.data()), level.size() * sizeof(MinMax));
+        }
+
+        return static_cast<bool>(filestream);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Load
+    // Desc: Reads a pyramid written by Save. Fails if it wasn't built over expectedCount samples.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Load(const std::string& filepath, size_t expectedCount) {
+
+        std::ifstream filestream(filepath, std::ios::binary);
+
+        if (!filestream.is_open()) {
+            return false;
+        }
+
+        MinMaxPyramidHeader header;
+        filestream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if (!filestream || memcmp(header.magic, minMaxPyramidMagic, sizeof(header.magic)) != 0 ||
+            header.version != minMaxPyramidVersion || header.blockSize != blockSize || header.count != expectedCount) {
+            return false;
+        }
+
+        if (header.levelCount != LevelCountFor(header.count)) {
+            std::cout << "Corrupt pyramid file " << filepath << "\n";
+            return false;
+        }
+
+        std::vector<std::vector<MinMax>> levels;
+        auto levelSize = (header.count + blockSize - 1) / blockSize;
+
+        for (uint64_t level = 0; level < header.levelCount; level++) {
+
+            levels.emplace_back(levelSize);
+
+            if (!filestream.read(reinterpret_cast<char*>(levels.back().data()), levelSize * sizeof(MinMax))) {
+                std::cout << "Truncated pyramid file " << filepath << "\n";
+                return false;
+            }
+
+            levelSize = (levelSize + 1) / 2;
+        }
+
+        this->levels = std::move(levels);
+        this->count = header.count;
+
+        return true;
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: LevelCountFor
+    // Desc: How many levels Build makes over count samples: one of blocks, then halving down to a single node
+    //-----------------------------------------------------------------------------------------------------------------
+    static uint64_t LevelCountFor(uint64_t count) {
+
+        if (count == 0) {
+            return 0;
+        }
+
+        uint64_t levelCount = 1;
+
+        for (auto levelSize = (count + blockSize - 1) / blockSize; levelSize > 1; levelSize = (levelSize + 1) / 2) {
+            levelCount++;
+        }
+
+        return levelCount;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: BuildBlocks
+    // Desc: Level 0 nodes [firstBlock, lastBlock)
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Samples>
+    void BuildBlocks(const Samples& yData, size_t firstBlock, size_t lastBlock) {
+
+        auto& nodes = this->levels[0];
+
+        for (auto block = firstBlock; block < lastBlock; block++) {
+
+            MinMax node = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+            Scan(yData, block * blockSize, std::min(this->count, (block + 1) * blockSize), node);
+
+            nodes[block] = node;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: BuildLevelsAbove
+    // Desc: Rebuilds every node above level 0 that covers a level 0 node at or after firstDirty
+    //-----------------------------------------------------------------------------------------------------------------
+    void BuildLevelsAbove(size_t firstDirty) {
+
+        for (size_t level = 0; this->levels[level].size() > 1; level++) {
+
+            auto parentSize = (this->levels[level].size() + 1) / 2;
+
+            if (this->levels.size() <= level + 1) {
+                this->levels.emplace_back();
+            }
+
+            firstDirty /= 2;
+
+            auto& children = this->levels[level];
+            auto& parents = this->levels[level + 1];
+
+            parents.resize(parentSize);
+
+            for (auto parent = firstDirty; parent < parentSize; parent++) {
+
+                parents[parent] = children[parent * 2];
+
+                if (parent * 2 + 1 < children.size()) {
+                    Combine(parents[parent], children[parent * 2 + 1]);
+                }
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Scan
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Samples>
+    static void Scan(const Samples& yData, size_t begin, size_t end, MinMax& result) {
+
+        SampleRange(yData, begin, end, result.min, result.max);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Combine
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    static void Combine(MinMax& result, const MinMax& node) {
+        result.min = std::min(result.min, node.min);
+        result.max = std::max(result.max, node.max);
+    }
+};
+
+#endif // MINMAXPYRAMID_H
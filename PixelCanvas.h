@@ -0,0 +1,867 @@
+// PixelCanvas.h
+#ifndef PIXELCANVAS_H
+#define PIXELCANVAS_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PIXELCANVAS_SSE2
+#endif
+
+#include "SDL.h"
+
+#include "ThreadPool.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: PackCanvasColor
+// Desc: Canvas pixels are r, g, b, a bytes in memory whatever the byte order, which is the rmask/gmask/bmask/amask
+//       layout in PlotUtility.h
+//---------------------------------------------------------------------------------------------------------------------
+inline uint32_t PackCanvasColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    uint8_t bytes[4] = {r, g, b, a};
+    uint32_t pixel;
+    memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+inline uint32_t PackCanvasColor(SDL_Color color) {
+    return PackCanvasColor(color.r, color.g, color.b, color.a);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: Div255
+// Desc: x / 255 rounded to nearest, exact for anything up to 255 * 255
+//---------------------------------------------------------------------------------------------------------------------
+inline uint32_t Div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: BlendCanvasPixel
+// Desc: SDL_BLENDMODE_BLEND of color over pixel with alpha in place of color's own. Integer only, so the same inputs
+//       give the same pixel on every machine.
+//---------------------------------------------------------------------------------------------------------------------
+inline void BlendCanvasPixel(uint32_t* pixel, uint32_t color, uint32_t alpha) {
+
+    uint8_t source[4];
+    uint8_t dest[4];
+
+    memcpy(source, &color, sizeof(source));
+    memcpy(dest, pixel, sizeof(dest));
+
+    auto inverse = 255 - alpha;
+
+    dest[0] = Div255(source[0] * alpha + dest[0] * inverse);
+    dest[1] = Div255(source[1] * alpha + dest[1] * inverse);
+    dest[2] = Div255(source[2] * alpha + dest[2] * inverse);
+    dest[3] = Div255(255 * alpha + dest[3] * inverse);
+
+    memcpy(pixel, dest, sizeof(dest));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FillSpanScalar
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------
+inline void FillSpanScalar(uint32_t* span, size_t count, uint32_t color) {
+    for (size_t i = 0; i < count; i++) {
+        span[i] = color;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: BlendSpanScalar
+// Desc: color blended over count pixels with its own alpha
+//---------------------------------------------------------------------------------------------------------------------
+inline void BlendSpanScalar(uint32_t* span, size_t count, uint32_t color) {
+
+    uint8_t bytes[4];
+    memcpy(bytes, &color, sizeof(bytes));
+
+    for (size_t i = 0; i < count; i++) {
+        BlendCanvasPixel(span + i, color, bytes[3]);
+    }
+}
+
+#ifdef PIXELCANVAS_SSE2
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FillSpanSSE2
+// Desc: Four pixels per store
+//---------------------------------------------------------------------------------------------------------------------
+inline void FillSpanSSE2(uint32_t* span, size_t count, uint32_t color) {
+
+    auto colors = _mm_set1_epi32(static_cast<int>(color));
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(span + i), colors);
+    }
+
+    FillSpanScalar(span + i, count - i, color);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: BlendSpanSSE2
+// Desc: Four pixels at a time widened to 16 bit lanes. Same arithmetic as BlendCanvasPixel so the result is
+//       identical to BlendSpanScalar.
+//---------------------------------------------------------------------------------------------------------------------
+inline void BlendSpanSSE2(uint32_t* span, size_t count, uint32_t color) {
+
+    uint8_t bytes[4];
+    memcpy(bytes, &color, sizeof(bytes));
+
+    uint16_t alpha = bytes[3];
+    uint16_t inverse = 255 - alpha;
+
+    // source * alpha with 255 in place of the source alpha, see BlendCanvasPixel
+    auto sourceTerm = _mm_setr_epi16(bytes[0] * alpha, bytes[1] * alpha, bytes[2] * alpha, 255 * alpha,
+                                     bytes[0] * alpha, bytes[1] * alpha, bytes[2] * alpha, 255 * alpha);
+
+    auto inverses = _mm_set1_epi16(inverse);
+    auto rounding = _mm_set1_epi16(128);
+    auto zero = _mm_setzero_si128();
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+
+        auto dest = _mm_loadu_si128(reinterpret_cast<const __m128i*>(span + i));
+
+        auto low = _mm_unpacklo_epi8(dest, zero);
+        auto high = _mm_unpackhi_epi8(dest, zero);
+
+        low = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(low, inverses), sourceTerm), rounding);
+        high = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(high, inverses), sourceTerm), rounding);
+
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(span + i), _mm_packus_epi16(low, high));
+    }
+
+    BlendSpanScalar(span + i, count - i, color);
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FillSpan
+// Desc: Opaque colors overwrite, anything else is blended
+//---------------------------------------------------------------------------------------------------------------------
+inline void FillSpan(uint32_t* span, size_t count, uint32_t color) {
+
+    uint8_t bytes[4];
+    memcpy(bytes, &color, sizeof(bytes));
+
+    if (bytes[3] == 0) {
+        return;
+    }
+
+#ifdef PIXELCANVAS_SSE2
+    if (bytes[3] == 255) {
+        FillSpanSSE2(span, count, color);
+    } else {
+        BlendSpanSSE2(span, count, color);
+    }
+#else
+    if (bytes[3] == 255) {
+        FillSpanScalar(span, count, color);
+    } else {
+        BlendSpanScalar(span, count, color);
+    }
+#endif
+}
+
+// CanvasVertex
+struct CanvasVertex {
+    float x;
+    float y;
+    SDL_Color color;
+};
+
+// how far off the canvas a triangle's corners can be, in pixels, before they're pulled in. Keeps every edge function and
+// color weight FillTriangle works out inside a long long.
+const float canvasCoordinateLimit = 65536.0f;
+
+// CanvasTriangle
+// A triangle set up for rasterizing: 24.8 fixed point corners wound the same way and the rows it covers
+struct CanvasTriangle {
+    long long x[3];
+    long long y[3];
+    long long area;
+
+    SDL_Color color[3];
+
+    int firstRow;
+    int lastRow;
+};
+
+// CanvasCommandType
+enum class CanvasCommandType {
+    Clear,
+    Rects,
+    Points,
+    Polyline,
+    Triangles,
+    Mask,
+    Copy
+};
+
+// CanvasCommand
+// Arguments index into the canvas's recorded rects/points/triangles
+struct CanvasCommand {
+    CanvasCommandType type;
+    uint32_t color;
+
+    size_t first;
+    size_t count;
+
+    // Mask: alpha bitmap, its size and pitch and where it goes. rotateLeft turns it 90 degrees counter clockwise
+    const uint8_t* mask;
+    int width;
+    int height;
+    int pitch;
+    int x;
+    int y;
+    bool rotateLeft;
+
+    // Copy: the first rect of source goes to the same place on this canvas
+    const class PixelCanvas* source;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: PixelCanvas
+// Desc: 32 bit pixel buffer that rasterizes without an SDL_Renderer. Draw calls are only recorded, Render then splits
+//       the canvas into horizontal tiles and runs every command over each tile, on a ThreadPool when it has one.
+//       Each pixel belongs to exactly one tile and all of the arithmetic is integer, so the output is the same for
+//       any number of threads and on any machine.
+//---------------------------------------------------------------------------------------------------------------------
+class PixelCanvas {
+
+    static const int tileHeight = 32;
+
+    std::vector<uint32_t> pixels;
+    int width;
+    int height;
+
+    ThreadPool* threadPool;
+
+    std::vector<CanvasCommand> commands;
+
+    std::vector<SDL_Rect> rects;
+    std::vector<SDL_Point> points;
+    std::vector<CanvasTriangle> triangles;
+
+    std::function<void(size_t)> renderTile;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: PixelCanvas
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    PixelCanvas(int width = 0, int height = 0, ThreadPool* threadPool = nullptr) : width(0), height(0), threadPool(threadPool) {
+        this->Resize(width, height);
+        this->renderTile = [this] (size_t tile) { this->RenderTile(tile); };
+    }
+
+    PixelCanvas(const PixelCanvas&) = delete;
+    PixelCanvas& operator=(const PixelCanvas&) = delete;
+
+    int Width() const { return this->width; }
+    int Height() const { return this->height; }
+
+    // rows are width pixels apart
+    uint32_t* Pixels() { return this->pixels.data(); }
+    const uint32_t* Pixels() const { return this->pixels.data(); }
+    int Pitch() const { return this->width * 4; }
+
+    ThreadPool* GetThreadPool() const { return this->threadPool; }
+    void SetThreadPool(ThreadPool* threadPool) { this->threadPool = threadPool; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Resize
+    // Desc: Contents are undefined afterwards, anything recorded is dropped
+    //-----------------------------------------------------------------------------------------------------------------
+    void Resize(int width, int height) {
+        this->width = std::max(0, width);
+        this->height = std::max(0, height);
+        this->pixels.resize(static_cast<size_t>(this->width) * this->height);
+        this->Discard();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Clear
+    // Desc: Every pixel to color, no blending
+    //-----------------------------------------------------------------------------------------------------------------
+    void Clear(uint32_t color) {
+        auto& command = this->AddCommand(CanvasCommandType::Clear, color);
+        command.count = 0;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FillRects
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void FillRects(const SDL_Rect* rects, size_t count, uint32_t color) {
+        auto& command = this->AddCommand(CanvasCommandType::Rects, color);
+        command.first = this->rects.size();
+        command.count = count;
+        this->rects.insert(this->rects.end(), rects, rects + count);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: DrawPoints
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void DrawPoints(const SDL_Point* points, size_t count, uint32_t color) {
+        auto& command = this->AddCommand(CanvasCommandType::Points, color);
+        command.first = this->points.size();
+        command.count = count;
+        this->points.insert(this->points.end(), points, points + count);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: DrawLines
+    // Desc: Connected line through every point, shared points are only drawn once
+    //-----------------------------------------------------------------------------------------------------------------
+    void DrawLines(const SDL_Point* points, size_t count, uint32_t color) {
+        auto& command = this->AddCommand(CanvasCommandType::Polyline, color);
+        command.first = this->points.size();
+        command.count = count;
+        this->points.insert(this->points.end(), points, points + count);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FillTriangles
+    // Desc: Triangles with colors interpolated across them and blended, like SDL_RenderGeometry without a texture.
+    //       Triangles with an index outside [0, vertexCount) are skipped.
+    //-----------------------------------------------------------------------------------------------------------------
+    void FillTriangles(const CanvasVertex* vertices, size_t vertexCount, const int* indices, size_t indexCount) {
+
+        auto& command = this->AddCommand(CanvasCommandType::Triangles, 0);
+        command.first = this->triangles.size();
+
+        // set up once here rather than again in every tile. Clamped first so the cast is defined for anything, NaN
+        // included
+        auto fixed = [] (float value) {
+            value = (value > -canvasCoordinateLimit) ? std::min(value, canvasCoordinateLimit) : -canvasCoordinateLimit;
+            return static_cast<long long>(std::floor(value * 256.0f + 0.5f));
+        };
+
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+
+            if (indices[i] < 0 || indices[i + 1] < 0 || indices[i + 2] < 0 || 
+                static_cast<size_t>(indices[i]) >= vertexCount || static_cast<size_t>(indices[i + 1]) >= vertexCount || static_cast<size_t>(indices[i + 2]) >= vertexCount) {
+                continue;
+            }
+
+            CanvasTriangle triangle;
+
+            for (auto corner = 0; corner < 3; corner++) {
+                auto& vertex = vertices[indices[i + corner]];
+                triangle.x[corner] = fixed(vertex.x);
+                triangle.y[corner] = fixed(vertex.y);
+                triangle.color[corner] = vertex.color;
+            }
+
+            triangle.area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+
+            if (triangle.area == 0) {
+                continue;
+            }
+
+            // wind them all the same way
+            if (triangle.area < 0) {
+                std::swap(triangle.x[1], triangle.x[2]);
+                std::swap(triangle.y[1], triangle.y[2]);
+                std::swap(triangle.color[1], triangle.color[2]);
+                triangle.area = -triangle.area;
+            }
+
+            triangle.firstRow = static_cast<int>((std::min({triangle.y[0], triangle.y[1], triangle.y[2]}) >> 8) - 1);
+            triangle.lastRow = static_cast<int>((std::max({triangle.y[0], triangle.y[1], triangle.y[2]}) >> 8) + 1);
+
+            this->triangles.push_back(triangle);
+        }
+
+        command.count = this->triangles.size() - command.first;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: DrawMask
+    // Desc: color with its alpha scaled by an 8 bit coverage bitmap, for text. The bitmap isn't copied so it has to
+    //       outlive the next Render.
+    //-----------------------------------------------------------------------------------------------------------------
+    void DrawMask(const uint8_t* mask, int width, int height, int pitch, int x, int y, uint32_t color, bool rotateLeft = false) {
+        auto& command = this->AddCommand(CanvasCommandType::Mask, color);
+        command.mask = mask;
+        command.width = width;
+        command.height = height;
+        command.pitch = pitch;
+        command.x = x;
+        command.y = y;
+        command.rotateLeft = rotateLeft;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Copy
+    // Desc: Copies rect of source to the same place on this canvas, no blending. source has to stay unchanged until
+    //       the next Render.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Copy(const PixelCanvas& source, const SDL_Rect& rect) {
+        auto& command = this->AddCommand(CanvasCommandType::Copy, 0);
+        command.source = &source;
+        command.first = this->rects.size();
+        command.count = 1;
+        this->rects.push_back(rect);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Render
+    // Desc: Runs everything recorded since the last Render
+    //-----------------------------------------------------------------------------------------------------------------
+    void Render() {
+
+        if (this->commands.empty() || this->width == 0 || this->height == 0) {
+            this->Discard();
+            return;
+        }
+
+        auto tileCount = static_cast<size_t>((this->height + tileHeight - 1) / tileHeight);
+
+        if (this->threadPool != nullptr) {
+            this->threadPool->ParallelFor(tileCount, this->renderTile);
+        } else {
+            for (size_t tile = 0; tile < tileCount; tile++) {
+                this->RenderTile(tile);
+            }
+        }
+
+        this->Discard();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Discard
+    // Desc: Drops everything recorded without drawing it
+    //-----------------------------------------------------------------------------------------------------------------
+    void Discard() {
+        this->commands.clear();
+        this->rects.clear();
+        this->points.clear();
+        this->triangles.clear();
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddCommand
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    CanvasCommand& AddCommand(CanvasCommandType type, uint32_t color) {
+
+        CanvasCommand command;
+        memset(&command, 0, sizeof(command));
+
+        command.type = type;
+        command.color = color;
+
+        this->commands.push_back(command);
+        return this->commands.back();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: RenderTile
+    // Desc: Every command, clipped to rows [tile * tileHeight, (tile + 1) * tileHeight)
+    //-----------------------------------------------------------------------------------------------------------------
+    void RenderTile(size_t tile) {
+
+        auto rowBegin = static_cast<int>(tile) * tileHeight;
+        auto rowEnd = std::min(this->height, rowBegin + tileHeight);
+
+        for (auto& command : this->commands) {
+
+            switch (command.type) {
+
+                case CanvasCommandType::Clear:
+                    FillSpanSSE2OrScalar(this->pixels.data() + static_cast<size_t>(rowBegin) * this->width,
+                        static_cast<size_t>(rowEnd - rowBegin) * this->width, command.color);
+                    break;
+
+                case CanvasCommandType::Rects:
+                    for (auto i = command.first; i < command.first + command.count; i++) {
+                        this->FillRect(this->rects[i], rowBegin, rowEnd, command.color);
+                    }
+                    break;
+
+                case CanvasCommandType::Points:
+                    for (auto i = command.first; i < command.first + command.count; i++) {
+                        auto& point = this->points[i];
+                        if (point.y >= rowBegin && point.y < rowEnd) {
+                            this->PlotPixel(point.x, point.y, command.color);
+                        }
+                    }
+                    break;
+
+                case CanvasCommandType::Polyline:
+                    for (auto i = command.first + 1; i < command.first + command.count; i++) {
+                        this->DrawLine(this->points[i - 1], this->points[i], i > command.first + 1, rowBegin, rowEnd, command.color);
+                    }
+                    if (command.count == 1) {
+                        this->DrawLine(this->points[command.first], this->points[command.first], false, rowBegin, rowEnd, command.color);
+                    }
+                    break;
+
+                case CanvasCommandType::Triangles:
+                    for (auto i = command.first; i < command.first + command.count; i++) {
+                        auto& triangle = this->triangles[i];
+                        if (triangle.lastRow >= rowBegin && triangle.firstRow < rowEnd) {
+                            this->FillTriangle(triangle, rowBegin, rowEnd);
+                        }
+                    }
+                    break;
+
+                case CanvasCommandType::Mask:
+                    this->DrawMaskRows(command, rowBegin, rowEnd);
+                    break;
+
+                case CanvasCommandType::Copy:
+                    this->CopyRows(*command.source, this->rects[command.first], rowBegin, rowEnd);
+                    break;
+            }
+        }
+    }
+
+    // a clear overwrites whatever the alpha is
+    static void FillSpanSSE2OrScalar(uint32_t* span, size_t count, uint32_t color) {
+#ifdef PIXELCANVAS_SSE2
+        FillSpanSSE2(span, count, color);
+#else
+        FillSpanScalar(span, count, color);
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: PlotPixel
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void PlotPixel(int x, int y, uint32_t color) {
+
+        if (x < 0 || x >= this->width || y < 0 || y >= this->height) {
+            return;
+        }
+
+        auto pixel = this->pixels.data() + static_cast<size_t>(y) * this->width + x;
+        auto alpha = color >> 24;
+
+        if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+            alpha = color & 0xff;
+        }
+
+        if (alpha == 255) {
+            *pixel = color;
+        } else if (alpha != 0) {
+            BlendCanvasPixel(pixel, color, alpha);
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FillRect
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void FillRect(const SDL_Rect& rect, int rowBegin, int rowEnd, uint32_t color) {
+
+        auto x1 = std::max(0, rect.x);
+        auto x2 = std::min(this->width, rect.x + rect.w);
+        auto y1 = std::max(rowBegin, rect.y);
+        auto y2 = std::min(rowEnd, rect.y + rect.h);
+
+        for (auto y = y1; y < y2 && x1 < x2; y++) {
+            FillSpan(this->pixels.data() + static_cast<size_t>(y) * this->width + x1, x2 - x1, color);
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: DrawLine
+    // Desc: One pixel per step along the major axis with the minor coordinate at step * minor / major rounded half
+    //       away from zero. That's worked out once for the first step in the tile and then carried forward as a
+    //       quotient and remainder, so every tile lands on the same pixels however far along the line it starts.
+    //-----------------------------------------------------------------------------------------------------------------
+    void DrawLine(const SDL_Point& from, const SDL_Point& to, bool skipFirst, int rowBegin, int rowEnd, uint32_t color) {
+
+        if (std::max(from.y, to.y) < rowBegin || std::min(from.y, to.y) >= rowEnd) {
+            return;
+        }
+
+        long long dx = to.x - from.x;
+        long long dy = to.y - from.y;
+
+        auto steps = std::max(std::abs(dx), std::abs(dy));
+        long long first = skipFirst ? 1 : 0;
+        long long last = steps;
+
+        if (steps == 0) {
+            if (!skipFirst) {
+                this->PlotPixel(from.x, from.y, color);
+            }
+            return;
+        }
+
+        // straight runs, which is most of what M4 decimated series draw
+        if (dy == 0) {
+
+            auto left = std::max<long long>(0, std::min<long long>(from.x + (skipFirst ? (dx > 0 ? 1 : -1) : 0), to.x));
+            auto right = std::min<long long>(this->width - 1, std::max<long long>(from.x + (skipFirst ? (dx > 0 ? 1 : -1) : 0), to.x));
+
+            if (from.y >= 0 && from.y < this->height && left <= right) {
+                FillSpan(this->pixels.data() + static_cast<size_t>(from.y) * this->width + left, right - left + 1, color);
+            }
+            return;
+        }
+
+        if (dx == 0) {
+
+            auto startY = from.y + (skipFirst ? (dy > 0 ? 1 : -1) : 0);
+            auto top = std::max({0, rowBegin, std::min(startY, to.y)});
+            auto bottom = std::min({this->height - 1, rowEnd - 1, std::max(startY, to.y)});
+
+            if (from.x < 0 || from.x >= this->width) {
+                return;
+            }
+
+            for (auto y = top; y <= bottom; y++) {
+                this->PlotPixel(from.x, y, color);
+            }
+            return;
+        }
+
+        auto yMajor = std::abs(dy) >= std::abs(dx);
+
+        auto major = yMajor ? dy : dx;
+        auto minor = yMajor ? dx : dy;
+        auto majorSign = (major > 0) ? 1 : -1;
+        auto minorSign = (minor >= 0) ? 1 : -1;
+        auto minorLength = std::abs(minor);
+
+        if (yMajor) {
+            // only the steps that land inside the tile
+            auto stepBegin = (majorSign > 0) ? rowBegin - from.y : from.y - (rowEnd - 1);
+            auto stepEnd = (majorSign > 0) ? rowEnd - 1 - from.y : from.y - rowBegin;
+
+            first = std::max<long long>(first, stepBegin);
+            last = std::min<long long>(last, stepEnd);
+        }
+
+        if (first > last) {
+            return;
+        }
+
+        // minor offset at step is (2 * step * minorLength + steps) / (2 * steps), rounded down
+        auto denominator = 2 * steps;
+        auto numerator = 2 * first * minorLength + steps;
+        auto quotient = numerator / denominator;
+        auto remainder = numerator % denominator;
+
+        for (auto step = first; step <= last; step++) {
+
+            auto majorOffset = static_cast<int>(majorSign * step);
+            auto minorOffset = static_cast<int>(minorSign * quotient);
+
+            if (yMajor) {
+                this->PlotPixel(from.x + minorOffset, from.y + majorOffset, color);
+            } else {
+                auto y = from.y + minorOffset;
+                if (y >= rowBegin && y < rowEnd) {
+                    this->PlotPixel(from.x + majorOffset, y, color);
+                }
+            }
+
+            // minorLength <= steps so this never carries more than once
+            remainder += 2 * minorLength;
+
+            if (remainder >= denominator) {
+                remainder -= denominator;
+                quotient++;
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FillTriangle
+    // Desc: Edge functions in 24.8 fixed point sampled at pixel centers with a top-left fill rule, so triangles sharing
+    //       an edge never both draw a pixel on it. Triangles are convex so each row is one span; a single color fills
+    //       it with FillSpan, otherwise colors are interpolated with integer barycentric weights.
+    //-----------------------------------------------------------------------------------------------------------------
+    void FillTriangle(const CanvasTriangle& triangle, int rowBegin, int rowEnd) {
+
+        auto ax = triangle.x[0], ay = triangle.y[0];
+        auto bx = triangle.x[1], by = triangle.y[1];
+        auto cx = triangle.x[2], cy = triangle.y[2];
+        auto area = triangle.area;
+
+        auto minY = std::max<long long>(rowBegin, triangle.firstRow);
+        auto maxY = std::min<long long>(rowEnd - 1, triangle.lastRow);
+
+        auto minX = std::max<long long>(0, (std::min({ax, bx, cx}) >> 8) - 1);
+        auto maxX = std::min<long long>(this->width - 1, (std::max({ax, bx, cx}) >> 8) + 1);
+
+        // an edge owns the pixels exactly on it when it's a top or a left edge
+        auto bias = [] (long long x1, long long y1, long long x2, long long y2) {
+            auto top = (y1 == y2) && (x2 < x1);
+            auto left = (y2 > y1);
+            return (top || left) ? 0 : -1;
+        };
+
+        long long bias0 = bias(bx, by, cx, cy);
+        long long bias1 = bias(cx, cy, ax, ay);
+        long long bias2 = bias(ax, ay, bx, by);
+
+        // how much each edge function changes for a step of one pixel in x
+        auto step0 = -(cy - by) * 256;
+        auto step1 = -(ay - cy) * 256;
+        auto step2 = -(by - ay) * 256;
+
+        auto& c0 = triangle.color[0];
+        auto& c1 = triangle.color[1];
+        auto& c2 = triangle.color[2];
+
+        auto sameRGB = (c0.r == c1.r && c0.r == c2.r && c0.g == c1.g && c0.g == c2.g && c0.b == c1.b && c0.b == c2.b);
+        auto sameAlpha = (c0.a == c1.a && c0.a == c2.a);
+
+        auto solid = PackCanvasColor(c0);
+
+        for (auto y = minY; y <= maxY; y++) {
+
+            auto py = y * 256 + 128;
+            auto px = minX * 256 + 128;
+
+            auto w0 = (cx - bx) * (py - by) - (cy - by) * (px - bx) + bias0;
+            auto w1 = (ax - cx) * (py - cy) - (ay - cy) * (px - cx) + bias1;
+            auto w2 = (bx - ax) * (py - ay) - (by - ay) * (px - ax) + bias2;
+
+            // first pixel in the span
+            auto x = minX;
+
+            while (x <= maxX && (w0 < 0 || w1 < 0 || w2 < 0)) {
+                w0 += step0;
+                w1 += step1;
+                w2 += step2;
+                x++;
+            }
+
+            auto row = this->pixels.data() + static_cast<size_t>(y) * this->width;
+
+            if (sameRGB && sameAlpha) {
+
+                auto end = x;
+                auto e0 = w0, e1 = w1, e2 = w2;
+
+                while (end <= maxX && e0 >= 0 && e1 >= 0 && e2 >= 0) {
+                    e0 += step0;
+                    e1 += step1;
+                    e2 += step2;
+                    end++;
+                }
+
+                if (end > x) {
+                    FillSpan(row + x, static_cast<size_t>(end - x), solid);
+                }
+
+                continue;
+            }
+
+            for (; x <= maxX && w0 >= 0 && w1 >= 0 && w2 >= 0; x++, w0 += step0, w1 += step1, w2 += step2) {
+
+                // weights without the fill rule bias, they add up to area
+                auto u0 = w0 - bias0;
+                auto u1 = w1 - bias1;
+                auto u2 = w2 - bias2;
+
+                uint8_t color[4];
+                color[3] = static_cast<uint8_t>((c0.a * u0 + c1.a * u1 + c2.a * u2) / area);
+
+                if (color[3] == 0) {
+                    continue;
+                }
+
+                if (sameRGB) {
+                    color[0] = c0.r;
+                    color[1] = c0.g;
+                    color[2] = c0.b;
+                } else {
+                    color[0] = static_cast<uint8_t>((c0.r * u0 + c1.r * u1 + c2.r * u2) / area);
+                    color[1] = static_cast<uint8_t>((c0.g * u0 + c1.g * u1 + c2.g * u2) / area);
+                    color[2] = static_cast<uint8_t>((c0.b * u0 + c1.b * u1 + c2.b * u2) / area);
+                }
+
+                uint32_t packed;
+                memcpy(&packed, color, sizeof(packed));
+
+                BlendCanvasPixel(row + x, packed, color[3]);
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: DrawMaskRows
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void DrawMaskRows(const CanvasCommand& command, int rowBegin, int rowEnd) {
+
+        uint8_t bytes[4];
+        memcpy(bytes, &command.color, sizeof(bytes));
+
+        // rotated left the mask is height wide and width high, and its first column ends up as the bottom row
+        auto outWidth = command.rotateLeft ? command.height : command.width;
+        auto outHeight = command.rotateLeft ? command.width : command.height;
+
+        auto y1 = std::max(rowBegin, command.y);
+        auto y2 = std::min(rowEnd, command.y + outHeight);
+        auto x1 = std::max(0, command.x);
+        auto x2 = std::min(this->width, command.x + outWidth);
+
+        for (auto y = y1; y < y2; y++) {
+
+            auto row = this->pixels.data() + static_cast<size_t>(y) * this->width;
+
+            for (auto x = x1; x < x2; x++) {
+
+                auto u = x - command.x;
+                auto v = y - command.y;
+
+                auto coverage = command.rotateLeft ? command.mask[u * command.pitch + (outHeight - 1 - v)] : command.mask[v * command.pitch + u];
+                auto alpha = Div255(coverage * bytes[3]);
+
+                if (alpha != 0) {
+                    BlendCanvasPixel(row + x, command.color, alpha);
+                }
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: CopyRows
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void CopyRows(const PixelCanvas& source, const SDL_Rect& rect, int rowBegin, int rowEnd) {
+
+        auto x1 = std::max(0, rect.x);
+        auto x2 = std::min({this->width, source.width, rect.x + rect.w});
+        auto y1 = std::max(rowBegin, rect.y);
+        auto y2 = std::min({rowEnd, source.height, rect.y + rect.h});
+
+        for (auto y = y1; y < y2 && x1 < x2; y++) {
+            memcpy(this->pixels.data() + static_cast<size_t>(y) * this->width + x1,
+                source.pixels.data() + static_cast<size_t>(y) * source.width + x1, (x2 - x1) * sizeof(uint32_t));
+        }
+    }
+};
+
+#endif // PIXELCANVAS_H
@@ -0,0 +1,498 @@
+// PlotPipeline.h
+#ifndef PLOTPIPELINE_H
+#define PLOTPIPELINE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include "CsvImport.h"
+#include "MinMaxPyramid.h"
+#include "SDLPlot.h"
+#include "SDL.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SpscQueue
+// Desc: Fixed size lock free queue between exactly one producer thread and one consumer thread. Values are moved in
+//       and out, so a queue of vectors hands buffers over without copying them.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+class SpscQueue {
+
+    std::vector<T> slots;
+    size_t mask;
+
+    // head is only written by the consumer and tail by the producer, kept a cache line apart so they don't bounce
+    std::atomic<size_t> head;
+    char padding[64];
+    std::atomic<size_t> tail;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: SpscQueue
+    // Desc: capacity is rounded up to a power of two
+    //-----------------------------------------------------------------------------------------------------------------
+    SpscQueue(size_t capacity) : head(0), tail(0) {
+
+        size_t size = 1;
+
+        while (size < capacity) {
+            size *= 2;
+        }
+
+        this->slots.resize(size);
+        this->mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: TryPush
+    // Desc: Producer only. Moves value in and returns true, or leaves it alone and returns false when full.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool TryPush(T& value) {
+
+        auto tail = this->tail.load(std::memory_order_relaxed);
+
+        if (tail - this->head.load(std::memory_order_acquire) == this->slots.size()) {
+            return false;
+        }
+
+        this->slots[tail & this->mask] = std::move(value);
+        this->tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: TryPop
+    // Desc: Consumer only. Moves the oldest value out into value, false when empty.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool TryPop(T& value) {
+
+        auto head = this->head.load(std::memory_order_relaxed);
+
+        if (head == this->tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        value = std::move(this->slots[head & this->mask]);
+        this->head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SnapshotBuffer
+// Desc: Latest value handover from one writer thread to one reader thread, three buffers so neither ever waits: the
+//       writer fills Back() and publishes it, the reader takes whatever was published last and reads it through
+//       Front() until it takes another. Snapshots the reader never got to are skipped, not queued.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+class SnapshotBuffer {
+
+    T buffers[3];
+
+    unsigned int back;                  // writer's
+    unsigned int front;                 // reader's
+
+    // the one in between, with freshBit set when it was published after the reader last took one
+    std::atomic<unsigned int> middle;
+
+    static const unsigned int freshBit = 4;
+
+public:
+
+    SnapshotBuffer() : back(0), front(1), middle(2) {}
+
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+    T& Back() { return this->buffers[this->back]; }
+    const T& Front() const { return this->buffers[this->front]; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Publish
+    // Desc: Writer only. Back() becomes the newest snapshot and the writer gets another buffer to fill, which holds
+    //       some older snapshot.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Publish() {
+        this->back = this->middle.exchange(this->back | freshBit, std::memory_order_acq_rel) & ~freshBit;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Take
+    // Desc: Reader only. Moves Front() on to the newest snapshot, returns false if there's nothing newer.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Take() {
+
+        if ((this->middle.load(std::memory_order_relaxed) & freshBit) == 0) {
+            return false;
+        }
+
+        this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & ~freshBit;
+        return true;
+    }
+};
+
+// PlotViewport
+// What the main thread wants drawn: samples [begin, end), sliding along with new samples while following the same way
+// PlotViewer::Grow does, laid out like an SDLPlot with this configuration
+struct PlotViewport {
+    size_t begin;
+    size_t end;
+    bool following;
+
+    SDLPlotConfiguration layout;
+
+    PlotViewport() : begin(0), end(0), following(true) {
+        this->layout.plotWidth = 0;
+        this->layout.plotHeight = 0;
+        this->layout.leftMargin = 0;
+        this->layout.rightMargin = 0;
+        this->layout.topMargin = 0;
+        this->layout.bottomMargin = 0;
+    }
+};
+
+// PlotFrame
+// A polyline ready for SDLPlot::PlotPoints: samples [begin, end) of the count loaded so far, ranging from min to max
+struct PlotFrame {
+    std::vector<SDL_Point> points;
+
+    size_t begin;
+    size_t end;
+    size_t count;
+
+    double min;
+    double max;
+
+    PlotFrame() : begin(0), end(0), count(0), min(0.0), max(0.0) {}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: PlotPipeline
+// Desc: Keeps loading and decimation off the thread that draws. A loader thread parses the csv in chunks and queues
+//       them to a worker thread, which owns the samples and their pyramid and turns the latest viewport into a screen
+//       space polyline. The main thread only posts viewports and draws whichever frame came out last, so the window
+//       stays responsive however big the file is and fills in as chunks arrive. Nothing is shared under a lock: the
+//       stages talk through SpscQueues and SnapshotBuffers, the mutex only parks the worker when it's idle.
+//---------------------------------------------------------------------------------------------------------------------
+class PlotPipeline {
+
+    // loader -> worker: parsed quotes, and the emptied vectors back again so the loader doesn't allocate
+    SpscQueue<std::vector<double>> chunks;
+    SpscQueue<std::vector<double>> emptyChunks;
+
+    // main -> worker and worker -> main
+    SnapshotBuffer<PlotViewport> viewports;
+    SnapshotBuffer<PlotFrame> frames;
+
+    std::thread loader;
+    std::thread worker;
+    std::atomic<bool> stop;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool woken;
+
+    // pushed to the SDL event queue when a frame is published so the main thread's wait ends, -1 without SDL
+    Uint32 frameEvent;
+    std::atomic<bool> framePending;
+
+    // only touched by the worker once it's running
+    std::vector<double> yData;
+    MinMaxPyramid pyramid;
+    std::vector<M4Column> columns;
+    std::vector<int> columnX;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: PlotPipeline
+    // Desc: Up to queueLength parsed chunks can wait for the worker before the loader has to
+    //-----------------------------------------------------------------------------------------------------------------
+    PlotPipeline(size_t queueLength = 64)
+        : chunks(queueLength), emptyChunks(queueLength), stop(false), woken(false), frameEvent((Uint32) -1), framePending(false) {}
+
+    PlotPipeline(const PlotPipeline&) = delete;
+    PlotPipeline& operator=(const PlotPipeline&) = delete;
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ~PlotPipeline
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    ~PlotPipeline() {
+        this->Stop();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Start
+    // Desc: Loads csvPath chunkRows rows at a time and keeps following it for appended rows until Stop
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Start(const std::string& csvPath, size_t chunkRows = 65536) {
+
+        if (!std::ifstream(csvPath).is_open()) {
+            std::cout << "Error opening file.";
+            return false;
+        }
+
+        this->StartWorker();
+        this->loader = std::thread([this, csvPath, chunkRows] () { this->Load(csvPath, chunkRows); });
+
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Start
+    // Desc: A fixed series, nothing to load
+    //-----------------------------------------------------------------------------------------------------------------
+    void Start(std::vector<double> yData) {
+        this->yData = std::move(yData);
+        this->StartWorker();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Stop
+    // Desc: Waits for both threads, the loader can take up to its poll interval to notice
+    //-----------------------------------------------------------------------------------------------------------------
+    void Stop() {
+
+        this->stop = true;
+        this->Wake();
+
+        if (this->loader.joinable()) {
+            this->loader.join();
+        }
+
+        if (this->worker.joinable()) {
+            this->worker.join();
+        }
+    }
+
+    Uint32 FrameEvent() const { return this->frameEvent; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: SetViewport
+    // Desc: Main thread only. The worker rebuilds the frame for it as soon as it's free.
+    //-----------------------------------------------------------------------------------------------------------------
+    void SetViewport(const PlotViewport& viewport) {
+        this->viewports.Back() = viewport;
+        this->viewports.Publish();
+        this->Wake();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: TakeFrame
+    // Desc: Main thread only. Moves Frame() on to the newest one the worker has built, false if there isn't a newer one
+    //-----------------------------------------------------------------------------------------------------------------
+    bool TakeFrame() {
+        this->framePending = false;
+        return this->frames.Take();
+    }
+
+    // a different buffer after every TakeFrame, so don't hold on to it across one
+    const PlotFrame& Frame() const { return this->frames.Front(); }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: StartWorker
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void StartWorker() {
+
+        // SDL hands out event types once it's initialised, the pipeline works without it but nobody gets woken
+        if (SDL_WasInit(SDL_INIT_EVENTS) != 0) {
+            this->frameEvent = SDL_RegisterEvents(1);
+        }
+
+        this->stop = false;
+        this->worker = std::thread([this] () { this->Work(); });
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Wake
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void Wake() {
+
+        {
+            std::lock_guard<std::mutex> lock(this->wakeMutex);
+            this->woken = true;
+        }
+
+        this->wake.notify_one();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Load
+    // Desc: Loader thread. Waits for the worker when it's a full queue ahead rather than parsing the whole file into
+    //       memory it can't hand over yet.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Load(const std::string& csvPath, size_t chunkRows) {
+
+        FollowCsv(csvPath, chunkRows, 100, this->stop, [this] (const std::vector<DateTimePricePair>& batch) {
+
+            std::vector<double> chunk;
+            this->emptyChunks.TryPop(chunk);
+
+            chunk.clear();
+
+            for (auto& dateTimePricePair : batch) {
+                chunk.push_back(dateTimePricePair.quote);
+            }
+
+            while (!this->chunks.TryPush(chunk)) {
+
+                if (this->stop) {
+                    return false;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            this->Wake();
+            return !this->stop;
+        });
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Work
+    // Desc: Worker thread. Every pass takes all the chunks that are waiting and the latest viewport, and builds one
+    //       frame for the lot, so a burst of chunks or viewports costs one frame.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Work() {
+
+        PlotViewport viewport;
+
+        this->pyramid.Build(this->yData.data(), this->yData.size());
+
+        while (!this->stop) {
+
+            auto grew = this->TakeChunks();
+            auto moved = this->viewports.Take();
+
+            if (moved) {
+                viewport = this->viewports.Front();
+            }
+
+            if ((grew || moved) && this->BuildFrame(viewport, this->frames.Back())) {
+
+                this->frames.Publish();
+
+                if (this->frameEvent != (Uint32) -1 && !this->framePending.exchange(true)) {
+                    SDL_Event event;
+                    memset(&event, 0, sizeof(event));
+                    event.type = this->frameEvent;
+
+                    SDL_PushEvent(&event);
+                }
+
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(this->wakeMutex);
+            this->wake.wait(lock, [this] () { return this->woken || this->stop; });
+            this->woken = false;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: TakeChunks
+    // Desc: Appends every waiting chunk and extends the pyramid over them. Returns whether there were any.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool TakeChunks() {
+
+        auto oldCount = this->yData.size();
+        std::vector<double> chunk;
+
+        while (this->chunks.TryPop(chunk)) {
+
+            this->yData.insert(this->yData.end(), chunk.begin(), chunk.end());
+
+            // a full free list just means this one gets freed
+            this->emptyChunks.TryPush(chunk);
+        }
+
+        if (this->yData.size() == oldCount) {
+            return false;
+        }
+
+        this->pyramid.Append(this->yData.data(), this->yData.size());
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: BuildFrame
+    // Desc: The same polyline SDLPlot::DrawSeries would draw for the window. Returns false until there's a layout.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool BuildFrame(const PlotViewport& viewport, PlotFrame& frame) {
+
+        PROFILE_SCOPE("BuildFrame");
+
+        auto& layout = viewport.layout;
+        auto plotAreaWidth = layout.plotWidth - layout.leftMargin - layout.rightMargin;
+
+        if (plotAreaWidth < 1) {
+            return false;
+        }
+
+        auto count = this->yData.size();
+        auto begin = viewport.begin;
+        auto end = viewport.end;
+
+        if (viewport.following) {
+            auto length = (begin == 0) ? count : end - begin;
+
+            end = count;
+            begin = count - std::min(length, count);
+        }
+
+        begin = std::min(begin, count);
+        end = std::max(begin, std::min(end, count));
+
+        frame.begin = begin;
+        frame.end = end;
+        frame.count = count;
+        frame.min = 0.0;
+        frame.max = 0.0;
+
+        if (end - begin < 2) {
+            frame.points.clear();
+            return true;
+        }
+
+        auto width = static_cast<size_t>(plotAreaWidth);
+
+        if (end - begin > width) {
+
+            this->pyramid.QueryM4(this->yData.data(), begin, end, width, this->columns);
+            M4ColumnsRange(this->columns, frame.min, frame.max);
+
+            ScaleM4Columns(layout, this->columns, this->columnX, frame.min, frame.max, frame.points);
+        } else {
+
+            frame.min = this->yData[begin];
+            frame.max = this->yData[begin];
+            SampleRange(this->yData.data(), begin + 1, end, frame.min, frame.max);
+
+            ScaleSamples(layout, SeriesView(this->yData), begin, end, frame.min, frame.max, 0.0, 0.0, frame.points);
+        }
+
+        return true;
+    }
+};
+
+#endif // PLOTPIPELINE_H
@@ -6,7 +6,6 @@
 #include <exception>
 #include <cstring>
 #include <memory>
-#include <functional>
 #include <vector>
 #include <cmath>
 #include <random>
@@ -15,6 +14,10 @@
 #include "SDL.h"
 #include "SDL_ttf.h"
 
+#include "RenderBatch.h"
+#include "FontCache.h"
+#include "Generators.h"
+
 /* SDL interprets each pixel as a 32-bit number, so our masks must depend
     on the endianness (byte order) of the machine */
     #if SDL_BYTEORDER == SDL_BIG_ENDIAN
@@ -29,6 +32,16 @@
     const uint32_t amask = 0xff000000;
 #endif
 
+// TextureDeleter
+// Destroys the texture a TexturePtr owns. A plain function object, so the pointer stays one word and nothing is allocated for the deleter.
+struct TextureDeleter {
+    void operator()(SDL_Texture* texture) const {
+        SDL_DestroyTexture(texture); 
+    }
+};
+
+typedef std::unique_ptr<SDL_Texture, TextureDeleter> TexturePtr; 
+
 // DrawIntervalInfo
 struct DrawIntervalInfo {
     SDL_Renderer* renderer;
@@ -54,12 +67,13 @@ struct DrawGridInfo {
 };
 
 // DrawCandleInfo
+// Screen coordinates. The body covers candleTop to candleBottom, the wicks run up and down from its middle column.
 struct DrawCandleInfo {
 
     uint32_t color; 
 
-    unsigned int x; 
-    unsigned int y; 
+    unsigned int x;                 // left edge of the body
+    unsigned int y;                 // top of the upper wick, the high, i.e. candleTop - topWickHeight
 
     unsigned int candleTop;
     unsigned int candleBottom;
@@ -72,19 +86,51 @@ struct DrawCandleInfo {
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 // Name: DrawCandle
-// Desc:
+// Desc: Adds the body and wicks of a candle to the batch in the batch's current color, candleInfo.color is left to the
+//       caller so a whole chart of candles can go out as one FillRects per color
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void DrawCandle(RenderBatch& batch, const DrawCandleInfo& candleInfo) {
+
+    auto width = std::max(1u, candleInfo.width); 
+    auto top = std::min(candleInfo.candleTop, candleInfo.candleBottom); 
+    auto bottom = std::max(candleInfo.candleTop, candleInfo.candleBottom); 
+    auto middle = candleInfo.x + width / 2; 
+
+    if (candleInfo.topWickHeight > 0) {
+        batch.AddVerticalLine(middle, top - candleInfo.topWickHeight, top - 1); 
+    }
+
+    SDL_Rect body = {(int) candleInfo.x, (int) top, (int) width, (int) (bottom - top + 1)}; 
+    batch.AddRect(body); 
+
+    if (candleInfo.bottomWickHeight > 0) {
+        batch.AddVerticalLine(middle, bottom + 1, bottom + candleInfo.bottomWickHeight); 
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: DrawCandle
+// Desc: One-off candle. Drawing several? Use the RenderBatch version and flush once per color.
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 void DrawCandle(SDL_Renderer* renderer, const DrawCandleInfo& candleInfo) {
 
+    static thread_local RenderBatch batch; 
+
+    batch.SetRenderer(renderer); 
+    batch.SetColor(candleInfo.color); 
+
+    DrawCandle(batch, candleInfo); 
+    batch.FlushRects(); 
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 // Name: DrawDottedLine
-// Desc:
+// Desc: Adds a dashed line from (x1, y1) to (x2, y2) to the batch: cycle pixels on out of every period, counted along
+//       the line. Horizontal and vertical lines become one rect per dash, anything else is stepped out with
+//       bresenham's so every slope comes out right. Nothing is drawn until the caller flushes the batch.
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 void DrawDottedLine(
-    SDL_Renderer* renderer, 
-    const unsigned int color, 
+    RenderBatch& batch, 
     int x1, 
     int y1, 
     int x2, 
@@ -92,125 +138,100 @@ void DrawDottedLine(
     const unsigned int period, 
     const unsigned int cycle) {
 
-    // cant draw this
-    if (x1 == x2 && y1 == y2) {
+    if (period == 0 || cycle == 0) {
         return; 
     }
 
-    // Always draw left to right/top to bottom so swap x's and y's if we need to
-    if (x1 > x2) {
-        std::swap(x1, x2); 
-    }
+    if (x1 == x2 || y1 == y2) {
 
-    if (y1 > y2) {
-        std::swap(y1, y2); 
-    }
+        // perfectly vertical or horizontal line
+        auto vertical = (x1 == x2); 
+        auto from = vertical ? std::min(y1, y2) : std::min(x1, x2); 
+        auto to = vertical ? std::max(y1, y2) : std::max(x1, x2); 
 
-    auto xDiff = (x2 - x1) > 0 ? (x2 - x1) : 1; 
-    auto yDiff = (y2 - y1) > 0 ? (y2 - y1) : 1; 
+        for (auto start = from; start <= to; start += period) {
+            
+            auto end = std::min<int>(to, start + cycle - 1); 
+
+            if (vertical) {
+                batch.AddVerticalLine(x1, start, end); 
+            } else {
+                batch.AddHorizontalLine(start, end, y1); 
+            }
+        }
 
-    auto surface = SDL_CreateRGBSurface(0, xDiff, yDiff, 32, rmask, gmask, bmask, amask); 
-        
-    if (surface == nullptr) {
-        std::cout << "SDL_CreateRGBSurface failed\n"; 
         return; 
     }
 
-    SDL_LockSurface(surface);
+    auto dx = std::abs(x2 - x1); 
+    auto dy = -std::abs(y2 - y1); 
+    auto sx = (x1 < x2) ? 1 : -1; 
+    auto sy = (y1 < y2) ? 1 : -1; 
+    auto error = dx + dy; 
 
-    auto arrSize = xDiff * yDiff;
-    auto pixelData = static_cast<uint32_t*>(surface->pixels); 
-
-    memset(pixelData, 0x00, arrSize * sizeof(uint32_t) ); 
     unsigned int counter = 0; 
 
-    if (x1 == x2 || y1 == y2) {
-
-        // perfectly vertical line
-        auto indexTop = (y1 == y2) ? x2 - x1 : y2 - y1; 
+    while (true) {
 
-        for (auto index = 0; index < indexTop; index++) {
-            
-            if (index < arrSize && counter < cycle) {
-                pixelData[index] = color; 
-            }
-
-            counter++;
-            if (counter > period) {
-                counter = 0; 
-            }
+        if (counter < cycle) {
+            batch.AddPixel(x1, y1); 
         }
 
-    } else {
-        
-        // sorta bresenhams line algorithm 
-        auto m = (float) yDiff / xDiff;
-        unsigned int yCurr = 0; 
-
-        for (auto x = 0; x < xDiff; x++) {
-
-            // calculate predicted value - 
-            auto error = m * x - (float) yCurr;
-
-            if (m == 0) {
-                error = y2 - yCurr; // ????? 
-            }
+        if (++counter >= period) {
+            counter = 0; 
+        }
 
-            if (error >= 1.0f) {
-                while (error >= 1.0f) {
-                    
-                    auto index = (yCurr * xDiff) + x;
-                
-                    // draw pixel
-                    if (index < arrSize && counter < cycle) {
-                        pixelData[index] = color; 
-                    }
-        
-                    yCurr++;
-                    counter++;
-                    
-                    if (counter > period) {
-                        counter = 0;
-                    }
-
-                    error -= 1.0f; 
-                }
-            } else {
+        if (x1 == x2 && y1 == y2) {
+            break; 
+        }
 
-                auto index = (yCurr * xDiff) + x;
-                
-                // draw pixel
-                if (index < arrSize && counter < cycle) {
-                    pixelData[index] = color; 
-                }
+        auto error2 = 2 * error; 
 
-                counter++; 
+        if (error2 >= dy) {
+            error += dy; 
+            x1 += sx; 
+        }
 
-                if (counter > period) {
-                    counter = 0;
-                }
-            }
+        if (error2 <= dx) {
+            error += dx; 
+            y1 += sy; 
         }
     }
+}
 
-    SDL_UnlockSurface(surface);
-
-    auto texture = SDL_CreateTextureFromSurface(renderer, surface); 
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: DrawDottedLine
+// Desc: One-off dashed line in color (0xRRGGBBAA). Drawing several? Use the RenderBatch version and flush once.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void DrawDottedLine(
+    SDL_Renderer* renderer, 
+    const unsigned int color, 
+    int x1, 
+    int y1, 
+    int x2, 
+    int y2, 
+    const unsigned int period, 
+    const unsigned int cycle) {
 
-    SDL_Rect rect = {x1, y1, xDiff, yDiff}; 
-    SDL_RenderCopy(renderer, texture, NULL, &rect);
+    // kept around so the buffers are only allocated the first time
+    static thread_local RenderBatch batch; 
+    
+    batch.SetRenderer(renderer); 
+    batch.SetColor(color); 
 
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture); 
+    DrawDottedLine(batch, x1, y1, x2, y2, period, cycle); 
+    batch.Flush(); 
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 // Name: DrawGrid
-//
+// Desc: All of the gridlines, solid or dotted, go out as one batch
 //---------------------------------------------------------------------------------------------------------------------------------------------------
-void DrawGrid(SDL_Renderer* renderer, const DrawGridInfo& drawGridInfo) {
+void DrawGrid(RenderBatch& batch, const DrawGridInfo& drawGridInfo) {
+
+    PROFILE_SCOPE("DrawGrid");
 
-    SDL_SetRenderDrawColor(renderer, drawGridInfo.color >> 24, (drawGridInfo.color & 0x00ff0000) >> 16, (drawGridInfo.color & 0x0000ff00) >> 8, (drawGridInfo.color & 0x000000ff)); 
+    batch.SetColor(drawGridInfo.color); 
 
     // TODO: fix division by zero below 
 
@@ -232,9 +253,9 @@ void DrawGrid(SDL_Renderer* renderer, const DrawGridInfo& drawGridInfo) {
         }
 
         if (drawGridInfo.dotted) {
-            DrawDottedLine(renderer, drawGridInfo.color, x, drawGridInfo.y, x, drawGridInfo.height, 10, 5);
+            DrawDottedLine(batch, x, drawGridInfo.y, x, drawGridInfo.height, 10, 5);
         } else {
-            SDL_RenderDrawLine(renderer, x, drawGridInfo.y, x, drawGridInfo.height); 
+            batch.AddVerticalLine(x, drawGridInfo.y, drawGridInfo.height); 
         }
 
         accum += xSpacingf; 
@@ -249,19 +270,37 @@ void DrawGrid(SDL_Renderer* renderer, const DrawGridInfo& drawGridInfo) {
         }
 
         if (drawGridInfo.dotted) {
-            DrawDottedLine(renderer, drawGridInfo.color, drawGridInfo.x, y, drawGridInfo.width, y, 10, 5);
+            DrawDottedLine(batch, drawGridInfo.x, y, drawGridInfo.width, y, 10, 5);
         } else {
-            SDL_RenderDrawLine(renderer, drawGridInfo.x, y, drawGridInfo.width, y);
+            batch.AddHorizontalLine(drawGridInfo.x, drawGridInfo.width, y);
         }
 
         accum += ySpacingf; 
     }
+
+    batch.FlushRects(); 
+    batch.FlushPixels(); 
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: DrawGrid
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void DrawGrid(SDL_Renderer* renderer, const DrawGridInfo& drawGridInfo) {
+
+    // kept around so the buffers are only allocated the first time
+    static thread_local RenderBatch batch; 
+
+    batch.SetRenderer(renderer); 
+    DrawGrid(batch, drawGridInfo); 
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 // Name: DrawOnRepeatingInterval
-// Desc: 
+// Desc: Calls func(const DrawIntervalInfo&) at count evenly spaced points from (x1, y1) to (x2, y2). func is any callable, taken as is
+//       rather than through std::function, which would put a lambda with more than a couple of captures on the heap every call.
 //---------------------------------------------------------------------------------------------------------------------------------------------------
+template <typename Func>
 void DrawOnRepeatingInterval(
     SDL_Renderer* renderer,
     const int x1, 
@@ -272,7 +311,7 @@ void DrawOnRepeatingInterval(
     const float angle, 
     const bool perpendicularToTangent,
     const bool includeEndPoints,
-    std::function<void(const DrawIntervalInfo& info)> func
+    const Func& func
 ) {
 
     // todo: implement perpendicular to tangent function
@@ -327,39 +366,40 @@ void DrawOnRepeatingInterval(
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 // Name: RenderText
-// Desc: 
+// Desc: The font comes out of the font cache so it's only read from disk the first time. For text that changes every
+//       frame use a GlyphAtlas instead, this still rasterizes and uploads a texture per call.
 //---------------------------------------------------------------------------------------------------------------------------------------------------
-std::unique_ptr<SDL_Texture, std::function<void(SDL_Texture*)>> RenderTextToTexture(SDL_Renderer* renderer, const std::string& fontName, unsigned int size, const std::string& text, SDL_Color color) {
+TexturePtr RenderTextToTexture(SDL_Renderer* renderer, const std::string& fontName, unsigned int size, const std::string& text, SDL_Color color) {
 
-    auto font = TTF_OpenFont(fontName.c_str(), size); 
-    auto textSurface = TTF_RenderText_Solid(font, text.c_str(), color); 
-    auto textTexture = SDL_CreateTextureFromSurface(renderer, textSurface); 
+    SDL_Surface* textSurface = nullptr; 
 
-    SDL_FreeSurface(textSurface);
-    TTF_CloseFont(font); 
+    {
+        std::lock_guard<std::recursive_mutex> lock(TtfMutex()); 
 
-    std::unique_ptr<SDL_Texture, std::function<void(SDL_Texture*)>> ptr(textTexture, [] (SDL_Texture* t) {SDL_DestroyTexture(t); } ); 
+        auto font = GetFont(fontName, size); 
 
-    return ptr; 
+        if (font != nullptr) {
+            textSurface = TTF_RenderText_Solid(font, text.c_str(), color); 
+        }
+    }
+
+    auto textTexture = (textSurface != nullptr) ? SDL_CreateTextureFromSurface(renderer, textSurface) : nullptr; 
+
+    if (textTexture != nullptr) {
+        PROFILE_COUNT(ProfileCounter::TextureUploads, 1);
+    }
+
+    SDL_FreeSurface(textSurface);
+
+    return TexturePtr(textTexture); 
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 // Name: GenerateRandomWalk
-// Desc: 
+// Desc: n samples of an AR(1) process starting from 0, see GenerateAr1. A different walk every second unless given a seed.
 //---------------------------------------------------------------------------------------------------------------------------------------------------
-std::vector<double> GenerateRandomWalk(int n, double phi, double stddev, double mean) {
-    std::random_device rd; 
-    std::mt19937 gen((unsigned long) time(0)); 
-
-    std::normal_distribution<double> d(mean, stddev); 
-    std::vector<double> rw(n); 
-
-    for (auto i = 0; i < n; i++) {   
-        auto rn = d(gen);  
-        rw[i] += rn + phi*rw[i-1]; 
-    }
-
-    return rw; 
+std::vector<double> GenerateRandomWalk(int n, double phi, double stddev, double mean, uint64_t seed = static_cast<uint64_t>(time(0))) {
+    return GenerateAr1(seed, static_cast<size_t>(std::max(0, n)), phi, stddev, mean);
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
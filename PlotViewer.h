@@ -0,0 +1,275 @@
+// PlotViewer.h
+#ifndef PLOTVIEWER_H
+#define PLOTVIEWER_H
+
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#include "SDL.h"
+
+// never zoom in further than this many samples across the plot
+const size_t viewerMinVisible = 16;
+
+// ViewerInput
+// Everything that happened since the last frame, merged so a burst of events costs one redraw
+struct ViewerInput {
+    bool quit;
+    bool redraw;            // resized or exposed, nothing about the window onto the data changed
+
+    double zoom;            // window length multiplier, < 1 zooms in
+    double zoomAnchor;      // where the zoom is centred, 0 the left edge of the plot and 1 the right
+
+    double pan;             // in pixels, positive moves the window later
+
+    bool fit;
+    bool jumpStart;
+    bool jumpEnd;
+
+    ViewerInput() : quit(false), redraw(false), zoom(1.0), zoomAnchor(0.5), pan(0.0), fit(false), jumpStart(false), jumpEnd(false) {}
+
+    bool Empty() const {
+        return !this->quit && !this->redraw && this->zoom == 1.0 && this->pan == 0.0 && !this->fit && !this->jumpStart && !this->jumpEnd;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: PlotViewer
+// Desc: Which samples the interactive viewer shows. Mouse wheel zooms around the cursor, dragging pans, the arrow
+//       keys pan and zoom, Home and End jump to either end and F fits everything. While the window reaches the newest
+//       sample it follows new ones in.
+//---------------------------------------------------------------------------------------------------------------------
+class PlotViewer {
+
+    size_t begin;
+    size_t end;
+    bool following;
+
+    bool dragging;
+
+    // plot area in window coordinates, for the zoom anchor and how far a pixel of dragging pans
+    int plotLeft;
+    int plotWidth;
+
+public:
+
+    PlotViewer() : begin(0), end(0), following(true), dragging(false), plotLeft(0), plotWidth(1) {}
+
+    size_t Begin() const { return this->begin; }
+    size_t End() const { return this->end; }
+    bool Following() const { return this->following; }
+
+    void SetPlotArea(int left, int width) {
+        this->plotLeft = left;
+        this->plotWidth = std::max(1, width);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddEvent
+    // Desc: Folds event into input. Returns false for events the viewer doesn't care about, so the caller can skip
+    //       redrawing for them.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool AddEvent(const SDL_Event& event, ViewerInput& input) {
+
+        switch (event.type) {
+
+            case SDL_QUIT:
+                input.quit = true;
+                return true;
+
+            case SDL_WINDOWEVENT:
+                if (event.window.event == SDL_WINDOWEVENT_RESIZED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                    input.redraw = true;
+                    return true;
+                }
+                return false;
+
+            case SDL_MOUSEWHEEL: {
+                if (event.wheel.y == 0) {
+                    return false;
+                }
+
+                int x;
+                SDL_GetMouseState(&x, nullptr);
+
+                // a notch is 20%, wheel up zooms in
+                input.zoom *= std::pow(0.8, event.wheel.y);
+                input.zoomAnchor = std::min(1.0, std::max(0.0, (double) (x - this->plotLeft) / this->plotWidth));
+                return true;
+            }
+
+            case SDL_MOUSEBUTTONDOWN:
+                this->dragging = this->dragging || event.button.button == SDL_BUTTON_LEFT;
+                return false;
+
+            case SDL_MOUSEBUTTONUP:
+                this->dragging = this->dragging && event.button.button != SDL_BUTTON_LEFT;
+                return false;
+
+            case SDL_MOUSEMOTION:
+                if (!this->dragging || event.motion.xrel == 0) {
+                    return false;
+                }
+
+                // the data moves with the mouse, so dragging right goes back in time
+                input.pan -= event.motion.xrel;
+                return true;
+
+            case SDL_KEYDOWN:
+                return this->AddKey(event.key.keysym.sym, input);
+
+            default:
+                return false;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Apply
+    // Desc: Moves the window for input over count samples. Returns whether anything needs drawing again.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Apply(const ViewerInput& input, size_t count) {
+
+        auto oldBegin = this->begin;
+        auto oldEnd = this->end;
+
+        if (input.fit) {
+            this->begin = 0;
+            this->end = count;
+            this->following = true;
+        }
+
+        if (this->end > count || this->end <= this->begin) {
+            this->begin = 0;
+            this->end = count;
+        }
+
+        if (input.zoom != 1.0) {
+            this->Zoom(input.zoom, input.zoomAnchor, count);
+        }
+
+        if (input.pan != 0.0) {
+            auto length = (double) (this->end - this->begin);
+            this->Pan((long long) std::llround(input.pan * length / this->plotWidth), count);
+        }
+
+        if (input.jumpStart) {
+            this->Pan(-(long long) count, count);
+        }
+
+        if (input.jumpEnd) {
+            this->Pan((long long) count, count);
+        }
+
+        if (input.zoom != 1.0 || input.pan != 0.0 || input.jumpStart || input.jumpEnd) {
+            this->following = (this->end == count);
+        }
+
+        return input.redraw || this->begin != oldBegin || this->end != oldEnd;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Grow
+    // Desc: The data has grown to count samples. A following window slides along to keep the newest sample on the
+    //       right edge, at the same zoom. Returns whether the window moved.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Grow(size_t count) {
+
+        if (!this->following || count == this->end) {
+            return false;
+        }
+
+        // showing everything keeps showing everything
+        auto length = (this->begin == 0) ? count : this->end - this->begin;
+
+        this->end = count;
+        this->begin = count - std::min(length, count);
+
+        return true;
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddKey
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    bool AddKey(SDL_Keycode key, ViewerInput& input) {
+
+        switch (key) {
+            case SDLK_ESCAPE:
+            case SDLK_q:
+                input.quit = true;
+                return true;
+            case SDLK_LEFT:
+                input.pan -= this->plotWidth / 8.0;
+                return true;
+            case SDLK_RIGHT:
+                input.pan += this->plotWidth / 8.0;
+                return true;
+            case SDLK_PAGEUP:
+                input.pan -= this->plotWidth;
+                return true;
+            case SDLK_PAGEDOWN:
+                input.pan += this->plotWidth;
+                return true;
+            case SDLK_UP:
+            case SDLK_EQUALS:
+            case SDLK_PLUS:
+            case SDLK_KP_PLUS:
+                input.zoom *= 0.8;
+                input.zoomAnchor = 0.5;
+                return true;
+            case SDLK_DOWN:
+            case SDLK_MINUS:
+            case SDLK_KP_MINUS:
+                input.zoom *= 1.25;
+                input.zoomAnchor = 0.5;
+                return true;
+            case SDLK_HOME:
+                input.jumpStart = true;
+                input.jumpEnd = false;
+                return true;
+            case SDLK_END:
+                input.jumpEnd = true;
+                input.jumpStart = false;
+                return true;
+            case SDLK_f:
+            case SDLK_0:
+                input.fit = true;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Zoom
+    // Desc: Scales the window length by factor, keeping the sample under anchor where it is
+    //-----------------------------------------------------------------------------------------------------------------
+    void Zoom(double factor, double anchor, size_t count) {
+
+        auto length = (double) (this->end - this->begin);
+        auto newLength = std::min((double) count, std::max((double) std::min(viewerMinVisible, count), std::round(length * factor)));
+
+        auto anchorSample = this->begin + anchor * length;
+        auto newBegin = std::min((double) count - newLength, std::max(0.0, std::round(anchorSample - anchor * newLength)));
+
+        this->begin = (size_t) newBegin;
+        this->end = this->begin + (size_t) newLength;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Pan
+    // Desc: Moves the window by samples, stopping at either end of the data
+    //-----------------------------------------------------------------------------------------------------------------
+    void Pan(long long samples, size_t count) {
+
+        auto length = this->end - this->begin;
+        auto newBegin = std::min((long long) (count - length), std::max(0ll, (long long) this->begin + samples));
+
+        this->begin = (size_t) newBegin;
+        this->end = this->begin + length;
+    }
+};
+
+#endif // PLOTVIEWER_H
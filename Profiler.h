@@ -0,0 +1,421 @@
+// Profiler.h
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Build with -DSDLPLOT_PROFILE to turn the profiler on. Without it the PROFILE_ macros are empty and nothing below the
+// counter names is compiled, so the instrumented code is exactly what it was.
+
+// ProfileCounter
+// What the per frame counters count
+enum class ProfileCounter {
+    DrawCalls,          // renderer or canvas calls that drew something
+    Vertices,           // points, rect corners and triangle vertices those calls submitted
+    TextureUploads,     // textures made from surfaces, i.e. pixels sent to the gpu
+    Count
+};
+
+#ifdef SDLPLOT_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// events kept in the ring, a power of two
+const size_t profileEventCapacity = 1 << 16;
+
+// frames the summary and the trace's counters cover
+const size_t profileFrameHistory = 256;
+
+// ProfileEvent
+// One timed scope, times in ns since the profiler started
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+    uint32_t thread;
+};
+
+// ProfileStage
+// An instrumented stage's cost per frame, averaged over the frames in the history
+struct ProfileStage {
+    const char* name;
+    double milliseconds;
+    double calls;
+};
+
+// ProfileSummary
+// What the overlay shows
+struct ProfileSummary {
+    double fps;
+    double p50;                 // frame times in ms
+    double p95;
+    double p99;
+    uint64_t counters[static_cast<int>(ProfileCounter::Count)];     // over the last frame
+    std::vector<ProfileStage> stages;                               // slowest first
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: Profiler
+// Desc: Timed scopes go into a ring buffer of the last profileEventCapacity events. Any thread can record: a slot is
+//       claimed with one fetch_add and carries a sequence number that's odd while it's being written, so a reader
+//       copying the ring while it's being written to skips the slots it catches half done instead of taking a lock.
+//       The frame history and the counter snapshots belong to whichever thread calls EndFrame, the render thread.
+//---------------------------------------------------------------------------------------------------------------------
+class Profiler {
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> start;
+        std::atomic<uint64_t> duration;
+        std::atomic<uint32_t> thread;
+    };
+
+    // FrameRecord
+    struct FrameRecord {
+        uint64_t end;
+        uint64_t duration;
+        uint64_t firstEvent;        // ring index of the first event recorded during the frame
+        uint64_t counters[static_cast<int>(ProfileCounter::Count)];
+    };
+
+    std::chrono::steady_clock::time_point epoch;
+
+    std::vector<Slot> slots;
+    std::atomic<uint64_t> next;
+
+    std::atomic<uint64_t> counters[static_cast<int>(ProfileCounter::Count)];
+    std::atomic<uint32_t> nextThread;
+
+    std::vector<FrameRecord> frames;
+    uint64_t frameCount;
+    uint64_t lastFrameEnd;
+    uint64_t lastFrameEvent;
+
+    // kept between Summarize calls, the overlay summarises every frame
+    std::vector<ProfileEvent> summaryEvents;
+    std::vector<double> summaryTimes;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Get
+    // Desc: The one every PROFILE_ macro records into
+    //-----------------------------------------------------------------------------------------------------------------
+    static Profiler& Get() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    Profiler() : epoch(std::chrono::steady_clock::now()), slots(profileEventCapacity), next(0), nextThread(0), frames(profileFrameHistory), frameCount(0), lastFrameEnd(0), lastFrameEvent(0) {
+
+        for (auto& slot : this->slots) {
+            slot.sequence.store(0, std::memory_order_relaxed);
+        }
+
+        for (auto& counter : this->counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+
+        // a window never holds more than the ring does, so neither grows while the overlay summarises every frame
+        this->summaryEvents.reserve(profileEventCapacity);
+        this->summaryTimes.reserve(profileFrameHistory);
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // ns since the profiler started
+    uint64_t Now() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->epoch).count());
+    }
+
+    // small number for the calling thread, handed out the first time it records something
+    uint32_t ThreadId() {
+        static thread_local uint32_t id = this->nextThread.fetch_add(1, std::memory_order_relaxed) + 1;
+        return id;
+    }
+
+    void Count(ProfileCounter counter, uint64_t amount) {
+        this->counters[static_cast<int>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Record
+    // Desc: A scope called name ran from start for duration ns. name has to outlive the profiler, a string literal.
+    //       Writers that have lapped the ring can land on the same slot; one writes at a time and the newest event
+    //       wins, an older one arriving late is dropped since it's already out of the ring's window.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Record(const char* name, uint64_t start, uint64_t duration) {
+
+        auto index = this->next.fetch_add(1, std::memory_order_relaxed);
+        auto& slot = this->slots[index & (profileEventCapacity - 1)];
+
+        auto sequence = slot.sequence.load(std::memory_order_relaxed);
+
+        while (true) {
+
+            if (sequence > 2 * index) {
+                return;
+            }
+
+            // an older event still being written, ours replaces it once it's done
+            if (sequence & 1) {
+                std::this_thread::yield();
+                sequence = slot.sequence.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (slot.sequence.compare_exchange_weak(sequence, 2 * index + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.duration.store(duration, std::memory_order_relaxed);
+        slot.thread.store(this->ThreadId(), std::memory_order_relaxed);
+
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: EndFrame
+    // Desc: Closes the frame that started at the last EndFrame: records it as a scope of its own and moves the
+    //       counters into the frame history
+    //-----------------------------------------------------------------------------------------------------------------
+    void EndFrame() {
+        this->EndFrame(this->Now());
+    }
+
+    // EndFrame at now rather than the current time, for replaying a recorded frame
+    void EndFrame(uint64_t now) {
+
+        if (this->frameCount > 0) {
+            this->Record("Frame", this->lastFrameEnd, now - this->lastFrameEnd);
+        }
+
+        auto& frame = this->frames[this->frameCount % profileFrameHistory];
+        frame.end = now;
+        frame.duration = now - this->lastFrameEnd;
+        frame.firstEvent = this->lastFrameEvent;
+
+        for (int i = 0; i < static_cast<int>(ProfileCounter::Count); i++) {
+            frame.counters[i] = this->counters[i].exchange(0, std::memory_order_relaxed);
+        }
+
+        this->frameCount++;
+        this->lastFrameEnd = now;
+        this->lastFrameEvent = this->next.load(std::memory_order_relaxed);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Events
+    // Desc: Copies of the events still in the ring, oldest first, starting from ring index since. Ones being
+    //       overwritten while this runs are left out.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Events(std::vector<ProfileEvent>& events, uint64_t since = 0) const {
+
+        events.clear();
+
+        auto end = this->next.load(std::memory_order_acquire);
+        auto begin = std::min(end, std::max(since, (end > profileEventCapacity) ? end - profileEventCapacity : 0));
+
+        events.reserve(end - begin);
+
+        for (auto index = begin; index < end; index++) {
+
+            auto& slot = this->slots[index & (profileEventCapacity - 1)];
+
+            if (slot.sequence.load(std::memory_order_acquire) != 2 * index + 2) {
+                continue;
+            }
+
+            ProfileEvent event;
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.start = slot.start.load(std::memory_order_relaxed);
+            event.duration = slot.duration.load(std::memory_order_relaxed);
+            event.thread = slot.thread.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.sequence.load(std::memory_order_relaxed) == 2 * index + 2) {
+                events.push_back(event);
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Summarize
+    // Desc: FPS and frame time percentiles over the frame history, the last frame's counters and what each stage
+    //       cost per frame over the same frames. From the thread that calls EndFrame.
+    //-----------------------------------------------------------------------------------------------------------------
+    void Summarize(ProfileSummary& summary) {
+
+        summary.fps = 0.0;
+        summary.p50 = summary.p95 = summary.p99 = 0.0;
+        summary.stages.clear();
+
+        for (auto& counter : summary.counters) {
+            counter = 0;
+        }
+
+        // the first frame has no start
+        auto frameCount = std::min<uint64_t>(this->frameCount, profileFrameHistory);
+        frameCount -= (this->frameCount <= profileFrameHistory && frameCount > 0) ? 1 : 0;
+
+        if (frameCount == 0) {
+            return;
+        }
+
+        auto& times = this->summaryTimes;
+        times.clear();
+
+        uint64_t windowStart = this->lastFrameEnd;
+        uint64_t windowEvent = this->lastFrameEvent;
+
+        for (uint64_t i = 0; i < frameCount; i++) {
+            auto& frame = this->frames[(this->frameCount - 1 - i) % profileFrameHistory];
+            times.push_back(frame.duration / 1e6);
+            windowStart = frame.end - frame.duration;
+            windowEvent = frame.firstEvent;
+        }
+
+        auto& last = this->frames[(this->frameCount - 1) % profileFrameHistory];
+        std::copy(last.counters, last.counters + static_cast<int>(ProfileCounter::Count), summary.counters);
+
+        std::sort(times.begin(), times.end());
+
+        auto percentile = [&times] (double p) { return times[std::min(times.size() - 1, static_cast<size_t>(p * times.size()))]; };
+
+        summary.fps = 1e9 * frameCount / std::max<uint64_t>(1, this->lastFrameEnd - windowStart);
+        summary.p50 = percentile(0.50);
+        summary.p95 = percentile(0.95);
+        summary.p99 = percentile(0.99);
+
+        // only what was recorded since the window started, not the whole ring
+        auto& events = this->summaryEvents;
+        this->Events(events, windowEvent);
+
+        for (auto& event : events) {
+
+            if (event.start < windowStart || event.name == nullptr) {
+                continue;
+            }
+
+            auto stage = std::find_if(summary.stages.begin(), summary.stages.end(), [&event] (const ProfileStage& stage) {
+                return stage.name == event.name || strcmp(stage.name, event.name) == 0;
+            });
+
+            if (stage == summary.stages.end()) {
+                ProfileStage newStage = {event.name, 0.0, 0.0};
+                summary.stages.push_back(newStage);
+                stage = summary.stages.end() - 1;
+            }
+
+            stage->milliseconds += event.duration / 1e6 / frameCount;
+            stage->calls += 1.0 / frameCount;
+        }
+
+        std::sort(summary.stages.begin(), summary.stages.end(), [] (const ProfileStage& a, const ProfileStage& b) { return a.milliseconds > b.milliseconds; });
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: WriteChromeTrace
+    // Desc: The events in the ring and the counters of the frames in the history as Chrome trace-event JSON, for
+    //       chrome://tracing or Perfetto
+    //-----------------------------------------------------------------------------------------------------------------
+    bool WriteChromeTrace(const std::string& filepath) const {
+
+        auto file = fopen(filepath.c_str(), "wb");
+
+        if (file == nullptr) {
+            std::cout << "Error opening file.";
+            return false;
+        }
+
+        std::vector<ProfileEvent> events;
+        this->Events(events);
+
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+        auto first = true;
+
+        for (auto& event : events) {
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n",
+                event.name, event.thread, event.start / 1e3, event.duration / 1e3);
+            first = false;
+        }
+
+        auto frameCount = std::min<uint64_t>(this->frameCount, profileFrameHistory);
+
+        for (auto i = frameCount; i > 0; i--) {
+            auto& frame = this->frames[(this->frameCount - i) % profileFrameHistory];
+
+            fprintf(file, "%s{\"name\":\"Counters\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"drawCalls\":%llu,\"vertices\":%llu,\"textureUploads\":%llu}}",
+                first ? "" : ",\n", frame.end / 1e3,
+                static_cast<unsigned long long>(frame.counters[static_cast<int>(ProfileCounter::DrawCalls)]),
+                static_cast<unsigned long long>(frame.counters[static_cast<int>(ProfileCounter::Vertices)]),
+                static_cast<unsigned long long>(frame.counters[static_cast<int>(ProfileCounter::TextureUploads)]));
+            first = false;
+        }
+
+        fputs("\n]}\n", file);
+
+        if (fclose(file) != 0) {
+            std::cout << "Error writing " << filepath << "\n";
+            return false;
+        }
+
+        return true;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ProfileScope
+// Desc: Times its own lifetime under name
+//---------------------------------------------------------------------------------------------------------------------
+class ProfileScope {
+
+    const char* name;
+    uint64_t start;
+
+public:
+
+    explicit ProfileScope(const char* name) : name(name), start(Profiler::Get().Now()) {}
+
+    ~ProfileScope() {
+        auto& profiler = Profiler::Get();
+        profiler.Record(this->name, this->start, profiler.Now() - this->start);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, amount) Profiler::Get().Count(counter, amount)
+#define PROFILE_FRAME() Profiler::Get().EndFrame()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(counter, amount)
+#define PROFILE_FRAME()
+
+#endif // SDLPLOT_PROFILE
+
+#endif // PROFILER_H
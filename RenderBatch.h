@@ -0,0 +1,373 @@
+// RenderBatch.h
+#ifndef RENDERBATCH_H
+#define RENDERBATCH_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "SDL.h"
+
+#include "PixelCanvas.h"
+#include "Profiler.h"
+
+// SDL_RenderGeometry turned up in 2.0.18, before that thick lines fall back to plain ones
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define RENDERBATCH_GEOMETRY
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: RenderBatch
+// Desc: Collects vertices into buffers that are kept between frames and submits each buffer with a single renderer
+//       call: polylines through SDL_RenderDrawLines, axis aligned lines as 1 pixel wide rects through
+//       SDL_RenderFillRects and thick/anti-aliased strokes as triangles through SDL_RenderGeometry. In immediate mode
+//       every primitive goes straight to the renderer instead, which is what the draw code used to do. With a canvas
+//       set every flush is recorded on the PixelCanvas instead and the renderer isn't touched at all.
+//---------------------------------------------------------------------------------------------------------------------
+class RenderBatch {
+
+    SDL_Renderer* renderer;
+
+    PixelCanvas* canvas;
+    uint32_t canvasColor;
+
+    std::vector<SDL_Point> points;
+    std::vector<SDL_Point> pixels;
+    std::vector<SDL_Rect> rects;
+
+#ifdef RENDERBATCH_GEOMETRY
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    // vertices in the canvas's format, kept for the same reason as the rest
+    std::vector<CanvasVertex> canvasVertices;
+#endif
+
+    bool immediate;
+    unsigned int drawCalls;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: RenderBatch
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    RenderBatch(SDL_Renderer* renderer = nullptr) : renderer(renderer), canvas(nullptr), canvasColor(0), immediate(false), drawCalls(0) {}
+
+    SDL_Renderer* Renderer() const { return this->renderer; }
+    void SetRenderer(SDL_Renderer* renderer) { this->renderer = renderer; }
+
+    PixelCanvas* Canvas() const { return this->canvas; }
+    void SetCanvas(PixelCanvas* canvas) { this->canvas = canvas; }
+
+    // immediate mode only means something for a renderer, a canvas records everything anyway
+    void SetImmediate(bool immediate) { this->immediate = immediate; }
+
+    // renderer calls that drew something since the last ResetDrawCalls
+    unsigned int DrawCalls() const { return this->drawCalls; }
+    void ResetDrawCalls() { this->drawCalls = 0; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: SetColor
+    // Desc: Colors are 0xRRGGBBAA like DrawGridInfo::color
+    //-----------------------------------------------------------------------------------------------------------------
+    void SetColor(uint32_t color) {
+        SDL_Color sdlColor = {(uint8_t) (color >> 24), (uint8_t) ((color & 0x00ff0000) >> 16), (uint8_t) ((color & 0x0000ff00) >> 8), (uint8_t) (color & 0x000000ff)};
+        this->SetColor(sdlColor);
+    }
+
+    void SetColor(SDL_Color color) {
+        if (this->canvas != nullptr) {
+            this->canvasColor = PackCanvasColor(color);
+        } else {
+            SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddPoint
+    // Desc: Next vertex of the current polyline
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddPoint(int x, int y) {
+
+        if (this->Immediate() && !this->points.empty()) {
+            SDL_RenderDrawLine(this->renderer, this->points.back().x, this->points.back().y, x, y);
+            this->CountDraw(2);
+
+            this->points.clear();
+        }
+
+        SDL_Point point = {x, y};
+        this->points.push_back(point);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddPoints
+    // Desc: count more vertices of the current polyline
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddPoints(const SDL_Point* points, size_t count) {
+
+        if (this->Immediate()) {
+            for (size_t i = 0; i < count; i++) {
+                this->AddPoint(points[i].x, points[i].y);
+            }
+            return;
+        }
+
+        this->points.insert(this->points.end(), points, points + count);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FlushPolyline
+    // Desc: Draws every point added since the last flush as one connected line in the current draw color
+    //-----------------------------------------------------------------------------------------------------------------
+    void FlushPolyline() {
+
+        if (this->canvas != nullptr && this->points.size() > 1) {
+            this->canvas->DrawLines(this->points.data(), this->points.size(), this->canvasColor);
+            this->CountDraw(this->points.size());
+        } else if (!this->Immediate() && this->points.size() > 1) {
+            SDL_RenderDrawLines(this->renderer, this->points.data(), static_cast<int>(this->points.size()));
+            this->CountDraw(this->points.size());
+        }
+
+        this->points.clear();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FlushPolylineAsStrokes
+    // Desc: Turns the current polyline into width pixel wide strokes and submits them with one call
+    //-----------------------------------------------------------------------------------------------------------------
+    void FlushPolylineAsStrokes(float width, SDL_Color color, bool antiAliased) {
+
+        for (size_t i = 1; i < this->points.size(); i++) {
+            auto& from = this->points[i - 1];
+            auto& to = this->points[i];
+
+            this->AddStroke(from.x + 0.5f, from.y + 0.5f, to.x + 0.5f, to.y + 0.5f, width, color, antiAliased);
+        }
+
+        this->points.clear();
+        this->FlushStrokes();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddPixel
+    // Desc: Single pixel, unconnected to anything else
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddPixel(int x, int y) {
+
+        if (this->Immediate()) {
+            SDL_RenderDrawPoint(this->renderer, x, y);
+            this->CountDraw(1);
+            return;
+        }
+
+        SDL_Point pixel = {x, y};
+        this->pixels.push_back(pixel);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FlushPixels
+    // Desc: Draws every pixel added since the last flush in the current draw color
+    //-----------------------------------------------------------------------------------------------------------------
+    void FlushPixels() {
+
+        if (this->canvas != nullptr && !this->pixels.empty()) {
+            this->canvas->DrawPoints(this->pixels.data(), this->pixels.size(), this->canvasColor);
+            this->CountDraw(this->pixels.size());
+        } else if (!this->pixels.empty()) {
+            SDL_RenderDrawPoints(this->renderer, this->pixels.data(), static_cast<int>(this->pixels.size()));
+            this->CountDraw(this->pixels.size());
+        }
+
+        this->pixels.clear();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddVerticalLine
+    // Desc: Same pixels as SDL_RenderDrawLine(x, y1, x, y2)
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddVerticalLine(int x, int y1, int y2) {
+        SDL_Rect rect = {x, std::min(y1, y2), 1, std::abs(y2 - y1) + 1};
+        this->AddRect(rect);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddHorizontalLine
+    // Desc: Same pixels as SDL_RenderDrawLine(x1, y, x2, y)
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddHorizontalLine(int x1, int x2, int y) {
+        SDL_Rect rect = {std::min(x1, x2), y, std::abs(x2 - x1) + 1, 1};
+        this->AddRect(rect);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddRect
+    // Desc: Filled rect
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddRect(const SDL_Rect& rect) {
+
+        if (this->Immediate()) {
+            SDL_RenderFillRect(this->renderer, &rect);
+            this->CountDraw(4);
+            return;
+        }
+
+        this->rects.push_back(rect);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FlushRects
+    // Desc: Fills every rect added since the last flush in the current draw color
+    //-----------------------------------------------------------------------------------------------------------------
+    void FlushRects() {
+
+        if (this->canvas != nullptr && !this->rects.empty()) {
+            this->canvas->FillRects(this->rects.data(), this->rects.size(), this->canvasColor);
+            this->CountDraw(4 * this->rects.size());
+        } else if (!this->rects.empty()) {
+            SDL_RenderFillRects(this->renderer, this->rects.data(), static_cast<int>(this->rects.size()));
+            this->CountDraw(4 * this->rects.size());
+        }
+
+        this->rects.clear();
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddStroke
+    // Desc: Line from (x1, y1) to (x2, y2) width pixels wide. Anti-aliased strokes get a 1 pixel fringe on each side
+    //       that fades out to transparent. Without SDL_RenderGeometry this is a plain 1 pixel line.
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddStroke(float x1, float y1, float x2, float y2, float width, SDL_Color color, bool antiAliased) {
+
+#ifdef RENDERBATCH_GEOMETRY
+        auto dx = x2 - x1;
+        auto dy = y2 - y1;
+        auto length = std::sqrt(dx * dx + dy * dy);
+
+        if (length <= 0.0f) {
+            return;
+        }
+
+        // unit normal
+        auto nx = -dy / length;
+        auto ny = dx / length;
+
+        auto halfWidth = width * 0.5f;
+
+        this->AddQuad(x1, y1, x2, y2, nx, ny, -halfWidth, halfWidth, color, color);
+
+        if (antiAliased) {
+            auto clear = color;
+            clear.a = 0;
+
+            this->AddQuad(x1, y1, x2, y2, nx, ny, halfWidth, halfWidth + 1.0f, color, clear);
+            this->AddQuad(x1, y1, x2, y2, nx, ny, -halfWidth, -halfWidth - 1.0f, color, clear);
+        }
+
+        if (this->Immediate()) {
+            this->FlushStrokes();
+        }
+#else
+        if (this->canvas != nullptr) {
+            SDL_Point line[2] = {{(int) x1, (int) y1}, {(int) x2, (int) y2}};
+            this->canvas->DrawLines(line, 2, PackCanvasColor(color));
+        } else {
+            SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a);
+            SDL_RenderDrawLine(this->renderer, (int) x1, (int) y1, (int) x2, (int) y2);
+        }
+        this->CountDraw(2);
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: FlushStrokes
+    // Desc: Submits every stroke added since the last flush as one SDL_RenderGeometry call
+    //-----------------------------------------------------------------------------------------------------------------
+    void FlushStrokes() {
+
+#ifdef RENDERBATCH_GEOMETRY
+        if (this->canvas != nullptr && !this->indices.empty()) {
+
+            this->canvasVertices.resize(this->vertices.size());
+
+            for (size_t i = 0; i < this->vertices.size(); i++) {
+                this->canvasVertices[i].x = this->vertices[i].position.x;
+                this->canvasVertices[i].y = this->vertices[i].position.y;
+                this->canvasVertices[i].color = this->vertices[i].color;
+            }
+
+            this->canvas->FillTriangles(this->canvasVertices.data(), this->canvasVertices.size(), this->indices.data(), this->indices.size());
+            this->CountDraw(this->indices.size());
+        } else if (!this->indices.empty()) {
+
+            // untextured geometry blends with the draw blend mode, which belongs to whoever's drawing with us
+            SDL_BlendMode blendMode;
+            SDL_GetRenderDrawBlendMode(this->renderer, &blendMode);
+
+            SDL_SetRenderDrawBlendMode(this->renderer, SDL_BLENDMODE_BLEND);
+            SDL_RenderGeometry(this->renderer, nullptr, this->vertices.data(), static_cast<int>(this->vertices.size()), this->indices.data(), static_cast<int>(this->indices.size()));
+            SDL_SetRenderDrawBlendMode(this->renderer, blendMode);
+
+            this->CountDraw(this->indices.size());
+        }
+
+        this->vertices.clear();
+        this->indices.clear();
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Flush
+    // Desc: Everything that's still pending, in the current draw color
+    //-----------------------------------------------------------------------------------------------------------------
+    void Flush() {
+        this->FlushRects();
+        this->FlushPixels();
+        this->FlushPolyline();
+        this->FlushStrokes();
+    }
+
+private:
+
+    bool Immediate() const { return this->immediate && this->canvas == nullptr; }
+
+    // one renderer or canvas call that submitted vertices
+    void CountDraw(size_t vertices) {
+        this->drawCalls++;
+        PROFILE_COUNT(ProfileCounter::DrawCalls, 1);
+        PROFILE_COUNT(ProfileCounter::Vertices, vertices);
+    }
+
+#ifdef RENDERBATCH_GEOMETRY
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: AddQuad
+    // Desc: The band between offsets inner and outer along the normal of a segment, as two triangles
+    //-----------------------------------------------------------------------------------------------------------------
+    void AddQuad(float x1, float y1, float x2, float y2, float nx, float ny, float inner, float outer, SDL_Color innerColor, SDL_Color outerColor) {
+
+        auto base = static_cast<int>(this->vertices.size());
+
+        SDL_Vertex quad[4];
+        quad[0].position.x = x1 + nx * inner; quad[0].position.y = y1 + ny * inner; quad[0].color = innerColor;
+        quad[1].position.x = x2 + nx * inner; quad[1].position.y = y2 + ny * inner; quad[1].color = innerColor;
+        quad[2].position.x = x2 + nx * outer; quad[2].position.y = y2 + ny * outer; quad[2].color = outerColor;
+        quad[3].position.x = x1 + nx * outer; quad[3].position.y = y1 + ny * outer; quad[3].color = outerColor;
+
+        for (auto& vertex : quad) {
+            vertex.tex_coord.x = 0.0f;
+            vertex.tex_coord.y = 0.0f;
+            this->vertices.push_back(vertex);
+        }
+
+        const int quadIndices[] = {0, 1, 2, 0, 2, 3};
+
+        for (auto index : quadIndices) {
+            this->indices.push_back(base + index);
+        }
+    }
+#endif
+};
+
+#endif // RENDERBATCH_H
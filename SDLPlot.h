@@ -4,12 +4,19 @@
 // ISDLPlot
 #include <memory>
 #include <vector>
-#include <list>
 #include <tuple>
+#include <limits>
 #include <unordered_map>
 #include <algorithm>
 
 #include "PlotUtility.h"
+#include "FontCache.h"
+#include "Decimation.h"
+#include "MinMaxPyramid.h"
+#include "SeriesView.h"
+#include "TimeAxis.h"
+#include "Bars.h"
+#include "Indicators.h"
 #include "SDL.h"
 #include "SDL_ttf.h"
 
@@ -54,157 +61,1574 @@ struct SDLPlotConfiguration {
 
     std::string yTitle;
 
-    std::shared_ptr<std::vector<int>> xData; 
-    std::shared_ptr<std::vector<int>> yData;
+    SDLPlotConfiguration() {
+        // TODO: set defaults here
+    }
+}; 
+
+// what's behind the grid, 0xRRGGBBAA
+const uint32_t backgroundColor = 0x2f2f2fff; 
+
+// SeriesId
+// Handle for a series added with AddSeries, 0 is never one
+typedef unsigned int SeriesId; 
+
+// TimeWindow
+// What PlotTimeWindow drew: samples [begin, end) of the view and their range, for the axis labels
+struct TimeWindow {
+    size_t begin; 
+    size_t end; 
+    double min; 
+    double max; 
+}; 
+
+//----------------------------------------------------------------------------------------------------------------------
+// Name: ScaleSamples
+// Desc: A point per sample in [begin, end), for ranges no wider than the plot. Samples are spread evenly across the
+//       plot, or by their x value between xMin and xMax when there's an x column. min/max are the range of the
+//       samples. Only needs the layout, not the plot, so geometry can be built off the thread that draws it.
+//----------------------------------------------------------------------------------------------------------------------
+inline void ScaleSamples(const SDLPlotConfiguration& config, const SeriesView& view, size_t begin, size_t end, double min, double max, double xMin, double xMax, std::vector<SDL_Point>& points) {
+
+    auto plotAreaHeight = config.plotHeight - config.bottomMargin - config.topMargin;
+    auto plotAreaWidth = config.plotWidth - config.leftMargin - config.rightMargin;
+
+    auto count = end - begin;
+    auto scale = (max != min) ? plotAreaHeight / (max - min) : 0.0;
+
+    auto yFlipTransform = config.plotHeight - config.bottomMargin;
+    int leftMargin = config.leftMargin;
+
+    points.resize(count);
+
+    VisitColumn(view.y, [&] (const auto& samples) {
+
+        for (size_t i = 0; i < count; i++) {
+            points[i].y = yFlipTransform - (int) (scale * (samples[begin + i] - min));
+        }
+    });
+
+    if (!view.HasX()) {
+
+        // spread the samples over the whole plot area, the last one lands on the right edge
+        auto xSpace = (count > 1) ? (float) (plotAreaWidth - 1) / (count - 1) : 0.0f;
+
+        for (size_t i = 0; i < count; i++) {
+            int x = i * xSpace;
+            points[i].x = x + leftMargin;
+        }
+
+        return;
+    }
+
+    auto xScale = (xMax != xMin) ? (plotAreaWidth - 1) / (xMax - xMin) : 0.0;
+
+    VisitColumn(view.x, [&] (const auto& xs) {
+
+        for (size_t i = 0; i < count; i++) {
+            points[i].x = leftMargin + (int) ((xs[begin + i] - xMin) * xScale);
+        }
+    });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Name: ScaleM4Columns
+// Desc: first -> min -> max -> last in each pixel column, joined to the previous column. Covers the same pixels as
+//       a min/max line per column plus a line from the previous column's last value. columnX is which pixel
+//       column each one is, empty when they're every column in order. min/max is the range the plot height covers.
+//----------------------------------------------------------------------------------------------------------------------
+inline void ScaleM4Columns(const SDLPlotConfiguration& config, const std::vector<M4Column>& columns, const std::vector<int>& columnX, double min, double max, std::vector<SDL_Point>& points) {
+
+    auto plotAreaHeight = config.plotHeight - config.bottomMargin - config.topMargin;
+    auto yFlipTransform = config.plotHeight - config.bottomMargin;
+
+    auto scale = (max != min) ? plotAreaHeight / (max - min) : 0.0;
+    auto toScreen = [scale, min, yFlipTransform] (double y) { return (int) yFlipTransform - (int) (scale * (y - min)); };
+
+    points.resize(columns.size() * 4);
+
+    for (size_t column = 0; column < columns.size(); column++) {
+
+        auto& m4 = columns[column];
+        int x = (columnX.empty() ? column : columnX[column]) + config.leftMargin;
+
+        auto point = &points[column * 4];
+
+        point[0].x = x;
+        point[0].y = toScreen(m4.first);
+        point[1].x = x;
+        point[1].y = toScreen(m4.min);
+        point[2].x = x;
+        point[2].y = toScreen(m4.max);
+        point[3].x = x;
+        point[3].y = toScreen(m4.last);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Name: SDLPlotConfiguration
+// Desc:
+//----------------------------------------------------------------------------------------------------------------------
+class SDLPlot {
+
+    SDL_Renderer* renderer; 
+
+    // grid, axes and titles, only redrawn when chromeDirty. Can be bigger than the plot after a resize
+    SDL_Texture* texture;
+    int textureWidth; 
+    int textureHeight; 
+    bool chromeDirty; 
+
+    typedef std::unique_ptr<SDL_Texture, TextureDeleter> sdl_texture_ptr; 
+
+    sdl_texture_ptr titleTextTexture;
+    sdl_texture_ptr xAxisTextTexture;
+    sdl_texture_ptr leftYAxisTextTexture;
+    sdl_texture_ptr rightYAxisTextTexture;
+
+    DrawGridInfo gridInfo; 
+
+    struct Series {
+        SeriesId id; 
+
+        // owned series keep their samples in yData, the others are read in place through view
+        bool owned; 
+        std::vector<double> yData;
+        SeriesView view; 
+        double min; 
+        double max; 
+
+        // level of detail index over the y values, built the first time the series is wider than the plot and kept up to 
+        // date as samples are appended
+        MinMaxPyramid pyramid; 
+        bool pyramidDirty; 
+
+        SDL_Color color; 
+        float lineWidth; 
+        bool antiAliased; 
+
+        // the polyline last drawn for this series, only rebuilt when its data, the window, its scale or the plot area 
+        // changes. It covers samples [shownBegin, shownEnd), which range from shownMin to shownMax, scaled so scaleMin 
+        // to scaleMax fills the plot height.
+        std::vector<SDL_Point> points; 
+        bool geometryDirty; 
+        size_t shownBegin; 
+        size_t shownEnd; 
+        double shownMin; 
+        double shownMax; 
+        double scaleMin; 
+        double scaleMax; 
+
+        // series drawn over another share its scale, which then covers all of them. 0 for a scale of its own. 
+        SeriesId scaleWith; 
+        double groupMin; 
+        double groupMax; 
+    }; 
+
+    // in the order they're drawn
+    std::vector<Series> dataSeries;
+    SeriesId nextSeriesId; 
+
+    // SeriesIndicator
+    // An indicator over a series. Its results are series of their own that are extended whenever the source grows.
+    struct SeriesIndicator {
+        SeriesId source; 
+        std::vector<SeriesId> outputs; 
+        Indicator state; 
+    }; 
+
+    std::vector<SeriesIndicator> indicators; 
+
+    // plot area the series geometry was built for
+    SDL_Rect seriesArea; 
+
+    // samples of every series DrawSeries shows, clipped to each series
+    size_t windowBegin; 
+    size_t windowEnd; 
+
+    // reused between calls to Plot so decimation and scaling don't allocate
+    std::vector<M4Column> decimatedColumns; 
+    std::vector<int> decimatedX; 
+    std::vector<int64_t> timeTicks; 
+    std::vector<SDL_Point> scaledPoints; 
+
+    // big series are decimated across this, borrowed from SetThreadPool or the canvas, or made the first time a series
+    // is big enough to need it with threadCount threads (0 for one per core)
+    ThreadPool* threadPool; 
+    std::unique_ptr<ThreadPool> ownedThreadPool; 
+    unsigned int threadCount; 
+
+    // candles from the last PlotCandles and what they were laid out for, so live bars only rebuild the last one
+    std::vector<OhlcBar> mergedBars; 
+    std::vector<DrawCandleInfo> candles; 
+    size_t candleBarCount; 
+    SDL_Rect candleArea; 
+    int32_t candleLow; 
+    int32_t candleHigh; 
+
+    // every line, gridline and tick goes through here
+    RenderBatch batch; 
+
+    // tick labels, owned by the font cache
+    GlyphAtlas* labelAtlas; 
+
+    // with a canvas instead of a renderer: the canvas everything is drawn onto, the chrome and the glyphs for text
+    PixelCanvas* canvas; 
+    PixelCanvas chromeCanvas; 
+
+    GlyphMasks* titleMasks; 
+    GlyphMasks* axisTitleMasks; 
+    GlyphMasks* labelMasks; 
+     
+    SDLPlotConfiguration plotConfiguration; 
+
+#ifdef SDLPLOT_PROFILE
+    // kept so the overlay doesn't allocate its stage list every frame
+    ProfileSummary profileSummary; 
+#endif
+
+public:
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: SDLPlot
+    // Desc: The plot makes its own chrome texture the first time it's drawn
+    //------------------------------------------------------------------------------------------------------------------
+    SDLPlot(SDL_Renderer* renderer, const SDLPlotConfiguration& configuration) : SDLPlot(renderer, nullptr, configuration) {}
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: SDLPlot
+    // Desc: Takes ownership of texture and uses it for the chrome for as long as it's big enough
+    //------------------------------------------------------------------------------------------------------------------
+    SDLPlot(SDL_Renderer* renderer, SDL_Texture* texture, const SDLPlotConfiguration& configuration) 
+        : renderer(renderer), texture(texture), textureWidth(0), textureHeight(0), chromeDirty(true), 
+          nextSeriesId(1), seriesArea(), windowBegin(0), windowEnd(SIZE_MAX), threadPool(nullptr), threadCount(0), candleBarCount(0), candleArea(), candleLow(0), candleHigh(0), batch(renderer), labelAtlas(nullptr), canvas(nullptr), titleMasks(nullptr), axisTitleMasks(nullptr), labelMasks(nullptr), 
+          plotConfiguration(configuration) 
+    {
+        SDL_QueryTexture(this->texture, nullptr, nullptr, &this->textureWidth, &this->textureHeight); 
+
+        SDL_Color color = {0xff, 0xff, 0xff, 0xff};
+        this->titleTextTexture = RenderTextToTexture(this->renderer, "OxygenMono-Regular.ttf", 30, "Plot Title", color); 
+        this->leftYAxisTextTexture = RenderTextToTexture(this->renderer, "OxygenMono-Regular.ttf", 15, "Left Y Axis", color); 
+        this->xAxisTextTexture = RenderTextToTexture(this->renderer, "OxygenMono-Regular.ttf", 15, "X Axis", color); 
+
+        this->labelAtlas = GetGlyphAtlas(this->renderer, "OxygenMono-Regular.ttf", 12); 
+        
+        this->InitGridInfo(); 
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: SDLPlot
+    // Desc: Draws onto canvas instead of through an SDL_Renderer. Nothing shows up until canvas->Render(), do that once
+    //       a frame after everything's been drawn.
+    //------------------------------------------------------------------------------------------------------------------
+    SDLPlot(PixelCanvas* canvas, const SDLPlotConfiguration& configuration) 
+        : renderer(nullptr), texture(nullptr), textureWidth(0), textureHeight(0), chromeDirty(true), 
+          nextSeriesId(1), seriesArea(), windowBegin(0), windowEnd(SIZE_MAX), threadPool(canvas->GetThreadPool()), threadCount(0), candleBarCount(0), candleArea(), candleLow(0), candleHigh(0), batch(nullptr), labelAtlas(nullptr), canvas(canvas), titleMasks(nullptr), axisTitleMasks(nullptr), labelMasks(nullptr), 
+          plotConfiguration(configuration) 
+    {
+        this->batch.SetCanvas(canvas); 
+
+        this->titleMasks = GetGlyphMasks("OxygenMono-Regular.ttf", 30); 
+        this->axisTitleMasks = GetGlyphMasks("OxygenMono-Regular.ttf", 15); 
+        this->labelMasks = GetGlyphMasks("OxygenMono-Regular.ttf", 12); 
+
+        this->InitGridInfo(); 
+    }
+
+    SDLPlot(const SDLPlot&) = delete; 
+    SDLPlot& operator=(const SDLPlot&) = delete; 
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: ~SDLPlot
+    // Desc:
+    //------------------------------------------------------------------------------------------------------------------
+    ~SDLPlot() 
+    {
+        SDL_DestroyTexture(this->texture);
+    }
+
+    const SDLPlotConfiguration& Configuration() const { return this->plotConfiguration; }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: SetConfiguration
+    // Desc: The chrome is redrawn on the next Draw
+    //------------------------------------------------------------------------------------------------------------------
+    void SetConfiguration(const SDLPlotConfiguration& configuration) {
+        this->plotConfiguration = configuration; 
+        this->UpdateGridInfo(); 
+        this->chromeDirty = true; 
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: Resize
+    // Desc: Nothing happens unless the size actually changed. The chrome texture is only reallocated when it's too
+    //       small, and then with some slack so dragging a window edge doesn't reallocate on every event.
+    //------------------------------------------------------------------------------------------------------------------
+    void Resize(int width, int height) {
+
+        if (width == this->plotConfiguration.plotWidth && height == this->plotConfiguration.plotHeight) {
+            return; 
+        }
+
+        this->plotConfiguration.plotWidth = width; 
+        this->plotConfiguration.plotHeight = height; 
+
+        this->UpdateGridInfo(); 
+        this->chromeDirty = true; 
+    }
+
+    // forces the chrome to be redrawn on the next Draw
+    void Invalidate() { this->chromeDirty = true; }
+
+    // the batch every draw goes through, mostly so callers can count draw calls
+    RenderBatch& Batch() { return this->batch; }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: Draw
+    // Desc: Copies the grid, axes and titles to the current render target. They're kept in their own texture and only
+    //       drawn again after the size or configuration changes, so a frame where nothing but the data changed costs a
+    //       single copy before the series go on top.
+    //------------------------------------------------------------------------------------------------------------------
+    void Draw() {
+
+        PROFILE_SCOPE("Draw");
+
+        if (this->renderer == nullptr && this->canvas == nullptr) {
+            return; 
+        }
+
+        if (this->chromeDirty && !this->DrawChrome()) {
+            return; 
+        }
+
+        SDL_Rect rect = {0, 0, this->plotConfiguration.plotWidth, this->plotConfiguration.plotHeight}; 
+
+        if (this->canvas != nullptr) {
+            this->canvas->Copy(this->chromeCanvas, rect); 
+        } else {
+            SDL_RenderCopy(this->renderer, this->texture, &rect, &rect); 
+            PROFILE_COUNT(ProfileCounter::DrawCalls, 1);
+            PROFILE_COUNT(ProfileCounter::Vertices, 4);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: DrawProfileOverlay
+    // Desc: FPS, frame time percentiles, the last frame's counters and the slowest stages in the top left of the plot
+    //       area. Does nothing unless built with SDLPLOT_PROFILE.
+    //------------------------------------------------------------------------------------------------------------------
+    void DrawProfileOverlay() {
+#ifdef SDLPLOT_PROFILE
+        if (this->labelAtlas == nullptr && this->labelMasks == nullptr) {
+            return; 
+        }
+
+        Profiler::Get().Summarize(this->profileSummary); 
+
+        auto& summary = this->profileSummary; 
+        char line[128]; 
+
+        auto x = this->plotConfiguration.leftMargin + 6; 
+        auto y = this->plotConfiguration.topMargin + 4; 
+        auto lineHeight = this->LabelHeight(); 
+
+        snprintf(line, sizeof(line), "%.1f fps  p50 %.2f  p95 %.2f  p99 %.2f ms", summary.fps, summary.p50, summary.p95, summary.p99); 
+        this->AddLabel(x, y, line); 
+        y += lineHeight; 
+
+        snprintf(line, sizeof(line), "%llu draws  %llu vertices  %llu uploads", 
+            static_cast<unsigned long long>(summary.counters[static_cast<int>(ProfileCounter::DrawCalls)]), 
+            static_cast<unsigned long long>(summary.counters[static_cast<int>(ProfileCounter::Vertices)]), 
+            static_cast<unsigned long long>(summary.counters[static_cast<int>(ProfileCounter::TextureUploads)])); 
+        this->AddLabel(x, y, line); 
+        y += lineHeight; 
+
+        // the frame itself is always the slowest, it's already in the first line
+        for (size_t i = 0, shown = 0; i < summary.stages.size() && shown < 8; i++) {
+
+            if (strcmp(summary.stages[i].name, "Frame") == 0) {
+                continue; 
+            }
+
+            snprintf(line, sizeof(line), "%-20s %7.3f ms %5.1fx", summary.stages[i].name, summary.stages[i].milliseconds, summary.stages[i].calls); 
+            this->AddLabel(x, y, line); 
+            y += lineHeight; 
+            shown++; 
+        }
+
+        if (this->labelAtlas != nullptr) {
+            this->labelAtlas->Flush(); 
+        }
+#endif
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: Plot
+    // Desc: Series with more samples than the plot has pixel columns are decimated to first/min/max/last per column
+    //       first so the draw cost stays at O(width) whatever the length. The whole series goes out as one polyline,
+    //       or one batch of triangles when lineWidth > 1 or it's antiAliased.
+    //-------------------------------------------------------------------------------------------------------------------
+    void Plot(const std::vector<double>& yData, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+        this->Plot(SeriesView(yData), color, lineWidth, antiAliased);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: Plot
+    // Desc: Reads the samples straight out of view, whatever their type and layout, without copying them
+    //-------------------------------------------------------------------------------------------------------------------
+    void Plot(const SeriesView& view, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+
+        PROFILE_SCOPE("Plot");
+
+        // need at least one segment
+        if (view.count < 2) {
+            return;
+        }
+
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+
+        if (plotAreaWidth < 1) {
+            return;
+        }
+
+        double min;
+        double max;
+
+        // decimated columns carry their own range
+        if (view.count <= static_cast<size_t>(plotAreaWidth)) {
+            ColumnRange(view.y, 0, view.count, min, max);
+            this->ScaleView(view, 0, view.count, nullptr, min, max, this->scaledPoints);
+        } else {
+            this->DecimateView(view, 0, view.count, nullptr);
+            M4ColumnsRange(this->decimatedColumns, min, max);
+            this->ScaleColumns(this->decimatedColumns, this->decimatedX, min, max, this->scaledPoints);
+        }
+
+        this->FlushSeries(this->scaledPoints, color, lineWidth, antiAliased);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: PlotPoints
+    // Desc: Draws a polyline that's already in screen space, e.g. one a PlotPipeline worker scaled for this layout
+    //-------------------------------------------------------------------------------------------------------------------
+    void PlotPoints(const std::vector<SDL_Point>& points, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+
+        PROFILE_SCOPE("Plot");
+
+        if (points.size() < 2) {
+            return;
+        }
+
+        this->FlushSeries(points, color, lineWidth, antiAliased);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: PlotRange
+    // Desc: Plots yData[begin, end) using a pyramid built over yData, so zooming and panning around a huge series
+    //       costs O(width * log N) instead of a pass over everything visible.
+    //-------------------------------------------------------------------------------------------------------------------
+    void PlotRange(const std::vector<double>& yData, const MinMaxPyramid& pyramid, size_t begin, size_t end, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+
+        end = std::min(end, std::min(yData.size(), pyramid.size()));
+
+        if (begin >= end || end - begin < 2) {
+            return;
+        }
+
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+
+        if (plotAreaWidth < 1) {
+            return;
+        }
+
+        if (end - begin > static_cast<size_t>(plotAreaWidth)) {
+            double min;
+            double max;
+
+            pyramid.QueryM4(yData.data(), begin, end, plotAreaWidth, this->decimatedColumns);
+            M4ColumnsRange(this->decimatedColumns, min, max);
+
+            this->decimatedX.clear();
+            this->ScaleColumns(this->decimatedColumns, this->decimatedX, min, max, this->scaledPoints);
+        } else {
+            auto range = std::minmax_element(yData.begin() + begin, yData.begin() + end);
+            this->ScaleSamples(SeriesView(yData), begin, end, *range.first, *range.second, 0.0, 0.0, this->scaledPoints);
+        }
+
+        this->FlushSeries(this->scaledPoints, color, lineWidth, antiAliased);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: PlotTimeWindow
+    // Desc: Plots the samples of view with tBegin <= x < tEnd on a time axis, x being epoch ms (e.g. a TickColumns
+    //       time column), so gaps in the data show as gaps. The window's ends are found by binary search, or through
+    //       index when there is one over the same time column, so a pan or zoom only ever touches visible samples.
+    //       pyramid, when given, has to be built over the view's y values.
+    //-------------------------------------------------------------------------------------------------------------------
+    TimeWindow PlotTimeWindow(const SeriesView& view, int64_t tBegin, int64_t tEnd, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false,
+        const TimeIndex* index = nullptr, const MinMaxPyramid* pyramid = nullptr) {
+
+        TimeWindow window = {0, 0, 0.0, 0.0};
+
+        if (!view.HasX()) {
+            std::cout << "Error: PlotTimeWindow needs a view with a time column\n";
+            return window;
+        }
+
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+
+        if (plotAreaWidth < 1 || tEnd <= tBegin) {
+            return window;
+        }
+
+        if (index != nullptr) {
+            window.begin = index->LowerBound(tBegin);
+            window.end = index->LowerBound(tEnd);
+        } else {
+            window.begin = ColumnLowerBound(view.x, 0, view.count, tBegin);
+            window.end = ColumnLowerBound(view.x, window.begin, view.count, tEnd);
+        }
+
+        if (window.end - window.begin < 2) {
+            return window;
+        }
+
+        if (window.end - window.begin > static_cast<size_t>(plotAreaWidth)) {
+
+            this->decimatedX.clear();
+            this->DecimateByX(view, window.begin, window.end, tBegin, tEnd, pyramid);
+
+            M4ColumnsRange(this->decimatedColumns, window.min, window.max);
+            this->ScaleColumns(this->decimatedColumns, this->decimatedX, window.min, window.max, this->scaledPoints);
+        } else {
+            ColumnRange(view.y, window.begin, window.end, window.min, window.max);
+            this->ScaleSamples(view, window.begin, window.end, window.min, window.max, tBegin, tEnd, this->scaledPoints);
+        }
+
+        this->FlushSeries(this->scaledPoints, color, lineWidth, antiAliased);
+        return window;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: AddSeries
+    // Desc: Keeps yData to be drawn by DrawSeries on top of every series added before it. Returns the id to update,
+    //       append to or remove it with.
+    //-------------------------------------------------------------------------------------------------------------------
+    SeriesId AddSeries(std::vector<double> yData, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+
+        auto& series = this->NewSeries(color, lineWidth, antiAliased);
+        this->SetSeriesData(series, std::move(yData));
+
+        return series.id;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: AddSeries
+    // Desc: A series read in place through view, nothing is copied. The memory has to outlive the series.
+    //-------------------------------------------------------------------------------------------------------------------
+    SeriesId AddSeries(const SeriesView& view, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+
+        auto& series = this->NewSeries(color, lineWidth, antiAliased);
+        this->SetSeriesView(series, view);
+
+        return series.id;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: UpdateSeries
+    // Desc: Replaces every sample of a series. Only that series is rescaled on the next DrawSeries.
+    //-------------------------------------------------------------------------------------------------------------------
+    bool UpdateSeries(SeriesId id, std::vector<double> yData) {
+
+        auto series = this->FindSeries(id);
+
+        if (series == nullptr) {
+            return false;
+        }
+
+        this->SetSeriesData(*series, std::move(yData));
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: UpdateSeries
+    // Desc: Points a series at view. A view of the same memory with a bigger count is taken as samples appended to
+    //       the end, so a growing column only costs the new samples.
+    //-------------------------------------------------------------------------------------------------------------------
+    bool UpdateSeries(SeriesId id, const SeriesView& view) {
+
+        auto series = this->FindSeries(id);
+
+        if (series == nullptr) {
+            return false;
+        }
+
+        this->SetSeriesView(*series, view);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: AppendSeries
+    // Desc: Adds samples to the end of a series the plot owns the samples of. Its range and pyramid are extended
+    //       rather than rebuilt.
+    //-------------------------------------------------------------------------------------------------------------------
+    bool AppendSeries(SeriesId id, const double* yData, size_t count) {
+
+        auto series = this->FindSeries(id);
+
+        if (series == nullptr) {
+            return false;
+        }
+
+        if (!series->owned) {
+            std::cout << "Error: series " << id << " is a view, UpdateSeries it with the longer view instead\n";
+            return false;
+        }
+
+        auto oldCount = series->yData.size();
+        series->yData.insert(series->yData.end(), yData, yData + count);
+
+        this->GrowSeries(*series, oldCount);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SetSeriesStyle
+    // Desc: Color and line style only, the geometry is kept
+    //-------------------------------------------------------------------------------------------------------------------
+    bool SetSeriesStyle(SeriesId id, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+
+        auto series = this->FindSeries(id);
+
+        if (series == nullptr) {
+            return false;
+        }
+
+        series->color = color;
+        series->lineWidth = lineWidth;
+        series->antiAliased = antiAliased;
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: RemoveSeries
+    // Desc: The others keep their order and their geometry
+    //-------------------------------------------------------------------------------------------------------------------
+    bool RemoveSeries(SeriesId id) {
+
+        auto series = this->FindSeries(id);
+
+        if (series == nullptr) {
+            return false;
+        }
+
+        this->dataSeries.erase(this->dataSeries.begin() + (series - this->dataSeries.data()));
+
+        // indicators over it stop, and so does one that's lost an output. Whatever they've computed stays as it is.
+        this->indicators.erase(std::remove_if(this->indicators.begin(), this->indicators.end(), [id] (const SeriesIndicator& indicator) {
+            return indicator.source == id || std::find(indicator.outputs.begin(), indicator.outputs.end(), id) != indicator.outputs.end();
+        }), this->indicators.end());
+
+        return true;
+    }
+
+    size_t SeriesCount() const { return this->dataSeries.size(); }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SeriesRange
+    // Desc: Sample count and min/max of a series, without a pass over it
+    //-------------------------------------------------------------------------------------------------------------------
+    bool SeriesRange(SeriesId id, size_t& count, double& min, double& max) {
+
+        auto series = this->FindSeries(id);
+
+        if (series == nullptr) {
+            return false;
+        }
+
+        count = ViewOf(*series).count;
+
+        if (count == 0) {
+            return false;
+        }
+
+        min = series->min;
+        max = series->max;
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SeriesWindowRange
+    // Desc: Which samples of a series the last DrawSeries showed and the range the plot height covered, which is wider
+    //       than theirs when it shares its scale with an overlay. For the axis labels.
+    //-------------------------------------------------------------------------------------------------------------------
+    bool SeriesWindowRange(SeriesId id, size_t& begin, size_t& end, double& min, double& max) {
+
+        auto series = this->FindSeries(id);
+
+        if (series == nullptr || series->geometryDirty || series->shownEnd - series->shownBegin < 2) {
+            return false;
+        }
+
+        begin = series->shownBegin;
+        end = series->shownEnd;
+        min = series->scaleMin;
+        max = series->scaleMax;
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SetThreadPool
+    // Desc: Decimates big series across pool, which the plot doesn't own and which mustn't be running anything else
+    //       while the plot draws. A plot on a canvas uses the canvas's pool until told otherwise.
+    //-------------------------------------------------------------------------------------------------------------------
+    void SetThreadPool(ThreadPool* pool) {
+        this->ownedThreadPool.reset(); 
+        this->threadPool = pool; 
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SetThreadCount
+    // Desc: Decimates big series across a pool of the plot's own with threadCount threads, 0 for one per core. The pool
+    //       is started the first time a series is big enough to use it and kept from then on.
+    //-------------------------------------------------------------------------------------------------------------------
+    void SetThreadCount(unsigned int threadCount) {
+        this->ownedThreadPool.reset(); 
+        this->threadPool = nullptr; 
+        this->threadCount = threadCount; 
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SetSeriesWindow
+    // Desc: DrawSeries only shows samples [begin, end) of each series, stretched across the plot. Zoomed in costs the
+    //       same as zoomed out since the window is decimated through the series' pyramid. 0, SIZE_MAX shows everything.
+    //-------------------------------------------------------------------------------------------------------------------
+    void SetSeriesWindow(size_t begin, size_t end) {
+
+        if (begin == this->windowBegin && end == this->windowEnd) {
+            return;
+        }
+
+        this->windowBegin = begin;
+        this->windowEnd = end;
+
+        for (auto& series : this->dataSeries) {
+            series.geometryDirty = true;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: DrawSeries
+    // Desc: Draws every series in the order they were added, each scaled to its own range. A series whose data hasn't
+    //       changed since the last DrawSeries goes out from its cached polyline; a resize rebuilds them all.
+    //-------------------------------------------------------------------------------------------------------------------
+    void DrawSeries() {
+
+        PROFILE_SCOPE("DrawSeries");
+
+        auto plotAreaHeight = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin - this->plotConfiguration.topMargin;
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+
+        if (plotAreaWidth < 1 || plotAreaHeight < 1) {
+            return;
+        }
+
+        SDL_Rect area = {static_cast<int>(this->plotConfiguration.leftMargin), static_cast<int>(this->plotConfiguration.topMargin), 
+                         static_cast<int>(plotAreaWidth), static_cast<int>(plotAreaHeight)};
+        auto moved = (area.x != this->seriesArea.x || area.y != this->seriesArea.y || area.w != this->seriesArea.w || area.h != this->seriesArea.h);
+
+        this->seriesArea = area;
+
+        // every window's range first, which is cheap through the pyramids, so each scale group knows its range before 
+        // anything is decimated
+        for (auto& series : this->dataSeries) {
+
+            if (series.geometryDirty || moved) {
+                this->UpdateSeriesWindow(series);
+                series.geometryDirty = true;
+            }
+
+            auto shown = series.shownEnd - series.shownBegin >= 2;
+
+            series.groupMin = shown ? series.shownMin : std::numeric_limits<double>::infinity();
+            series.groupMax = shown ? series.shownMax : -std::numeric_limits<double>::infinity();
+        }
+
+        for (auto& series : this->dataSeries) {
+
+            auto& anchor = this->ScaleAnchor(series);
+
+            if (&anchor != &series) {
+                anchor.groupMin = std::min(anchor.groupMin, series.groupMin);
+                anchor.groupMax = std::max(anchor.groupMax, series.groupMax);
+            }
+        }
+
+        for (auto& series : this->dataSeries) {
+
+            auto& anchor = this->ScaleAnchor(series);
+
+            if (series.geometryDirty || anchor.groupMin != series.scaleMin || anchor.groupMax != series.scaleMax) {
+                this->BuildSeriesGeometry(series, anchor.groupMin, anchor.groupMax);
+            }
+
+            this->FlushSeries(series.points, series.color, series.lineWidth, series.antiAliased);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: AddIndicator
+    // Desc: Computes an indicator over a series and adds its results as series of their own, drawn on top in color: 
+    //       one for most indicators, middle, upper and lower for Bollinger. Returns their ids. Price scale indicators 
+    //       share the source's scale so they line up with it. They're extended a sample at a time as the source is 
+    //       appended to and recomputed when it's replaced.
+    //-------------------------------------------------------------------------------------------------------------------
+    std::vector<SeriesId> AddIndicator(SeriesId source, const IndicatorSpec& spec, SDL_Color color, float lineWidth = 1.0f, bool antiAliased = false) {
+
+        if (this->FindSeries(source) == nullptr) {
+            return {};
+        }
+
+        SeriesIndicator indicator = {source, {}, Indicator(spec)};
+
+        for (size_t i = 0; i < spec.OutputCount(); i++) {
+            
+            auto& output = this->NewSeries(color, lineWidth, antiAliased);
+            output.owned = true;
+            output.scaleWith = spec.OnPriceScale() ? source : 0;
+
+            indicator.outputs.push_back(output.id);
+        }
+
+        this->indicators.push_back(std::move(indicator));
+
+        // the new series may have moved the source
+        this->UpdateIndicator(this->indicators.back(), *this->FindSeries(source), 0);
+
+        return this->indicators.back().outputs;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: PlotCandles
+    // Desc: A candle per bar across the plot area. Up bars (close >= open) are drawn in upColor and down bars in
+    //       downColor, and each color goes out as one batch of rects. When there are more bars than pixel columns,
+    //       the bars sharing a column are merged into one candle first.
+    //-------------------------------------------------------------------------------------------------------------------
+    void PlotCandles(const std::vector<OhlcBar>& bars, SDL_Color upColor, SDL_Color downColor) {
+        this->UpdateCandles(bars, 0);
+        this->DrawCandles(upColor, downColor);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: PlotCandles
+    // Desc: Live bars. Only the candles for bars past builder.FirstDirty() are rebuilt, usually just the last one, and
+    //       the builder's dirty range is cleared. Everything gets rebuilt when a bar is added or the chart's high/low
+    //       moves, since that shifts every candle.
+    //-------------------------------------------------------------------------------------------------------------------
+    void PlotCandles(BarBuilder& builder, SDL_Color upColor, SDL_Color downColor) {
+        this->UpdateCandles(builder.Bars(), builder.FirstDirty());
+        builder.ClearDirty();
+
+        this->DrawCandles(upColor, downColor);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: DrawTickLabels
+    // Desc: Labels every tick on both axes with its value, the axes running from xMin to xMax and yMin to yMax. All of
+    //       the labels are quads out of one glyph atlas and go out as one draw call.
+    //-------------------------------------------------------------------------------------------------------------------
+    void DrawTickLabels(double xMin, double xMax, double yMin, double yMax) {
+
+        PROFILE_SCOPE("DrawTickLabels");
+
+        if (this->labelAtlas == nullptr && this->labelMasks == nullptr) {
+            return; 
+        }
+
+        auto& config = this->plotConfiguration; 
+        char text[32]; 
+
+        auto xCount = this->gridInfo.xCount + 1; 
+
+        this->AddValueLabels(yMin, yMax); 
+
+        auto fx = [this, &config, &text, xCount, xMin, xMax] (const DrawIntervalInfo& info) 
+        {
+            auto value = xMin + (xMax - xMin) * info.index / (xCount - 1); 
+            snprintf(text, sizeof(text), "%.4g", value); 
+
+            auto x = info.x - this->MeasureLabel(text) / 2; 
+            auto y = info.y + 4; 
+
+            this->AddLabel(x, y, text); 
+        };
+
+        DrawOnRepeatingInterval(this->renderer, 
+            config.leftMargin, config.plotHeight - config.bottomMargin, 
+            config.plotWidth - config.rightMargin, config.plotHeight - config.bottomMargin,
+            xCount, 0.0, false, true, fx); 
+
+        if (this->labelAtlas != nullptr) {
+            this->labelAtlas->Flush(); 
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: DrawTimeTickLabels
+    // Desc: DrawTickLabels for a time axis from tBegin to tEnd (epoch ms). The x ticks are calendar aligned rather than
+    //       on the grid, as many as fit without the labels running into each other, each with its own mark.
+    //-------------------------------------------------------------------------------------------------------------------
+    void DrawTimeTickLabels(int64_t tBegin, int64_t tEnd, double yMin, double yMax) {
+
+        PROFILE_SCOPE("DrawTickLabels");
+
+        if ((this->labelAtlas == nullptr && this->labelMasks == nullptr) || tEnd <= tBegin) {
+            return; 
+        }
+
+        auto& config = this->plotConfiguration; 
+        char text[32]; 
+
+        this->AddValueLabels(yMin, yMax); 
+
+        auto plotAreaWidth = config.plotWidth - config.leftMargin - config.rightMargin; 
+        auto bottom = config.plotHeight - config.bottomMargin; 
+
+        // room for the widest label and a gap
+        auto maxTicks = plotAreaWidth / (this->MeasureLabel("May 2017") + 24); 
+        auto step = CalendarTicks(tBegin, tEnd, maxTicks, this->timeTicks); 
+        auto xScale = (double) (plotAreaWidth - 1) / (tEnd - tBegin); 
+
+        this->batch.SetColor(0xFFFFFFFF); 
+
+        for (auto t : this->timeTicks) {
+
+            int x = config.leftMargin + (int) ((t - tBegin) * xScale); 
+            FormatTimeTick(t, step, text, sizeof(text)); 
+
+            this->AddLabel(x - this->MeasureLabel(text) / 2, bottom + 4, text); 
+            this->batch.AddVerticalLine(x, bottom, bottom - 5); 
+        }
+
+        this->batch.FlushRects(); 
+
+        if (this->labelAtlas != nullptr) {
+            this->labelAtlas->Flush(); 
+        }
+    }
+
+private:
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: ScaleView
+    // Desc: Screen space polyline for samples [begin, end) of view with min/max spanning the plot height. Ranges wider
+    //       than the plot are decimated first, through pyramid when there is one.
+    //-------------------------------------------------------------------------------------------------------------------
+    void ScaleView(const SeriesView& view, size_t begin, size_t end, const MinMaxPyramid* pyramid, double min, double max, std::vector<SDL_Point>& points) {
+
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+
+        if (end - begin <= static_cast<size_t>(plotAreaWidth)) {
+
+            // an x column runs the plot from its first value to its last
+            auto xMin = view.HasX() ? ColumnAt(view.x, begin) : 0.0;
+            auto xMax = view.HasX() ? ColumnAt(view.x, end - 1) : 0.0;
+
+            this->ScaleSamples(view, begin, end, min, max, xMin, xMax, points);
+            return;
+        }
+
+        this->DecimateView(view, begin, end, pyramid);
+        this->ScaleColumns(this->decimatedColumns, this->decimatedX, min, max, points);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: DecimateView
+    // Desc: Columns of samples [begin, end) of view into decimatedColumns, by x value when there's an x column, through
+    //       pyramid when there is one. Expects more samples than the plot is wide.
+    //-------------------------------------------------------------------------------------------------------------------
+    void DecimateView(const SeriesView& view, size_t begin, size_t end, const MinMaxPyramid* pyramid) {
+
+        auto count = end - begin;
+        auto width = static_cast<size_t>(this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin);
+
+        this->decimatedX.clear();
+
+        if (view.HasX()) {
+            this->DecimateByX(view, begin, end, ColumnAt(view.x, begin), ColumnAt(view.x, end - 1), pyramid);
+            return;
+        }
+
+        VisitColumn(view.y, [this, pyramid, begin, end, count, width] (const auto& samples) {
+            if (pyramid != nullptr) {
+                pyramid->QueryM4(samples, begin, end, width, this->decimatedColumns);
+            } else {
+                DecimateM4(samples + begin, count, width, this->decimatedColumns, this->DecimationPool(count, width));
+            }
+        });
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: DecimationPool
+    // Desc: The pool to decimate count samples into width columns across, starting the plot's own if it needs one and
+    //       count is big enough to be split. Smaller series get a pool of the calling thread alone.
+    //-------------------------------------------------------------------------------------------------------------------
+    ThreadPool& DecimationPool(size_t count, size_t width) {
+
+        static ThreadPool callingThread(1); 
+
+        if (this->threadPool == nullptr) {
+
+            if (DecimateM4ChunkCount(count, width, std::max(2u, this->threadCount)) < 2) {
+                return callingThread; 
+            }
+
+            this->ownedThreadPool.reset(new ThreadPool(this->threadCount)); 
+            this->threadPool = this->ownedThreadPool.get(); 
+        }
+
+        return *this->threadPool; 
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: DecimateByX
+    // Desc: Columns of samples [begin, end) by x value rather than by index, the plot running from xMin to xMax: each
+    //       pixel column gets the samples whose x lands in it, found by binary search, so x has to be ascending.
+    //       Columns nobody lands in are left out.
+    //-------------------------------------------------------------------------------------------------------------------
+    void DecimateByX(const SeriesView& view, size_t begin, size_t end, double xMin, double xMax, const MinMaxPyramid* pyramid) {
+
+        auto width = static_cast<size_t>(this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin);
+
+        this->decimatedColumns.clear();
+
+        VisitColumn(view.y, [this, &view, pyramid, width, begin, end, xMin, xMax] (const auto& samples) {
+
+            auto start = begin;
+
+            for (size_t column = 0; column < width && start < end; column++) {
+
+                auto stop = (column + 1 == width) ? end : ColumnLowerBound(view.x, start, end, xMin + (xMax - xMin) * (column + 1) / width);
+
+                if (stop == start) {
+                    continue;
+                }
+
+                double first = samples[start];
+                double last = samples[stop - 1];
+
+                MinMax minMax = {first, first};
+
+                if (pyramid != nullptr) {
+                    minMax = pyramid->Query(samples, start, stop);
+                } else {
+                    SampleRange(samples, start + 1, stop, minMax.min, minMax.max);
+                }
+
+                M4Column m4 = {first, minMax.min, minMax.max, last};
+
+                this->decimatedColumns.push_back(m4);
+                this->decimatedX.push_back(static_cast<int>(column));
+
+                start = stop;
+            }
+        });
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: ScaleSamples
+    // Desc:
+    //-------------------------------------------------------------------------------------------------------------------
+    void ScaleSamples(const SeriesView& view, size_t begin, size_t end, double min, double max, double xMin, double xMax, std::vector<SDL_Point>& points) {
+        ::ScaleSamples(this->plotConfiguration, view, begin, end, min, max, xMin, xMax, points);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: ScaleColumns
+    // Desc:
+    //-------------------------------------------------------------------------------------------------------------------
+    void ScaleColumns(const std::vector<M4Column>& columns, const std::vector<int>& columnX, double min, double max, std::vector<SDL_Point>& points) {
+        ScaleM4Columns(this->plotConfiguration, columns, columnX, min, max, points);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: NewSeries
+    // Desc: An empty series on top of the others
+    //-------------------------------------------------------------------------------------------------------------------
+    Series& NewSeries(SDL_Color color, float lineWidth, bool antiAliased) {
+
+        Series series;
+        series.id = this->nextSeriesId++;
+        series.owned = false;
+        series.min = 0.0;
+        series.max = 0.0;
+        series.pyramidDirty = true;
+        series.color = color;
+        series.lineWidth = lineWidth;
+        series.antiAliased = antiAliased;
+        series.geometryDirty = true;
+        series.shownBegin = 0;
+        series.shownEnd = 0;
+        series.shownMin = 0.0;
+        series.shownMax = 0.0;
+        series.scaleMin = 0.0;
+        series.scaleMax = 0.0;
+        series.scaleWith = 0;
+        series.groupMin = 0.0;
+        series.groupMax = 0.0;
+
+        this->dataSeries.push_back(std::move(series));
+        return this->dataSeries.back();
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: FindSeries
+    // Desc: Linear, there are only ever a few dozen
+    //-------------------------------------------------------------------------------------------------------------------
+    Series* FindSeries(SeriesId id) {
+
+        for (auto& series : this->dataSeries) {
+            if (series.id == id) {
+                return &series;
+            }
+        }
+
+        std::cout << "Error: no series " << id << "\n";
+        return nullptr;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: ViewOf
+    // Desc: Owned samples are viewed fresh every time since appending can move them
+    //-------------------------------------------------------------------------------------------------------------------
+    static SeriesView ViewOf(const Series& series) {
+        return series.owned ? SeriesView(series.yData) : series.view;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SetSeriesData
+    // Desc:
+    //-------------------------------------------------------------------------------------------------------------------
+    void SetSeriesData(Series& series, std::vector<double> yData) {
+
+        series.owned = true;
+        series.yData = std::move(yData);
+        series.view = SeriesView();
+
+        this->ResetSeries(series);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: SetSeriesView
+    // Desc:
+    //-------------------------------------------------------------------------------------------------------------------
+    void SetSeriesView(Series& series, const SeriesView& view) {
+
+        auto grown = !series.owned && view.SameData(series.view) && view.count >= series.view.count;
+        auto oldCount = series.view.count;
+
+        series.owned = false;
+        series.view = view;
+        std::vector<double>().swap(series.yData);
+
+        if (grown) {
+            this->GrowSeries(series, oldCount);
+        } else {
+            this->ResetSeries(series);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: ResetSeries
+    // Desc: Every sample of series is new
+    //-------------------------------------------------------------------------------------------------------------------
+    void ResetSeries(Series& series) {
+
+        auto view = ViewOf(series);
+
+        if (view.count > 0) {
+            ColumnRange(view.y, 0, view.count, series.min, series.max);
+        }
+
+        series.pyramidDirty = true;
+        series.geometryDirty = true;
+
+        this->UpdateIndicators(series, 0);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: GrowSeries
+    // Desc: The first oldCount samples of series are the same as before, only the rest need looking at
+    //-------------------------------------------------------------------------------------------------------------------
+    void GrowSeries(Series& series, size_t oldCount) {
+
+        auto view = ViewOf(series);
+
+        if (view.count == oldCount) {
+            return;
+        }
+
+        double min;
+        double max;
+        ColumnRange(view.y, oldCount, view.count, min, max);
+
+        series.min = (oldCount > 0) ? std::min(series.min, min) : min;
+        series.max = (oldCount > 0) ? std::max(series.max, max) : max;
+
+        if (!series.pyramidDirty) {
+            VisitColumn(view.y, [&series, &view] (const auto& samples) { series.pyramid.Append(samples, view.count); });
+        }
+
+        series.geometryDirty = true;
+
+        this->UpdateIndicators(series, oldCount);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: UpdateIndicators
+    // Desc: Every indicator over source, which has new samples from oldCount on
+    //-------------------------------------------------------------------------------------------------------------------
+    void UpdateIndicators(const Series& source, size_t oldCount) {
+
+        for (auto& indicator : this->indicators) {
+            if (indicator.source == source.id) {
+                this->UpdateIndicator(indicator, source, oldCount);
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: UpdateIndicator
+    // Desc: Runs the new samples of source through the indicator straight into the end of its output series. From 
+    //       oldCount 0 it starts over.
+    //-------------------------------------------------------------------------------------------------------------------
+    void UpdateIndicator(SeriesIndicator& indicator, const Series& source, size_t oldCount) {
+
+        auto view = ViewOf(source);
+
+        if (oldCount == 0 || indicator.state.size() != oldCount) {
+            indicator.state.Reset();
+            oldCount = 0;
+        }
+
+        Series* outputs[3];
+        double* results[3];
+
+        for (size_t i = 0; i < indicator.outputs.size(); i++) {
+
+            outputs[i] = this->FindSeries(indicator.outputs[i]);
+
+            if (outputs[i] == nullptr) {
+                return;
+            }
+
+            outputs[i]->yData.resize(view.count);
+            results[i] = outputs[i]->yData.data() + oldCount;
+        }
+
+        auto& state = indicator.state;
+        auto sessions = view.HasX() && state.Spec().type == IndicatorType::Vwap && state.Spec().session > 0;
+
+        VisitColumn(view.y, [&] (const auto& prices) {
+            if (sessions) {
+                state.AddBatch(prices, UnitVolume(), ColumnTimes{&view.x}, oldCount, view.count, results);
+            } else {
+                state.AddBatch(prices, oldCount, view.count, results);
+            }
+        });
+
+        for (size_t i = 0; i < indicator.outputs.size(); i++) {
+            if (oldCount == 0) {
+                this->ResetSeries(*outputs[i]);
+            } else {
+                this->GrowSeries(*outputs[i], oldCount);
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: ScaleAnchor
+    // Desc: The series whose scale series is drawn on, which is series itself unless it shares another's
+    //-------------------------------------------------------------------------------------------------------------------
+    Series& ScaleAnchor(Series& series) {
+
+        if (series.scaleWith != 0) {
+            for (auto& other : this->dataSeries) {
+                if (other.id == series.scaleWith) {
+                    return other;
+                }
+            }
+        }
 
-    SDLPlotConfiguration() {
-        // TODO: set defaults here
+        return series;
     }
-}; 
 
-//----------------------------------------------------------------------------------------------------------------------
-// Name: SDLPlotConfiguration
-// Desc:
-//----------------------------------------------------------------------------------------------------------------------
-class SDLPlot {
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: UpdateSeriesWindow
+    // Desc: Which samples of the series the window covers and their range. Windows wider than the plot get their range
+    //       from the series' pyramid, which is built the first time it's needed and then kept up to date as the series 
+    //       grows.
+    //-------------------------------------------------------------------------------------------------------------------
+    void UpdateSeriesWindow(Series& series) {
 
-    SDL_Renderer* renderer; 
-    SDL_Texture* texture;
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+        auto view = ViewOf(series);
 
-    typedef std::unique_ptr<SDL_Texture, std::function<void(SDL_Texture*)>> sdl_texture_ptr; 
+        auto begin = std::min(this->windowBegin, view.count);
+        auto end = std::max(begin, std::min(this->windowEnd, view.count));
 
-    sdl_texture_ptr titleTextTexture;
-    sdl_texture_ptr xAxisTextTexture;
-    sdl_texture_ptr leftYAxisTextTexture;
-    sdl_texture_ptr rightYAxisTextTexture;
+        series.shownBegin = begin;
+        series.shownEnd = end;
 
-    DrawGridInfo gridInfo; 
+        if (end - begin < 2) {
+            return;
+        }
 
-    struct Series {
-        std::vector<int> xData;  
-        std::vector<int> yData;
+        if (end - begin == view.count) {
+            series.shownMin = series.min;
+            series.shownMax = series.max;
+            return;
+        }
 
-        uint32_t color; 
-    }; 
+        if (end - begin <= static_cast<size_t>(plotAreaWidth)) {
+            ColumnRange(view.y, begin, end, series.shownMin, series.shownMax);
+            return;
+        }
 
-    std::list<Series> dataSeries;
-     
-    SDLPlotConfiguration plotConfiguration; 
+        if (series.pyramidDirty) {
+            VisitColumn(view.y, [&series, &view] (const auto& samples) { series.pyramid.Build(samples, view.count); });
+            series.pyramidDirty = false;
+        }
 
-public:
+        auto range = VisitColumn(view.y, [&series, begin, end] (const auto& samples) { return series.pyramid.Query(samples, begin, end); });
 
-    //------------------------------------------------------------------------------------------------------------------
-    // Name: SDLPlot
-    // Desc:
-    //------------------------------------------------------------------------------------------------------------------
-    SDLPlot(SDL_Renderer* renderer, SDL_Texture* texture, const SDLPlotConfiguration& configuration) 
-        : renderer(renderer), texture(texture), plotConfiguration(configuration) 
-    {
-        SDL_Color color = {0xff, 0xff, 0xff, 0xff};
-        this->titleTextTexture = RenderTextToTexture(this->renderer, "OxygenMono-Regular.ttf", 30, "Plot Title", color); 
-        this->leftYAxisTextTexture = RenderTextToTexture(this->renderer, "OxygenMono-Regular.ttf", 15, "Left Y Axis", color); 
-        this->xAxisTextTexture = RenderTextToTexture(this->renderer, "OxygenMono-Regular.ttf", 15, "X Axis", color); 
-        
-        this->gridInfo.color = 0x4f4f4fff;  
-        this->gridInfo.x = this->plotConfiguration.leftMargin;
-        this->gridInfo.y = this->plotConfiguration.topMargin; 
-        this->gridInfo.width = this->plotConfiguration.plotWidth - this->plotConfiguration.rightMargin; 
-        this->gridInfo.height = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin;
-        this->gridInfo.xCount = 12; 
-        this->gridInfo.yCount = 12;
-        this->gridInfo.dotted = false; 
+        series.shownMin = range.min;
+        series.shownMax = range.max;
     }
 
-    //------------------------------------------------------------------------------------------------------------------
-    // Name: ~SDLPlot
-    // Desc:
-    //------------------------------------------------------------------------------------------------------------------
-    ~SDLPlot() 
-    {
-        SDL_DestroyTexture(this->texture);
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: BuildSeriesGeometry
+    // Desc: The series' window with min to max filling the plot height. Windows wider than the plot are decimated 
+    //       through the series' pyramid.
+    //-------------------------------------------------------------------------------------------------------------------
+    void BuildSeriesGeometry(Series& series, double min, double max) {
+
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+        auto view = ViewOf(series);
+
+        auto begin = series.shownBegin;
+        auto end = series.shownEnd;
+
+        series.geometryDirty = false;
+        series.scaleMin = min;
+        series.scaleMax = max;
+
+        if (end - begin < 2) {
+            series.points.clear();
+            return;
+        }
+
+        auto decimated = end - begin > static_cast<size_t>(plotAreaWidth);
+
+        if (decimated && series.pyramidDirty) {
+            VisitColumn(view.y, [&series, &view] (const auto& samples) { series.pyramid.Build(samples, view.count); });
+            series.pyramidDirty = false;
+        }
+
+        this->ScaleView(view, begin, end, decimated ? &series.pyramid : nullptr, min, max, series.points);
     }
 
-    //------------------------------------------------------------------------------------------------------------------
-    // Name: Draw
-    // Desc:
-    //------------------------------------------------------------------------------------------------------------------
-    void Draw() {
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: UpdateCandles
+    // Desc: Rebuilds the candles for bars[firstDirty, end), or all of them if the layout has changed underneath
+    //-------------------------------------------------------------------------------------------------------------------
+    void UpdateCandles(const std::vector<OhlcBar>& bars, size_t firstDirty) {
 
-        if (!this->ValidateConfig()) {
+        auto plotAreaHeight = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin - this->plotConfiguration.topMargin;
+        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin;
+
+        if (bars.empty() || plotAreaWidth < 1 || plotAreaHeight < 1) {
+            this->candles.clear();
+            this->candleBarCount = 0;
             return;
         }
 
-        SDL_SetRenderTarget(this->renderer, this->texture); 
-        SDL_RenderClear(this->renderer); 
+        SDL_Rect area = {static_cast<int>(this->plotConfiguration.leftMargin), static_cast<int>(this->plotConfiguration.topMargin), 
+                         static_cast<int>(plotAreaWidth), static_cast<int>(plotAreaHeight)};
 
-        DrawGrid(this->renderer, this->gridInfo); 
+        if (bars.size() != this->candleBarCount || area.x != this->candleArea.x || area.y != this->candleArea.y || area.w != this->candleArea.w || area.h != this->candleArea.h) {
+            firstDirty = 0;
+        }
 
-        SDL_SetRenderDrawColor(this->renderer, 0xFF, 0xFF, 0xFF, 0xFF); 
+        firstDirty = std::min(firstDirty, bars.size());
 
-        // draw y axis
-        auto y2 = this->plotConfiguration.plotHeight - this->plotConfiguration.topMargin; 
-        SDL_RenderDrawLine(this->renderer, this->plotConfiguration.leftMargin, this->plotConfiguration.topMargin, this->plotConfiguration.leftMargin, y2); 
+        auto* drawn = &bars;
+        auto firstDrawn = firstDirty;
 
-        // draw x axis 
-        auto x2 = this->plotConfiguration.plotWidth - this->plotConfiguration.rightMargin; 
-        auto y = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin; 
-        SDL_RenderDrawLine(this->renderer, this->plotConfiguration.leftMargin, y, x2, y); 
+        if (bars.size() > static_cast<size_t>(plotAreaWidth)) {
 
-        // draw spikes on axis
-        this->DrawAxisIncrements(this->gridInfo);
+            // back up to the column the first dirty bar is merged into
+            auto column = std::min<size_t>(plotAreaWidth - 1, (firstDirty * plotAreaWidth) / bars.size());
 
-        // draw titles
-        this->DrawTitles();
-        
-        // TODO: draw annotation/captions etc
+            while (column > 0 && M4ColumnStart(column, bars.size(), plotAreaWidth) > firstDirty) {
+                column--;
+            }
+
+            this->mergedBars.resize(std::min(column, this->mergedBars.size()));
+
+            for (auto i = this->mergedBars.size(); i < static_cast<size_t>(plotAreaWidth); i++) {
+
+                auto start = M4ColumnStart(i, bars.size(), plotAreaWidth);
+                auto end = M4ColumnStart(i + 1, bars.size(), plotAreaWidth);
+
+                auto merged = bars[start];
+
+                for (auto j = start + 1; j < end; j++) {
+                    MergeBar(merged, bars[j]);
+                }
 
-        SDL_RenderCopy(this->renderer, this->texture, nullptr, nullptr); 
+                this->mergedBars.push_back(merged);
+            }
+
+            drawn = &this->mergedBars;
+            firstDrawn = column;
+        }
+
+        // dirty bars only ever widen the range when they come from a BarBuilder, anything else starts from scratch
+        auto low = (firstDrawn > 0) ? this->candleLow : (*drawn)[0].low;
+        auto high = (firstDrawn > 0) ? this->candleHigh : (*drawn)[0].high;
+
+        for (auto i = firstDrawn; i < drawn->size(); i++) {
+            low = std::min(low, (*drawn)[i].low);
+            high = std::max(high, (*drawn)[i].high);
+        }
+
+        if (low != this->candleLow || high != this->candleHigh) {
+            firstDrawn = 0;
+        }
+
+        this->candleLow = low;
+        this->candleHigh = high;
+        this->candleBarCount = bars.size();
+        this->candleArea = area;
+
+        auto scale = (high != low) ? (double) (plotAreaHeight - 1) / ((double) high - low) : 0.0;
+        auto yFlipTransform = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin - 1;
+        auto toScreen = [scale, low, yFlipTransform] (int32_t y) { return (unsigned int) (yFlipTransform - (int) (scale * ((double) y - low))); };
+
+        // each bar gets a slot, the body takes most of it and leaves a gap to the next
+        auto slot = (double) plotAreaWidth / drawn->size();
+        auto bodyWidth = std::max(1u, (unsigned int) (slot * 0.7));
+
+        this->candles.resize(std::min(firstDrawn, this->candles.size()));
+
+        for (auto i = this->candles.size(); i < drawn->size(); i++) {
+
+            auto& bar = (*drawn)[i];
+
+            DrawCandleInfo candle;
+            candle.color = (bar.close >= bar.open) ? 1 : 0;
+            candle.x = this->plotConfiguration.leftMargin + (unsigned int) (i * slot + (slot - bodyWidth) / 2);
+            candle.y = toScreen(bar.high);
+            candle.candleTop = toScreen(std::max(bar.open, bar.close));
+            candle.candleBottom = toScreen(std::min(bar.open, bar.close));
+            candle.width = bodyWidth;
+            candle.topWickHeight = candle.candleTop - candle.y;
+            candle.bottomWickHeight = toScreen(bar.low) - candle.candleBottom;
+
+            this->candles.push_back(candle);
+        }
     }
 
     //-------------------------------------------------------------------------------------------------------------------
-    // Name: Plot
-    // Desc:
+    // Name: DrawCandles
+    // Desc: candles[].color is just up (1) or down (0) until here, one pass per color
     //-------------------------------------------------------------------------------------------------------------------
-    void Plot(const std::vector<double>& yData, SDL_Color color) {
-        auto min = std::min_element(yData.begin(), yData.end());
-        auto max = std::max_element(yData.begin(), yData.end());
-        
-        auto diff = *max - *min; 
-        
-        auto plotAreaHeight = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin - this->plotConfiguration.topMargin; 
-        auto plotAreaWidth = this->plotConfiguration.plotWidth - this->plotConfiguration.leftMargin - this->plotConfiguration.rightMargin; 
+    void DrawCandles(SDL_Color upColor, SDL_Color downColor) {
+
+        for (uint32_t up = 0; up < 2; up++) {
+
+            this->batch.SetColor(up ? upColor : downColor);
+
+            for (auto& candle : this->candles) {
+                if (candle.color == up) {
+                    DrawCandle(this->batch, candle);
+                }
+            }
+
+            this->batch.FlushRects();
+        }
+    }
 
-        auto yDataScaled = yData; 
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: AddValueLabels
+    // Desc: Labels the y ticks with values from yMin to yMax, the caller flushes them
+    //-------------------------------------------------------------------------------------------------------------------
+    void AddValueLabels(double yMin, double yMax) {
 
-        std::transform(yDataScaled.begin(), yDataScaled.end(), yDataScaled.begin(), 
-            [plotAreaHeight, min, max] 
-            (float y) 
-            { 
-                return (double) plotAreaHeight * ((y - *min) / (*max - *min) ); 
-            } 
-        ); 
+        auto& config = this->plotConfiguration; 
+        char text[32]; 
 
-        // so far assuming that there are more pixels than data points; 
-        // how to handle opposite case? it actually seems to work okay when you scale it really small so idk
-        auto xSpace = plotAreaWidth / yDataScaled.size(); 
+        auto yCount = this->gridInfo.yCount + 1; 
 
-        SDL_SetRenderDrawColor(this->renderer, color.r, color.g, color.b, color.a); 
+        // y ticks run top to bottom so the first one is yMax
+        auto fy = [this, &config, &text, yCount, yMin, yMax] (const DrawIntervalInfo& info) 
+        {
+            auto value = yMax - (yMax - yMin) * info.index / (yCount - 1); 
+            snprintf(text, sizeof(text), "%.4g", value); 
 
-        auto yFlipTransform = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin;
+            auto x = config.leftMargin - this->MeasureLabel(text) - 4; 
+            auto y = info.y - this->LabelHeight() / 2; 
 
-        for (auto i = 1; i < yDataScaled.size(); i++) {
+            this->AddLabel(x, y, text); 
+        };
 
-            auto x1 = (i-1) * xSpace; 
-            auto y1 = yFlipTransform - (int) yDataScaled[i - 1];
+        DrawOnRepeatingInterval(this->renderer, 
+            config.leftMargin, config.topMargin, 
+            config.leftMargin, config.plotHeight - config.bottomMargin,
+            yCount, 0.0, false, true, fy); 
+    }
 
-            auto x2 = i * xSpace; 
-            auto y2 = yFlipTransform - (int) yDataScaled[i];
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: AddLabel
+    // Desc: Tick label text through the atlas or, on a canvas, the glyph masks
+    //-------------------------------------------------------------------------------------------------------------------
+    void AddLabel(int x, int y, const char* text) {
 
-            SDL_RenderDrawLine(this->renderer, x1 + this->plotConfiguration.leftMargin, y1, x2 + this->plotConfiguration.leftMargin, y2); 
+        if (this->canvas != nullptr) {
+            this->labelMasks->AddText(*this->canvas, x, y, text, 0xafafafff); 
+        } else {
+            SDL_Color color = {0xaf, 0xaf, 0xaf, 0xff}; 
+            this->labelAtlas->AddText(x, y, text, color); 
         }
     }
 
-private:
+    int MeasureLabel(const char* text) const {
+        return (this->canvas != nullptr) ? this->labelMasks->MeasureText(text) : this->labelAtlas->MeasureText(text); 
+    }
+
+    int LabelHeight() const {
+        return (this->canvas != nullptr) ? this->labelMasks->LineHeight() : this->labelAtlas->LineHeight(); 
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Name: FlushSeries
+    // Desc:
+    //-------------------------------------------------------------------------------------------------------------------
+    void FlushSeries(const std::vector<SDL_Point>& points, SDL_Color color, float lineWidth, bool antiAliased) {
+
+        this->batch.SetColor(color);
+        this->batch.AddPoints(points.data(), points.size());
+
+        if (lineWidth > 1.0f || antiAliased) {
+            this->batch.FlushPolylineAsStrokes(lineWidth, color, antiAliased);
+        } else {
+            this->batch.FlushPolyline();
+        }
+    }
 
     //------------------------------------------------------------------------------------------------------------------
     // Name: DrawTitles
@@ -212,6 +1636,12 @@ private:
     //------------------------------------------------------------------------------------------------------------------
     bool DrawTitles() {
 
+        PROFILE_SCOPE("DrawTitles");
+
+        if (this->canvas != nullptr) {
+            return this->DrawTitlesOnCanvas(); 
+        }
+
         // TODO: factor out some functions here
 
         int tw, th; 
@@ -260,34 +1690,75 @@ private:
         textRect.w = textWidth; 
         textRect.h = textHeight; 
 
-        SDL_Point center = {this->plotConfiguration.leftMargin / 2, this->plotConfiguration.plotHeight / 2}; 
+        SDL_Point center = {static_cast<int>(this->plotConfiguration.leftMargin / 2), this->plotConfiguration.plotHeight / 2}; 
 
         // draw titles 
         SDL_RenderCopyEx(this->renderer, this->leftYAxisTextTexture.get(), nullptr, &textRect, -90.0f, nullptr, SDL_FLIP_NONE); 
+
+        PROFILE_COUNT(ProfileCounter::DrawCalls, 3);
+        PROFILE_COUNT(ProfileCounter::Vertices, 12);
+
+        return true; 
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: DrawTitlesOnCanvas
+    // Desc: Same places as DrawTitles but at the font's own size, masks don't get scaled
+    //------------------------------------------------------------------------------------------------------------------
+    bool DrawTitlesOnCanvas() {
+
+        auto& config = this->plotConfiguration; 
+        auto& target = this->chromeCanvas; 
+
+        if (this->titleMasks != nullptr) {
+            const char* title = "Plot Title"; 
+            auto x = (config.plotWidth - this->titleMasks->MeasureText(title)) / 2; 
+            auto y = (config.topMargin - this->titleMasks->LineHeight()) / 2; 
+
+            this->titleMasks->AddText(target, x, y, title, 0xffffffff); 
+        }
+
+        if (this->axisTitleMasks != nullptr) {
+            const char* xTitle = "X Axis"; 
+            auto x = (config.plotWidth - this->axisTitleMasks->MeasureText(xTitle)) / 2; 
+            auto y = config.plotHeight - config.bottomMargin + (config.bottomMargin - this->axisTitleMasks->LineHeight()) / 2; 
+
+            this->axisTitleMasks->AddText(target, x, y, xTitle, 0xffffffff); 
+
+            const char* yTitle = "Left Y Axis"; 
+            x = (config.leftMargin - this->axisTitleMasks->LineHeight()) / 2; 
+            y = (config.plotHeight - this->axisTitleMasks->MeasureText(yTitle)) / 2; 
+
+            this->axisTitleMasks->AddText(target, x, y, yTitle, 0xffffffff, true); 
+        }
+
+        return true; 
     }
 
     //------------------------------------------------------------------------------------------------------------------
     // Name: DrawAxisIncrements
-    // Desc:
+    // Desc: Adds the ticks to the batch, the caller flushes them
     //------------------------------------------------------------------------------------------------------------------
     void DrawAxisIncrements(const DrawGridInfo& drawGridInfo) {
         
-        SDL_SetRenderDrawColor(this->renderer, 0xFF, 0xFF, 0xFF, 0xFF);         
+        PROFILE_SCOPE("DrawAxisIncrements");
+
+        auto& batch = this->batch; 
         
-        auto fy = [] (const DrawIntervalInfo& info) 
+        auto fy = [&batch] (const DrawIntervalInfo& info) 
         {
             auto x1 = info.x;
             auto y1 = info.y; 
 
-            SDL_RenderDrawLine(info.renderer, x1, y1, x1 + 5, y1);
+            batch.AddHorizontalLine(x1, x1 + 5, y1);
         };
 
-        auto fx = [] (const DrawIntervalInfo& info) 
+        auto fx = [&batch] (const DrawIntervalInfo& info) 
         {
             auto x1 = info.x;
             auto y1 = info.y; 
 
-            SDL_RenderDrawLine(info.renderer, x1, y1, x1, y1 - 5);
+            batch.AddVerticalLine(x1, y1, y1 - 5);
         };
 
         DrawOnRepeatingInterval(this->renderer, 
@@ -304,6 +1775,151 @@ private:
             drawGridInfo.xCount + 1, 0.0, false, true, fx); 
     }
 
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: DrawChrome
+    // Desc: Grid, axes, ticks and titles into the chrome texture
+    //------------------------------------------------------------------------------------------------------------------
+    bool DrawChrome() {
+
+        PROFILE_SCOPE("DrawChrome");
+
+        if (!this->ValidateConfig()) {
+            return false;
+        }
+
+        if (this->canvas != nullptr) {
+            return this->DrawChromeOnCanvas(); 
+        }
+
+        if (!this->ReserveTexture(this->plotConfiguration.plotWidth, this->plotConfiguration.plotHeight)) {
+            return false; 
+        }
+
+        auto target = SDL_GetRenderTarget(this->renderer); 
+
+        SDL_SetRenderTarget(this->renderer, this->texture); 
+
+        // whole texture, the part outside the plot included, so a shrink doesn't leave old chrome behind
+        this->batch.SetColor(backgroundColor); 
+        SDL_RenderClear(this->renderer); 
+
+        DrawGrid(this->batch, this->gridInfo); 
+
+        this->batch.SetColor(0xFFFFFFFF); 
+
+        // draw y axis
+        auto y2 = this->plotConfiguration.plotHeight - this->plotConfiguration.topMargin; 
+        this->batch.AddVerticalLine(this->plotConfiguration.leftMargin, this->plotConfiguration.topMargin, y2); 
+
+        // draw x axis 
+        auto x2 = this->plotConfiguration.plotWidth - this->plotConfiguration.rightMargin; 
+        auto y = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin; 
+        this->batch.AddHorizontalLine(this->plotConfiguration.leftMargin, x2, y); 
+
+        // draw spikes on axis, they go out in the same batch as the axes
+        this->DrawAxisIncrements(this->gridInfo);
+        this->batch.FlushRects(); 
+
+        // draw titles
+        this->DrawTitles();
+        
+        // TODO: draw annotation/captions etc
+
+        SDL_SetRenderTarget(this->renderer, target); 
+
+        this->chromeDirty = false; 
+        return true; 
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: DrawChromeOnCanvas
+    // Desc: DrawChrome into chromeCanvas, rendered straight away so Draw only has to copy it
+    //------------------------------------------------------------------------------------------------------------------
+    bool DrawChromeOnCanvas() {
+
+        auto& config = this->plotConfiguration; 
+
+        if (this->chromeCanvas.Width() != config.plotWidth || this->chromeCanvas.Height() != config.plotHeight) {
+            this->chromeCanvas.Resize(config.plotWidth, config.plotHeight); 
+        }
+
+        this->chromeCanvas.SetThreadPool(this->canvas->GetThreadPool()); 
+        this->batch.SetCanvas(&this->chromeCanvas); 
+
+        this->chromeCanvas.Clear(PackCanvasColor(backgroundColor >> 24, (backgroundColor >> 16) & 0xff, (backgroundColor >> 8) & 0xff, backgroundColor & 0xff)); 
+
+        DrawGrid(this->batch, this->gridInfo); 
+
+        this->batch.SetColor(0xFFFFFFFF); 
+        this->batch.AddVerticalLine(config.leftMargin, config.topMargin, config.plotHeight - config.topMargin); 
+        this->batch.AddHorizontalLine(config.leftMargin, config.plotWidth - config.rightMargin, config.plotHeight - config.bottomMargin); 
+
+        this->DrawAxisIncrements(this->gridInfo);
+        this->batch.FlushRects(); 
+
+        this->DrawTitles(); 
+
+        this->chromeCanvas.Render(); 
+        this->batch.SetCanvas(this->canvas); 
+
+        this->chromeDirty = false; 
+        return true; 
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: ReserveTexture
+    // Desc: Makes sure the chrome texture is at least width x height
+    //------------------------------------------------------------------------------------------------------------------
+    bool ReserveTexture(int width, int height) {
+
+        if (this->texture != nullptr && width <= this->textureWidth && height <= this->textureHeight) {
+            return true; 
+        }
+
+        // round up so small resizes fit in what's already there
+        auto newWidth = std::max(this->textureWidth, (width + 255) & ~255); 
+        auto newHeight = std::max(this->textureHeight, (height + 255) & ~255); 
+
+        auto texture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, newWidth, newHeight); 
+
+        if (texture == nullptr) {
+            std::cout << "SDL_CreateTexture failed: " << SDL_GetError() << "\n"; 
+            return false; 
+        }
+
+        SDL_DestroyTexture(this->texture); 
+
+        this->texture = texture; 
+        this->textureWidth = newWidth; 
+        this->textureHeight = newHeight; 
+
+        return true; 
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: InitGridInfo
+    // Desc:
+    //------------------------------------------------------------------------------------------------------------------
+    void InitGridInfo() {
+        this->gridInfo.color = 0x4f4f4fff;  
+        this->gridInfo.xCount = 12; 
+        this->gridInfo.yCount = 12;
+        this->gridInfo.dotted = false; 
+
+        this->UpdateGridInfo(); 
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+    // Name: UpdateGridInfo
+    // Desc: Grid bounds follow the configuration
+    //------------------------------------------------------------------------------------------------------------------
+    void UpdateGridInfo() {
+        this->gridInfo.x = this->plotConfiguration.leftMargin;
+        this->gridInfo.y = this->plotConfiguration.topMargin; 
+        this->gridInfo.width = this->plotConfiguration.plotWidth - this->plotConfiguration.rightMargin; 
+        this->gridInfo.height = this->plotConfiguration.plotHeight - this->plotConfiguration.bottomMargin;
+    }
+
     //------------------------------------------------------------------------------------------------------------------
     // Name: ValidateConfig
     // Desc:
@@ -311,13 +1927,13 @@ private:
     bool ValidateConfig() {
         
         // TODO: validate config info
-        if (this->texture == nullptr) {
+        if (this->renderer == nullptr && this->canvas == nullptr) {
             return false; 
-        }
+        } 
 
-        if (this->renderer == nullptr) {
+        if (this->plotConfiguration.plotWidth < 1 || this->plotConfiguration.plotHeight < 1) {
             return false; 
-        } 
+        }
 
         return true; 
     }
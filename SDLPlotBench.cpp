@@ -0,0 +1,3743 @@
+// SDLPlotBench.cpp
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <random>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+#include <iterator>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "CsvImport.h"
+#include "TickColumns.h"
+#include "SDLPlot.h"
+#include "HeadlessRender.h"
+#include "PlotViewer.h"
+#include "PlotPipeline.h"
+#include "Generators.h"
+#include "Profiler.h"
+#include "SDL.h"
+#include "SDL_ttf.h"
+
+#undef main
+
+// heap allocations through operator new since the bench started, so CheckAllocations can tell whether a frame allocates. SDL's own
+// mallocs don't go through here, only ours and the standard library's.
+std::atomic<size_t> heapAllocations(0);
+
+// gcc takes the free in the replaced operator delete for a mismatch with the operator new it can't see is replaced too
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    auto p = malloc(size != 0 ? size : 1);
+
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+// BenchRenderer
+// Software renderer drawing into a plain surface, no window or video driver needed
+struct BenchRenderer {
+    SDL_Surface* surface;
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+
+    BenchRenderer(int width, int height) {
+        this->surface = SDL_CreateRGBSurface(0, width, height, 32, rmask, gmask, bmask, amask);
+        this->renderer = (this->surface != nullptr) ? SDL_CreateSoftwareRenderer(this->surface) : nullptr;
+        this->texture = (this->renderer != nullptr) ? SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height) : nullptr;
+    }
+
+    ~BenchRenderer() {
+        SDL_DestroyRenderer(this->renderer);
+        SDL_FreeSurface(this->surface);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------
+    // Name: Configuration
+    // Desc: Same layout SDLPlotMain uses
+    //-----------------------------------------------------------------------------------------------------------------------------------------------
+    SDLPlotConfiguration Configuration() const {
+        SDLPlotConfiguration config;
+        config.grid = false;
+        config.leftMargin = 50;
+        config.rightMargin = 50;
+        config.topMargin = 50;
+        config.bottomMargin = 50;
+        config.plotWidth = this->surface->w;
+        config.plotHeight = this->surface->h;
+
+        return config;
+    }
+};
+
+// only benchmarks whose name contains this run, empty runs everything
+std::string benchFilter;
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: ShouldRun
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+bool ShouldRun(const std::string& name) {
+    return benchFilter.empty() || name.find(benchFilter) != std::string::npos;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: TimeSeconds
+// Desc: Runs func once and returns how long it took in seconds
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+double TimeSeconds(const std::function<void()>& func) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// BenchResult
+// One measurement, as it goes into the json
+struct BenchResult {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+// everything Report printed, in order
+std::vector<BenchResult> benchResults;
+
+// what SDL_Init picked, for the json
+std::string benchVideoDriver = "none";
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: Report
+// Desc: Prints name: value unit and keeps it for WriteBenchJson. Units ending in /s are rates, anything else is a time or a size.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void Report(const std::string& name, double value, const std::string& unit, const std::string& note = "") {
+
+    std::cout << name << ": " << value << " " << unit << note << "\n";
+
+    BenchResult result = {name, value, unit};
+    benchResults.push_back(result);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: Expect
+// Desc: For the Check functions: when ok is false, prints check: what and counts it in failures
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void Expect(int& failures, const char* check, bool ok, const std::string& what) {
+
+    if (!ok) {
+        std::cout << check << ": " << what << "\n";
+        failures++;
+    }
+}
+
+// JsonString
+// name quoted and escaped for json
+std::string JsonString(const std::string& text) {
+
+    std::string quoted = "\"";
+
+    for (auto c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+
+    return quoted + "\"";
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: WriteBenchJson
+// Desc: The results as {"version": ..., "config": ..., "results": [{"name", "value", "unit", "higherIsBetter"}, ...]}, one result per line so
+//       two runs diff cleanly and ReadBenchJson doesn't need a real json parser
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+bool WriteBenchJson(const std::string& filepath) {
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+#ifndef BENCH_CONFIG
+#define BENCH_CONFIG "unknown"
+#endif
+
+    auto file = fopen(filepath.c_str(), "wb");
+
+    if (file == nullptr) {
+        std::cout << "Error opening file.";
+        return false;
+    }
+
+    fprintf(file, "{\n\"version\": %s,\n\"config\": %s,\n\"compiler\": %s,\n\"videoDriver\": %s,\n\"hardwareThreads\": %u,\n\"results\": [\n",
+        JsonString(BENCH_VERSION).c_str(), JsonString(BENCH_CONFIG).c_str(), JsonString(__VERSION__).c_str(),
+        JsonString(benchVideoDriver).c_str(), std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < benchResults.size(); i++) {
+
+        auto& result = benchResults[i];
+        auto rate = result.unit.size() > 2 && result.unit.compare(result.unit.size() - 2, 2, "/s") == 0;
+
+        fprintf(file, "{\"name\": %s, \"value\": %.6g, \"unit\": %s, \"higherIsBetter\": %s}%s\n",
+            JsonString(result.name).c_str(), result.value, JsonString(result.unit).c_str(), rate ? "true" : "false", (i + 1 < benchResults.size()) ? "," : "");
+    }
+
+    fputs("]\n}\n", file);
+
+    if (fclose(file) != 0) {
+        std::cout << "Error writing " << filepath << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: ReadBenchJson
+// Desc: Results out of a file WriteBenchJson wrote
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+std::vector<BenchResult> ReadBenchJson(const std::string& filepath) {
+
+    std::vector<BenchResult> results;
+    std::ifstream file(filepath);
+
+    if (!file) {
+        std::cout << "Error opening " << filepath << "\n";
+        return results;
+    }
+
+    // {"name": "...", "value": ..., "unit": "...", ...}
+    auto field = [] (const std::string& line, const std::string& key, size_t& at) {
+        at = line.find("\"" + key + "\": ", at);
+        return (at == std::string::npos) ? at : (at += key.size() + 4);
+    };
+
+    auto unquote = [] (const std::string& line, size_t& at) {
+        std::string text;
+        for (at++; at < line.size() && line[at] != '"'; at++) {
+            at += (line[at] == '\\') ? 1 : 0;
+            text += line[at];
+        }
+        return text;
+    };
+
+    std::string line;
+
+    while (std::getline(file, line)) {
+
+        BenchResult result;
+        size_t at = 0;
+
+        if (line.compare(0, 9, "{\"name\": ") != 0 || field(line, "name", at) == std::string::npos) {
+            continue;
+        }
+
+        result.name = unquote(line, at);
+
+        if (field(line, "value", at) == std::string::npos) {
+            continue;
+        }
+
+        result.value = strtod(line.c_str() + at, nullptr);
+
+        if (field(line, "unit", at) == std::string::npos) {
+            continue;
+        }
+
+        result.unit = unquote(line, at);
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: KeepBestResults
+// Desc: Folds repeated runs into one result per name and unit, the fastest, since noise only ever makes a run slower
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void KeepBestResults() {
+
+    std::vector<BenchResult> best;
+
+    for (auto& result : benchResults) {
+
+        auto rate = result.unit.size() > 2 && result.unit.compare(result.unit.size() - 2, 2, "/s") == 0;
+        auto kept = std::find_if(best.begin(), best.end(), [&result] (const BenchResult& b) { return b.name == result.name && b.unit == result.unit; });
+
+        if (kept == best.end()) {
+            best.push_back(result);
+        } else if (rate ? result.value > kept->value : result.value < kept->value) {
+            kept->value = result.value;
+        }
+    }
+
+    benchResults.swap(best);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CompareBenchResults
+// Desc: This run against baseline, result by result. Returns how many got worse by more than tolerance, e.g. 0.1 for 10%.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CompareBenchResults(const std::vector<BenchResult>& baseline, double tolerance) {
+
+    int regressions = 0;
+
+    for (auto& result : benchResults) {
+
+        auto old = std::find_if(baseline.begin(), baseline.end(), [&result] (const BenchResult& b) { return b.name == result.name && b.unit == result.unit; });
+
+        if (old == baseline.end() || old->value <= 0.0 || result.value <= 0.0) {
+            continue;
+        }
+
+        auto rate = result.unit.size() > 2 && result.unit.compare(result.unit.size() - 2, 2, "/s") == 0;
+
+        // how much slower, whichever way the unit goes
+        auto slowdown = rate ? old->value / result.value - 1.0 : result.value / old->value - 1.0;
+        auto regressed = slowdown > tolerance;
+
+        printf("%-60s %12.4g -> %-12.4g %-14s %+6.1f%%%s\n", result.name.c_str(), old->value, result.value, result.unit.c_str(), -100.0 * slowdown, regressed ? "  REGRESSION" : "");
+        regressions += regressed ? 1 : 0;
+    }
+
+    std::cout << "Compared against the baseline: " << regressions << " regressions over " << tolerance * 100.0 << "%\n";
+    return regressions;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: WriteTestTickCsv
+// Desc: Writes rowCount rows of made up ticks in the layout StreamReadBlock expects
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+bool WriteTestTickCsv(const std::string& filepath, unsigned int rowCount) {
+
+    auto file = fopen(filepath.c_str(), "wb");
+
+    if (file == nullptr) {
+        std::cout << "Error opening file.";
+        return false;
+    }
+
+    fputs("Id,Symbol,Exchange,DateTime,Bid\n", file);
+
+    unsigned int quote = 123456;
+
+    for (unsigned int i = 0; i < rowCount; i++) {
+
+        auto millisec = (i * 37) % 86400000;
+        quote += (i % 7) - 3;
+
+        fprintf(file, "%u,EURUSD,FX,2017-01-02 %02u:%02u:%02u.%03u,%u.%05u\n",
+            i, millisec / 3600000, (millisec / 60000) % 60, (millisec / 1000) % 60, millisec % 1000, quote / 100000, quote % 100000);
+    }
+
+    fclose(file);
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckFastParseFixed
+// Desc: Differential check of FastParseFixed against FastParse on random timestamps. Returns the number of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckFastParseFixed(unsigned int count) {
+
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<unsigned int> year(0, 9999), month(1, 12), day(1, 31), hour(0, 23), minute(0, 59), millisec(0, 999);
+
+    int mismatches = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+
+        char str[32];
+        snprintf(str, sizeof(str), "%04u-%02u-%02u %02u:%02u:%02u.%03u", year(gen), month(gen), day(gen), hour(gen), minute(gen), minute(gen), millisec(gen));
+
+        DateTimePricePair expected;
+        DateTimePricePair actual;
+
+        FastParse(str, &expected);
+
+        if (!FastParseFixed(str, str + strlen(str), &actual) ||
+            expected.year != actual.year || expected.month != actual.month || expected.day != actual.day ||
+            expected.hour != actual.hour || expected.minute != actual.minute || expected.second != actual.second ||
+            expected.millisec != actual.millisec) {
+
+            std::cout << "FastParseFixed mismatch on " << str << "\n";
+            mismatches++;
+        }
+    }
+
+    // and the scanners all have to agree with each other
+    std::string line = "0,EURUSD,FX,2017-01-02 09:30:00.123,1.23456\n1,EURUSD,FX,2017-01-02 09:30:00.124,1.23457\n";
+    for (unsigned int i = 0; i < 100; i++) {
+        line += "padding_without_any_delimiters_";
+    }
+    line += ",";
+
+    auto end = line.data() + line.size();
+    for (auto c = line.data(); c < end; c++) {
+        if (FindDelimiter(c, end) != FindDelimiterScalar(c, end)) {
+            std::cout << "FindDelimiter mismatch at " << (c - line.data()) << "\n";
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchFastParse
+// Desc: Timestamps per second through FastParse vs. FastParseFixed, and bytes per second through the delimiter scanners
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchFastParse(unsigned int count) {
+
+    const char str[] = "2017-01-02 09:30:00.123";
+
+    // read through a volatile pointer so the parse can't be hoisted out of the loop
+    const char* volatile input = str;
+
+    DateTimePricePair dateTimePricePair;
+    unsigned int sink = 0;
+
+    auto seconds = TimeSeconds([&] () {
+        for (unsigned int i = 0; i < count; i++) {
+            FastParse(input, &dateTimePricePair);
+            sink += dateTimePricePair.millisec;
+        }
+    });
+
+    Report("FastParse", count / seconds, "timestamps/s");
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int i = 0; i < count; i++) {
+            FastParseFixed(input, input + sizeof(str) - 1, &dateTimePricePair);
+            sink += dateTimePricePair.millisec;
+        }
+    });
+
+    Report("FastParseFixed", count / seconds, "timestamps/s");
+
+    std::string row = "0,EURUSD,FX,2017-01-02 09:30:00.123,1.23456\n";
+    std::string block;
+    while (block.size() < (1 << 20)) {
+        block += row;
+    }
+
+    auto end = block.data() + block.size();
+    const char* names[] = {"FindDelimiterScalar", "FindDelimiter"};
+    FindDelimiterFunc funcs[] = {FindDelimiterScalar, SelectFindDelimiter()};
+
+    for (auto f = 0; f < 2; f++) {
+
+        size_t found = 0;
+
+        seconds = TimeSeconds([&] () {
+            for (auto i = 0; i < 100; i++) {
+                for (auto c = funcs[f](block.data(), end); c < end; c = funcs[f](c + 1, end)) {
+                    found++;
+                }
+            }
+        });
+
+        Report(names[f], (100.0 * block.size() / (1024.0 * 1024.0)) / seconds, "MB/s");
+        sink += found;
+    }
+
+    if (sink == 1) {
+        std::cout << "";
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchImport
+// Desc: Compares StreamReadBlock against the mapped parallel importer in MB/s and rows/s
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchImport(std::string& filepath) {
+
+    std::ifstream sizeStream(filepath, std::ios::binary | std::ios::ate);
+    auto megabytes = sizeStream.tellg() / (1024.0 * 1024.0);
+
+    const char* modeNames[] = {"Stream", "MappedParallel"};
+    const CsvImportMode modes[] = {CsvImportMode::Stream, CsvImportMode::MappedParallel};
+
+    size_t expectedRows = 0;
+
+    for (auto i = 0; i < 2; i++) {
+
+        std::vector<DateTimePricePair> result;
+        auto seconds = TimeSeconds([&] () { result = ImportCsv(filepath, modes[i]); });
+
+        if (i == 0) {
+            expectedRows = result.size();
+        } else if (result.size() != expectedRows) {
+            std::cout << "ImportCsv " << modeNames[i] << " row count mismatch: " << result.size() << " vs " << expectedRows << "\n";
+        }
+
+        Report(std::string("ImportCsv ") + modeNames[i], megabytes / seconds, "MB/s");
+        Report(std::string("ImportCsv ") + modeNames[i], result.size() / seconds, "rows/s");
+    }
+
+    // same reader as Stream but only ever holding one batch
+    size_t streamedRows = 0;
+    auto seconds = TimeSeconds([&] () {
+        StreamCsv(filepath, 4096, [&streamedRows] (const std::vector<DateTimePricePair>& batch) {
+            streamedRows += batch.size();
+            return true;
+        });
+    });
+
+    Report("StreamCsv 4096 row batches", megabytes / seconds, "MB/s");
+    Report("StreamCsv 4096 row batches", streamedRows / seconds, "rows/s");
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckTickColumns
+// Desc: ImportTickColumns maps the sidecar back in next time, and parses the csv again once it's been edited, even when the edit keeps its size.
+//       Load turns down sidecars whose count or offsets would only fit by wrapping around.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckTickColumns() {
+
+    int failures = 0;
+
+    std::string filepath = "check_tick_columns.csv";
+    auto sidecarPath = filepath + ".ticks";
+
+    Expect(failures, "TickColumns", WriteTestTickCsv(filepath, 1000), "couldn't write the test csv");
+
+    auto parsed = ImportTickColumns(filepath);
+    auto mapped = ImportTickColumns(filepath);
+
+    Expect(failures, "TickColumns", !parsed.IsMapped() && parsed.size() == 1000, "the first import didn't parse the csv");
+    Expect(failures, "TickColumns", mapped.IsMapped() && mapped.size() == 1000, "the second import didn't map the sidecar");
+
+    // the last digit of the last quote, so the csv stays the same size
+    auto file = fopen(filepath.c_str(), "r+b");
+
+    if (file != nullptr) {
+        fseek(file, -2, SEEK_END);
+        auto digit = fgetc(file);
+
+        fseek(file, -2, SEEK_END);
+        fputc((digit == '9') ? '0' : digit + 1, file);
+        fclose(file);
+    }
+
+    auto edited = ImportTickColumns(filepath);
+
+    Expect(failures, "TickColumns", !edited.IsMapped(), "a stale sidecar was mapped in after the csv was edited");
+    Expect(failures, "TickColumns", edited.size() == 1000 && edited.Quote()[999] != parsed.Quote()[999], "the edited csv's last quote didn't come through");
+
+    // counts and offsets that land back inside the file once multiplied or added in 64 bits
+    std::string corruptPath = "check_tick_columns_corrupt.ticks";
+
+    const uint64_t wrapped[] = {(1ull << 61) + 10, (1ull << 62) + 10};
+    const size_t fields[] = {offsetof(TickFileHeader, count), offsetof(TickFileHeader, count), offsetof(TickFileHeader, timeOffset), offsetof(TickFileHeader, quoteOffset)};
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+
+        auto value = (i < 2) ? wrapped[i] : ~0ull - 7;
+
+        Expect(failures, "TickColumns", parsed.Save(corruptPath), "couldn't write the sidecar to corrupt");
+        file = fopen(corruptPath.c_str(), "r+b");
+
+        if (file != nullptr) {
+            fseek(file, static_cast<long>(fields[i]), SEEK_SET);
+            fwrite(&value, sizeof(value), 1, file);
+            fclose(file);
+        }
+
+        TickColumns corrupt;
+        Expect(failures, "TickColumns", !corrupt.Load(corruptPath, false), "a sidecar with an out of range count or offset loaded");
+    }
+
+    remove(corruptPath.c_str());
+    remove(filepath.c_str());
+    remove(sidecarPath.c_str());
+
+    std::cout << "CheckTickColumns: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchTickColumns
+// Desc: Load time for a day of ticks as columns, parsed from csv vs. mapped from the sidecar
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchTickColumns(std::string& filepath) {
+
+    auto sidecarPath = filepath + ".ticks";
+
+    TickColumns parsed;
+    auto seconds = TimeSeconds([&] () { parsed = MappedReadParallel<TickColumns>(filepath); });
+
+    Report("TickColumns csv parse", seconds * 1000.0, "ms", ", " + std::to_string(parsed.size()) + " rows");
+
+    seconds = TimeSeconds([&] () { parsed.Save(sidecarPath); });
+    Report("TickColumns sidecar save", seconds * 1000.0, "ms");
+
+    const char* names[] = {"TickColumns sidecar mmap", "TickColumns sidecar mmap + checksum"};
+
+    for (auto verify = 0; verify < 2; verify++) {
+
+        TickColumns loaded;
+        seconds = TimeSeconds([&] () { loaded.Load(sidecarPath, verify != 0); });
+
+        if (loaded.size() != parsed.size() || memcmp(loaded.Time(), parsed.Time(), parsed.size() * sizeof(int64_t)) != 0) {
+            std::cout << "TickColumns sidecar doesn't match the csv\n";
+        }
+
+        Report(names[verify], seconds * 1000.0, "ms");
+    }
+
+    remove(sidecarPath.c_str());
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchPlot
+// Desc: SDLPlot::Plot draw time against series length
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchPlot(size_t maxPoints) {
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        std::cout << "BenchPlot: couldn't create a software renderer\n";
+        return;
+    }
+
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    // SDLPlot owns the texture it's given
+    SDLPlot plot(bench.renderer, bench.texture, bench.Configuration());
+    bench.texture = nullptr;
+
+    for (size_t count = 1000; count <= maxPoints; count *= 10) {
+
+        std::vector<double> yData(count);
+        for (size_t i = 0; i < count; i++) {
+            yData[i] = sin(i * 0.0001) + 0.1 * sin(i * 0.37);
+        }
+
+        auto repeats = std::max<size_t>(1, 10000000 / count);
+
+        auto seconds = TimeSeconds([&] () {
+            for (size_t r = 0; r < repeats; r++) {
+                plot.Plot(yData, color);
+            }
+        });
+
+        Report("SDLPlot::Plot " + std::to_string(count) + " points", (seconds * 1000.0) / repeats, "ms");
+    }
+}
+
+// ScalarSamples
+// Hides a double* from the SSE2 overloads so the bench can time the plain loop
+struct ScalarSamples {
+    const double* data;
+
+    double operator[](size_t i) const { return this->data[i]; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchPlotKernel
+// Desc: The per-sample part of Plot from 1e6 to maxPoints: the original min_element + max_element + scaled copy, the scalar DecimateM4 loop, and
+//       the SSE2 kernel on one thread and on every core. Each has to come out with the same columns.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchPlotKernel(size_t maxPoints) {
+
+    const size_t width = 1180;
+    auto threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<double> scaled;
+    std::vector<M4Column> reference;
+    std::vector<M4Column> columns;
+
+    for (size_t count = 1000000; count <= maxPoints; count *= 10) {
+
+        std::vector<double> yData(count);
+        for (size_t i = 0; i < count; i++) {
+            yData[i] = sin(i * 0.0001) + 0.1 * sin(i * 0.37);
+        }
+
+        auto repeats = std::max<size_t>(1, 100000000 / count);
+        auto report = [count, repeats] (const char* name, double seconds) {
+            Report("PlotKernel " + std::string(name) + " " + std::to_string(count) + " points", (seconds * 1000.0) / repeats, "ms");
+        };
+
+        report("three pass", TimeSeconds([&] () {
+            for (size_t r = 0; r < repeats; r++) {
+                auto min = *std::min_element(yData.begin(), yData.end());
+                auto max = *std::max_element(yData.begin(), yData.end());
+
+                scaled.resize(count);
+                std::transform(yData.begin(), yData.end(), scaled.begin(), [min, max] (float y) { return 600.0 * ((y - min) / (max - min)); });
+            }
+        }));
+
+        ScalarSamples scalar = {yData.data()};
+
+        report("scalar DecimateM4", TimeSeconds([&] () {
+            for (size_t r = 0; r < repeats; r++) {
+                DecimateM4(scalar, count, width, reference, 1);
+            }
+        }));
+
+        report("SSE2 DecimateM4 1 thread", TimeSeconds([&] () {
+            for (size_t r = 0; r < repeats; r++) {
+                DecimateM4(yData.data(), count, width, columns, 1);
+            }
+        }));
+
+        if (memcmp(reference.data(), columns.data(), width * sizeof(M4Column)) != 0) {
+            std::cout << "PlotKernel: SSE2 columns don't match the scalar ones\n";
+        }
+
+        if (threadCount > 1) {
+            report("SSE2 DecimateM4 all threads", TimeSeconds([&] () {
+                for (size_t r = 0; r < repeats; r++) {
+                    DecimateM4(yData.data(), count, width, columns, threadCount);
+                }
+            }));
+
+            if (memcmp(reference.data(), columns.data(), width * sizeof(M4Column)) != 0) {
+                std::cout << "PlotKernel: threaded columns don't match the scalar ones\n";
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckPyramid
+// Desc: A saved pyramid loads back with the same levels, and one whose level count doesn't fit its sample count, or that's cut short, doesn't
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckPyramid() {
+
+    int failures = 0;
+
+    const size_t count = 10000;
+    const char* filepath = "check_pyramid.pyr";
+
+    std::vector<double> yData(count);
+    for (size_t i = 0; i < count; i++) {
+        yData[i] = sin(i * 0.01);
+    }
+
+    MinMaxPyramid pyramid;
+    pyramid.Build(yData.data(), count);
+
+    MinMaxPyramid loaded;
+    Expect(failures, "MinMaxPyramid", pyramid.Save(filepath) && loaded.Load(filepath, count) && loaded.LevelCount() == pyramid.LevelCount(), "a saved pyramid didn't load back");
+
+    const uint64_t levelCounts[] = {pyramid.LevelCount() - 1, pyramid.LevelCount() + 1, ~0ull};
+
+    for (auto levelCount : levelCounts) {
+
+        pyramid.Save(filepath);
+        auto file = fopen(filepath, "r+b");
+
+        if (file != nullptr) {
+            fseek(file, static_cast<long>(offsetof(MinMaxPyramidHeader, levelCount)), SEEK_SET);
+            fwrite(&levelCount, sizeof(levelCount), 1, file);
+            fclose(file);
+        }
+
+        MinMaxPyramid corrupt;
+        Expect(failures, "MinMaxPyramid", !corrupt.Load(filepath, count), "a pyramid with the wrong level count loaded");
+    }
+
+    // everything but the last level's single node
+    pyramid.Save(filepath);
+    std::vector<char> bytes;
+
+    {
+        std::ifstream filestream(filepath, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(filestream), std::istreambuf_iterator<char>());
+    }
+
+    {
+        std::ofstream filestream(filepath, std::ios::binary | std::ios::trunc);
+        filestream.write(bytes.data(), bytes.size() - sizeof(MinMax));
+    }
+
+    MinMaxPyramid truncated;
+    Expect(failures, "MinMaxPyramid", !truncated.Load(filepath, count), "a truncated pyramid loaded");
+
+    remove(filepath);
+
+    std::cout << "CheckPyramid: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchPyramid
+// Desc: Build time and zoom/pan queries per second on a MinMaxPyramid over a big series
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchPyramid(size_t count) {
+
+    std::vector<double> yData(count);
+    for (size_t i = 0; i < count; i++) {
+        yData[i] = sin(i * 0.0001) + 0.1 * sin(i * 0.37);
+    }
+
+    MinMaxPyramid pyramid;
+    auto seconds = TimeSeconds([&] () { pyramid.Build(yData.data(), count); });
+
+    std::cout << "MinMaxPyramid build " << count << " points: " << seconds * 1000.0 << " ms\n";
+
+    const size_t width = 1180;
+    const unsigned int queryCount = 1000;
+
+    std::mt19937_64 gen(42);
+    std::vector<M4Column> columns;
+
+    // random window sizes from a screen's worth of samples up to everything, at random offsets
+    seconds = TimeSeconds([&] () {
+        for (unsigned int q = 0; q < queryCount; q++) {
+
+            auto windowSize = std::max<size_t>(width, count >> (gen() % 20));
+            auto begin = gen() % (count - windowSize + 1);
+
+            pyramid.QueryM4(yData.data(), begin, begin + windowSize, width, columns);
+        }
+    });
+
+    std::cout << "MinMaxPyramid zoom/pan " << width << " columns: " << queryCount / seconds << " queries/s\n";
+
+    // compare against decimating the whole visible range every time
+    seconds = TimeSeconds([&] () {
+        for (unsigned int q = 0; q < 10; q++) {
+            DecimateM4(yData.data(), count, width, columns);
+        }
+    });
+
+    std::cout << "DecimateM4 full range " << width << " columns: " << 10 / seconds << " queries/s\n";
+
+    seconds = TimeSeconds([&] () { pyramid.Save("bench_pyramid.pyr"); });
+    std::cout << "MinMaxPyramid save: " << seconds * 1000.0 << " ms\n";
+
+    MinMaxPyramid loaded;
+    seconds = TimeSeconds([&] () { loaded.Load("bench_pyramid.pyr", count); });
+    std::cout << "MinMaxPyramid load: " << seconds * 1000.0 << " ms\n";
+
+    remove("bench_pyramid.pyr");
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: GenerateTickDay
+// Desc: count ticks spread over one day at random gaps, quotes random walking around 1.2 (in 1e-5 units)
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void GenerateTickDay(size_t count, std::vector<int64_t>& time, std::vector<int32_t>& quote) {
+
+    std::mt19937 gen(7);
+    std::exponential_distribution<double> gap((double) count / barDay);
+    std::uniform_int_distribution<int> step(-3, 3);
+
+    time.resize(count);
+    quote.resize(count);
+
+    auto start = DaysFromCivil(2017, 1, 2) * barDay;
+    double offset = 0.0;
+    int32_t price = 120000;
+
+    for (size_t i = 0; i < count; i++) {
+        offset = std::min<double>(offset + gap(gen), barDay - 1);
+        price += step(gen);
+
+        time[i] = start + (int64_t) offset;
+        quote[i] = price;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: SameBars
+// Desc:
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+bool SameBars(const std::vector<OhlcBar>& a, const std::vector<OhlcBar>& b) {
+
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].time != b[i].time || a[i].open != b[i].open || a[i].high != b[i].high || a[i].low != b[i].low ||
+            a[i].close != b[i].close || a[i].tickCount != b[i].tickCount) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckBarBuilder
+// Desc: BarBuilder fed a tick at a time and in random batches against AggregateOhlc, plus its dirty range and late
+//       ticks. Returns the number of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckBarBuilder(const std::vector<int64_t>& time, const std::vector<int32_t>& quote) {
+
+    int mismatches = 0;
+    std::mt19937 gen(11);
+
+    for (auto interval : {barSecond, barMinute}) {
+
+        std::vector<OhlcBar> expected;
+        AggregateOhlc(time.data(), quote.data(), time.size(), interval, expected, 1);
+
+        BarBuilder single(interval);
+        BarBuilder batched(interval);
+
+        for (size_t i = 0; i < time.size(); i++) {
+
+            single.Add(time[i], quote[i]);
+
+            // only the bar the tick landed in is dirty
+            if (single.FirstDirty() != single.Bars().size() - 1) {
+                mismatches++;
+                break;
+            }
+
+            single.ClearDirty();
+        }
+
+        for (size_t i = 0; i < time.size(); ) {
+            auto count = std::min<size_t>(time.size() - i, gen() % 5000);
+            batched.Add(time.data() + i, quote.data() + i, count);
+            i += count;
+        }
+
+        if (!SameBars(single.Bars(), expected) || !SameBars(batched.Bars(), expected)) {
+            std::cout << "BarBuilder mismatch, interval " << interval << " ms\n";
+            mismatches++;
+        }
+    }
+
+    // a late tick raises an old bar's high without moving its close, and that bar becomes the first dirty one
+    BarBuilder late(barSecond);
+    late.Add(1000, 10);
+    late.Add(1500, 12);
+    late.Add(2000, 11);
+    late.Add(5000, 11);
+    late.ClearDirty();
+    late.Add(1200, 20);
+
+    if (late.FirstDirty() != 0 || late.Bars()[0].high != 20 || late.Bars()[0].close != 12 || late.Bars()[0].tickCount != 3) {
+        std::cout << "BarBuilder late tick mismatch\n";
+        mismatches++;
+    }
+
+    // and one in a gap gets a bar of its own
+    late.ClearDirty();
+    late.Add(3100, 9);
+
+    if (late.Bars().size() != 4 || late.Bars()[2].time != 3000 || late.FirstDirty() != 2) {
+        std::cout << "BarBuilder late tick in a gap mismatch\n";
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckBars
+// Desc: AggregateOhlc on one and on several threads against the obvious per tick loop. Returns the number of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckBars(const std::vector<int64_t>& time, const std::vector<int32_t>& quote) {
+
+    const int64_t intervals[] = {1, 250, barSecond, barMinute, 5 * barMinute, barHour, barDay};
+    int mismatches = 0;
+
+    for (auto interval : intervals) {
+
+        std::vector<OhlcBar> expected;
+
+        for (size_t i = 0; i < time.size(); i++) {
+
+            auto start = BarStart(time[i], interval);
+
+            if (expected.empty() || expected.back().time != start) {
+                OhlcBar bar = {start, quote[i], quote[i], quote[i], quote[i], 0};
+                expected.push_back(bar);
+            }
+
+            auto& bar = expected.back();
+            bar.high = std::max(bar.high, quote[i]);
+            bar.low = std::min(bar.low, quote[i]);
+            bar.close = quote[i];
+            bar.tickCount++;
+        }
+
+        for (unsigned int threadCount : {1u, 3u, 8u}) {
+
+            std::vector<OhlcBar> actual;
+            AggregateOhlc(time.data(), quote.data(), time.size(), interval, actual, threadCount);
+
+            auto same = (actual.size() == expected.size());
+
+            for (size_t i = 0; same && i < actual.size(); i++) {
+                same = actual[i].time == expected[i].time && actual[i].open == expected[i].open && actual[i].high == expected[i].high &&
+                    actual[i].low == expected[i].low && actual[i].close == expected[i].close && actual[i].tickCount == expected[i].tickCount;
+            }
+
+            if (!same) {
+                std::cout << "AggregateOhlc mismatch, interval " << interval << " ms on " << threadCount << " threads\n";
+                mismatches++;
+            }
+        }
+    }
+
+    // negative times round down too
+    if (BarStart(-1, barSecond) != -barSecond || BarStart(-barSecond, barSecond) != -barSecond) {
+        std::cout << "BarStart mismatch before the epoch\n";
+        mismatches++;
+    }
+
+    return mismatches + CheckBarBuilder(time, quote);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchBars
+// Desc: Aggregating a day of ticks into bars at the usual intervals, on one thread and on every core
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchBars(size_t tickCount) {
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    GenerateTickDay(tickCount, time, quote);
+
+    const int64_t intervals[] = {barSecond, barMinute, 5 * barMinute, barHour, barDay};
+    const char* names[] = {"1s", "1m", "5m", "1h", "1d"};
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<OhlcBar> bars;
+
+    for (auto i = 0; i < 5; i++) {
+        for (auto threadCount : {1u, cores}) {
+
+            auto seconds = TimeSeconds([&] () { AggregateOhlc(time.data(), quote.data(), tickCount, intervals[i], bars, threadCount); });
+
+            std::cout << "AggregateOhlc " << names[i] << " " << tickCount << " ticks -> " << bars.size() << " bars on " << threadCount << " threads: "
+                << seconds * 1000.0 << " ms (" << tickCount / seconds / 1e6 << " M ticks/s)\n";
+
+            if (cores == 1) {
+                break;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchBarBuilder
+// Desc: ns per tick through BarBuilder::Add, one at a time and in batches, against rerunning AggregateOhlc over the
+//       whole day so far for every tick
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchBarBuilder(size_t tickCount) {
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    GenerateTickDay(tickCount, time, quote);
+
+    for (auto interval : {barSecond, barMinute}) {
+
+        BarBuilder builder(interval);
+
+        auto seconds = TimeSeconds([&] () {
+            for (size_t i = 0; i < tickCount; i++) {
+                builder.Add(time[i], quote[i]);
+            }
+        });
+
+        std::cout << "BarBuilder " << interval / 1000 << "s bars, single ticks: " << seconds * 1e9 / tickCount << " ns/tick\n";
+
+        builder.Reset(interval);
+
+        seconds = TimeSeconds([&] () {
+            for (size_t i = 0; i < tickCount; i += 256) {
+                builder.Add(time.data() + i, quote.data() + i, std::min<size_t>(256, tickCount - i));
+            }
+        });
+
+        std::cout << "BarBuilder " << interval / 1000 << "s bars, batches of 256: " << seconds * 1e9 / tickCount << " ns/tick\n";
+    }
+
+    // the old way: a tick arrives late in the day and everything is aggregated again
+    std::vector<OhlcBar> bars;
+    const unsigned int reruns = 20;
+
+    auto seconds = TimeSeconds([&] () {
+        for (unsigned int i = 0; i < reruns; i++) {
+            AggregateOhlc(time.data(), quote.data(), tickCount, barMinute, bars, 1);
+        }
+    });
+
+    std::cout << "AggregateOhlc rerun per tick, 1m bars: " << seconds * 1e9 / reruns << " ns/tick\n";
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchCandles
+// Desc: PlotCandles time for a day of 1m bars and of 1s bars (more bars than columns, so they're merged per column)
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchCandles(unsigned int frameCount) {
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    GenerateTickDay(2000000, time, quote);
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        return;
+    }
+
+    SDLPlot plot(bench.renderer, bench.Configuration());
+    SDL_Color up = {0x40, 0xc0, 0x40, 0xff};
+    SDL_Color down = {0xe0, 0x40, 0x40, 0xff};
+
+    std::vector<OhlcBar> bars;
+
+    for (auto interval : {barMinute, barSecond}) {
+
+        AggregateOhlc(time.data(), quote.data(), time.size(), interval, bars);
+        plot.Batch().ResetDrawCalls();
+
+        auto seconds = TimeSeconds([&] () {
+            for (unsigned int frame = 0; frame < frameCount; frame++) {
+                plot.PlotCandles(bars, up, down);
+            }
+        });
+
+        std::cout << "PlotCandles " << bars.size() << " bars: " << seconds * 1000.0 / frameCount << " ms, "
+            << plot.Batch().DrawCalls() / frameCount << " draw calls per frame\n";
+    }
+
+    // live: the day's 1m bars are in a builder and a tick lands in the last one before every frame
+    BarBuilder builder(barMinute);
+    builder.Add(time.data(), quote.data(), time.size());
+
+    auto lastTime = time.back();
+    auto lastQuote = quote.back();
+
+    auto seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            builder.Add(lastTime, lastQuote + (int32_t) (frame % 3) - 1);
+            plot.PlotCandles(builder, up, down);
+        }
+    });
+
+    std::cout << "PlotCandles live " << builder.Bars().size() << " bars, a tick per frame: " << seconds * 1000.0 / frameCount << " ms\n";
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchFrame
+// Desc: Frame time and renderer calls per frame for a full Draw plus a few series, batched vs. one call per primitive
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchFrame(unsigned int frameCount) {
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        std::cout << "BenchFrame: couldn't create a software renderer\n";
+        return;
+    }
+
+    SDLPlot plot(bench.renderer, bench.texture, bench.Configuration());
+    bench.texture = nullptr;
+
+    std::vector<std::vector<double>> series;
+    for (auto s = 0; s < 4; s++) {
+        series.emplace_back(s == 0 ? 100000 : 800);
+
+        for (size_t i = 0; i < series.back().size(); i++) {
+            series.back()[i] = sin(i * 0.01 * (s + 1)) + 0.1 * sin(i * 0.37);
+        }
+    }
+
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+    const char* names[] = {"Frame retained chrome", "Frame chrome redrawn, batched", "Frame chrome redrawn, immediate"};
+
+    for (auto mode = 0; mode < 3; mode++) {
+
+        plot.Batch().SetImmediate(mode == 2);
+        plot.Batch().ResetDrawCalls();
+
+        auto seconds = TimeSeconds([&] () {
+            for (unsigned int frame = 0; frame < frameCount; frame++) {
+                if (mode != 0) {
+                    plot.Invalidate();
+                }
+
+                plot.Draw();
+
+                for (size_t s = 0; s < series.size(); s++) {
+                    plot.Plot(series[s], color, (s == 3) ? 2.0f : 1.0f, s == 3);
+                }
+            }
+        });
+
+        Report(names[mode], (seconds * 1000.0) / frameCount, "ms", ", " + std::to_string(plot.Batch().DrawCalls() / frameCount) + " draw calls/frame");
+    }
+
+    plot.Batch().SetImmediate(false);
+
+    // dragging a window edge, one resize per frame
+    auto seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            plot.Resize(1280 - (frame % 64), 720 - (frame % 32));
+            plot.Draw();
+        }
+    });
+
+    Report("Frame resized every frame", (seconds * 1000.0) / frameCount, "ms");
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchGrid
+// Desc: DrawGrid time with dotted vs. solid gridlines, plus one-off diagonal DrawDottedLine calls
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchGrid(unsigned int frameCount) {
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        std::cout << "BenchGrid: couldn't create a software renderer\n";
+        return;
+    }
+
+    DrawGridInfo gridInfo;
+    gridInfo.color = 0x4f4f4fff;
+    gridInfo.x = 50;
+    gridInfo.y = 50;
+    gridInfo.width = 1280 - 50;
+    gridInfo.height = 720 - 50;
+    gridInfo.xCount = 12;
+    gridInfo.yCount = 12;
+
+    RenderBatch batch(bench.renderer);
+    const char* names[] = {"DrawGrid solid", "DrawGrid dotted"};
+
+    for (auto dotted = 0; dotted < 2; dotted++) {
+
+        gridInfo.dotted = (dotted != 0);
+        batch.ResetDrawCalls();
+
+        auto seconds = TimeSeconds([&] () {
+            for (unsigned int frame = 0; frame < frameCount; frame++) {
+                DrawGrid(batch, gridInfo);
+            }
+        });
+
+        Report(names[dotted], (seconds * 1000.0) / frameCount, "ms", ", " + std::to_string(batch.DrawCalls() / frameCount) + " draw calls/frame");
+    }
+
+    auto seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            DrawDottedLine(bench.renderer, 0xffffffff, 0, 0, 1279, 719, 10, 5);
+        }
+    });
+
+    Report("DrawDottedLine diagonal", (seconds * 1000.0) / frameCount, "ms");
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchLabels
+// Desc: Frames with a few hundred short labels: opening the font per label like RenderTextToTexture used to, a texture
+//       per label with the font cached, and quads out of a glyph atlas
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchLabels(unsigned int frameCount, unsigned int labelCount) {
+
+    const std::string fontName = "OxygenMono-Regular.ttf";
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr || GetFont(fontName, 12) == nullptr) {
+        std::cout << "BenchLabels: needs a software renderer and " << fontName << "\n";
+        return;
+    }
+
+    std::vector<std::string> labels;
+    for (unsigned int i = 0; i < labelCount; i++) {
+        labels.push_back(std::to_string(1.2345 + i * 0.0001).substr(0, 6));
+    }
+
+    SDL_Color color = {0xaf, 0xaf, 0xaf, 0xff};
+    SDL_Rect rect = {0, 0, 0, 0};
+
+    auto seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            for (auto& label : labels) {
+                auto font = TTF_OpenFont(fontName.c_str(), 12);
+                auto surface = TTF_RenderText_Solid(font, label.c_str(), color);
+                auto texture = SDL_CreateTextureFromSurface(bench.renderer, surface);
+
+                rect.w = surface->w;
+                rect.h = surface->h;
+                SDL_RenderCopy(bench.renderer, texture, nullptr, &rect);
+
+                SDL_DestroyTexture(texture);
+                SDL_FreeSurface(surface);
+                TTF_CloseFont(font);
+            }
+        }
+    });
+
+    Report("Labels TTF_OpenFont per label", (seconds * 1000.0) / frameCount, "ms/frame");
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            for (auto& label : labels) {
+                auto texture = RenderTextToTexture(bench.renderer, fontName, 12, label, color);
+
+                SDL_QueryTexture(texture.get(), nullptr, nullptr, &rect.w, &rect.h);
+                SDL_RenderCopy(bench.renderer, texture.get(), nullptr, &rect);
+            }
+        }
+    });
+
+    Report("Labels RenderTextToTexture per label", (seconds * 1000.0) / frameCount, "ms/frame");
+
+    auto atlas = GetGlyphAtlas(bench.renderer, fontName, 12);
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            for (size_t i = 0; i < labels.size(); i++) {
+                atlas->AddText((i % 20) * 60.0f, (i / 20) * 14.0f, labels[i].c_str(), color);
+            }
+
+            atlas->Flush();
+        }
+    });
+
+    Report("Labels glyph atlas", (seconds * 1000.0) / frameCount, "ms/frame");
+
+    ClearGlyphAtlases(bench.renderer);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchHeadless
+// Desc: Charts/s for the headless batch mode, one worker against one per core, PPM against PNG
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchHeadless(unsigned int chartCount, unsigned int rowCount) {
+
+    std::vector<std::string> csvFiles;
+
+    for (unsigned int i = 0; i < chartCount; i++) {
+        csvFiles.push_back("bench_headless_" + std::to_string(i) + ".csv");
+
+        if (!WriteTestTickCsv(csvFiles.back(), rowCount)) {
+            return;
+        }
+    }
+
+    HeadlessConfig config;
+    const char* formats[] = {"ppm", "png"};
+
+    for (auto format : formats) {
+        for (unsigned int threads = 1; threads <= std::max(1u, std::thread::hardware_concurrency()); threads *= 2) {
+
+            config.format = format;
+            config.threadCount = threads;
+
+            std::cout << "Headless " << format << ": ";
+            RenderChartsHeadless(csvFiles, config);
+        }
+    }
+
+    for (auto& csvFile : csvFiles) {
+        remove(csvFile.c_str());
+
+        for (auto format : formats) {
+            config.format = format;
+            remove(HeadlessOutputPath(csvFile, config).c_str());
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckHeadless
+// Desc: A csv that can't be opened fails its chart and leaves no image behind, and doesn't stop the rest being written. Loading the same
+//       file twice through kept ChartTicks gives the same rows. Files with the same name in different directories get different images.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckHeadless() {
+
+    int failures = 0;
+
+    auto fileExists = [] (const std::string& filepath) {
+        std::ifstream file(filepath);
+        return file.is_open();
+    };
+
+    HeadlessConfig config;
+    config.width = 320;
+    config.height = 200;
+    config.threadCount = 1;
+    config.format = "ppm";
+
+    std::vector<std::string> sameNames = {"a/EURUSD.csv", "b/EURUSD.csv", "EURUSD_2.csv", "c\\EURUSD.csv", "GBPUSD.csv"};
+    auto outputPaths = HeadlessOutputPaths(sameNames, config);
+
+    Expect(failures, "Headless", outputPaths.size() == sameNames.size() && outputPaths[0] == HeadlessOutputPath(sameNames[0], config), "the first of a name was renamed");
+    Expect(failures, "Headless", outputPaths.size() == sameNames.size() && outputPaths[4] == HeadlessOutputPath(sameNames[4], config), "a unique name was renamed");
+
+    for (size_t i = 0; i < outputPaths.size(); i++) {
+        for (size_t j = i + 1; j < outputPaths.size(); j++) {
+            Expect(failures, "Headless", outputPaths[i] != outputPaths[j], "two csv files got the same image");
+        }
+    }
+
+    const char* backends[] = {"sdl", "canvas"};
+
+    for (auto backend : backends) {
+
+        config.backend = backend;
+
+        std::vector<std::string> csvFiles = {"check_headless_missing.csv", "check_headless.csv"};
+
+        Expect(failures, "Headless", WriteTestTickCsv(csvFiles[1], 1000), "couldn't write the test csv");
+
+        auto rendered = RenderChartsHeadless(csvFiles, config);
+
+        Expect(failures, "Headless", rendered == 1, "a missing csv was counted as rendered");
+        Expect(failures, "Headless", !fileExists(HeadlessOutputPath(csvFiles[0], config)), "a missing csv still wrote an image");
+        Expect(failures, "Headless", fileExists(HeadlessOutputPath(csvFiles[1], config)), "the csv after a missing one wasn't written");
+
+        ChartTicks ticks;
+        Expect(failures, "Headless", LoadTicks(csvFiles[1], ticks) && ticks.quote.size() == 1000 && ticks.time.size() == 1000, "LoadTicks lost rows");
+        Expect(failures, "Headless", LoadTicks(csvFiles[1], ticks) && ticks.quote.size() == 1000, "LoadTicks kept the last file's rows");
+        Expect(failures, "Headless", !LoadTicks(csvFiles[0], ticks) && ticks.quote.empty(), "LoadTicks opened a missing file");
+
+        for (auto& csvFile : csvFiles) {
+            remove(csvFile.c_str());
+            remove(HeadlessOutputPath(csvFile, config).c_str());
+        }
+    }
+
+    std::cout << "CheckHeadless: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: HashPixels
+// Desc: FNV-1a over a canvas, to compare renders
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+uint64_t HashPixels(const PixelCanvas& canvas) {
+
+    auto bytes = reinterpret_cast<const uint8_t*>(canvas.Pixels());
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < static_cast<size_t>(canvas.Pitch()) * canvas.Height(); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckPixelCanvas
+// Desc: SIMD spans match scalar ones, tiles on any number of threads give the same image and triangles sharing an edge
+//       don't both draw it. Bad triangle indices and coordinates are survived. Returns the number of failures.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckPixelCanvas() {
+
+    int failures = 0;
+    std::mt19937 gen(1234);
+
+#ifdef PIXELCANVAS_SSE2
+    std::vector<uint32_t> scalar(1027);
+    std::vector<uint32_t> simd(1027);
+
+    for (auto trial = 0; trial < 1000; trial++) {
+
+        for (size_t i = 0; i < scalar.size(); i++) {
+            scalar[i] = simd[i] = gen();
+        }
+
+        auto color = static_cast<uint32_t>(gen());
+        auto count = gen() % scalar.size();
+
+        BlendSpanScalar(scalar.data(), count, color);
+        BlendSpanSSE2(simd.data(), count, color);
+
+        if (scalar != simd) {
+            std::cout << "BlendSpanSSE2 differs from BlendSpanScalar, color " << std::hex << color << std::dec << "\n";
+            failures++;
+            break;
+        }
+    }
+#endif
+
+    // two triangles making a square, blended once each pixel should be exactly one blend of black
+    PixelCanvas square(64, 64);
+    square.Clear(PackCanvasColor(0, 0, 0, 255));
+
+    SDL_Color half = {255, 255, 255, 128};
+    CanvasVertex corners[4] = {{10.3f, 10.7f, half}, {50.1f, 12.2f, half}, {48.6f, 51.4f, half}, {11.9f, 49.8f, half}};
+    int quad[6] = {0, 1, 2, 0, 2, 3};
+
+    square.FillTriangles(corners, 4, quad, 6);
+    square.Render();
+
+    auto once = PackCanvasColor(0, 0, 0, 255);
+    BlendCanvasPixel(&once, PackCanvasColor(255, 255, 255, 255), 128);
+
+    for (auto y = 0; y < 64; y++) {
+        for (auto x = 0; x < 64; x++) {
+            auto pixel = square.Pixels()[y * 64 + x];
+            if (pixel != once && pixel != PackCanvasColor(0, 0, 0, 255)) {
+                std::cout << "Shared triangle edge drawn twice at " << x << ", " << y << "\n";
+                failures++;
+                y = 64;
+                break;
+            }
+        }
+    }
+
+    // triangles with an index out of range are left out rather than read past the vertices, and corners far off the
+    // canvas or not numbers at all are pulled in rather than overflowing
+    PixelCanvas skipped(64, 64);
+    PixelCanvas expected(64, 64);
+
+    int badQuad[12] = {0, 1, 4, -1, 0, 1, 0, 1, 2, 0, 2, 3};
+
+    skipped.Clear(PackCanvasColor(0, 0, 0, 255));
+    skipped.FillTriangles(corners, 4, badQuad, 12);
+    skipped.Render();
+
+    expected.Clear(PackCanvasColor(0, 0, 0, 255));
+    expected.FillTriangles(corners, 4, quad, 6);
+    expected.Render();
+
+    if (HashPixels(skipped) != HashPixels(expected)) {
+        std::cout << "FillTriangles drew a triangle with an index out of range\n";
+        failures++;
+    }
+
+    CanvasVertex far[3] = {{-1e30f, 5.0f, half}, {1e30f, 5.0f, half}, {std::nanf(""), 60.0f, half}};
+    int farTriangle[3] = {0, 1, 2};
+
+    skipped.FillTriangles(far, 3, farTriangle, 3);
+    skipped.Render();
+
+    // the same frame on 1 thread and on a pool
+    std::vector<double> series(200000);
+    for (size_t i = 0; i < series.size(); i++) {
+        series[i] = sin(i * 0.001) + 0.2 * sin(i * 0.37);
+    }
+
+    uint64_t hashes[2];
+    ThreadPool threadPool(4);
+
+    for (auto threaded = 0; threaded < 2; threaded++) {
+
+        PixelCanvas canvas(1280, 720, threaded ? &threadPool : nullptr);
+
+        SDLPlotConfiguration config;
+        config.grid = false;
+        config.leftMargin = config.rightMargin = config.topMargin = config.bottomMargin = 50;
+        config.plotWidth = 1280;
+        config.plotHeight = 720;
+
+        SDLPlot plot(&canvas, config);
+        SDL_Color green = {0x00, 0xff, 0x00, 0xff};
+        SDL_Color red = {0xff, 0x40, 0x40, 0xc0};
+
+        canvas.Clear(PackCanvasColor(0x2f, 0x2f, 0x2f, 0xff));
+        plot.Draw();
+        plot.Plot(series, green);
+        plot.Plot(std::vector<double>(series.begin(), series.begin() + 500), red, 3.0f, true);
+        plot.DrawTickLabels(0, series.size() - 1, -1.2, 1.2);
+        canvas.Render();
+
+        hashes[threaded] = HashPixels(canvas);
+    }
+
+    if (hashes[0] != hashes[1]) {
+        std::cout << "PixelCanvas output depends on the thread count\n";
+        failures++;
+    }
+
+    std::cout << "CheckPixelCanvas: " << failures << " failures, frame hash " << std::hex << hashes[0] << std::dec << "\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckSeries
+// Desc: DrawSeries after adds, appends, updates and removes has to come out the same as Plot on the equivalent vectors.
+//       Returns the number of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckSeries() {
+
+    SDLPlotConfiguration config;
+    config.grid = false;
+    config.leftMargin = config.rightMargin = config.topMargin = config.bottomMargin = 50;
+    config.plotWidth = 640;
+    config.plotHeight = 360;
+
+    PixelCanvas seriesCanvas(640, 360);
+    PixelCanvas plotCanvas(640, 360);
+
+    SDLPlot seriesPlot(&seriesCanvas, config);
+    SDLPlot plotPlot(&plotCanvas, config);
+
+    std::vector<std::vector<double>> data;
+    std::vector<SeriesId> ids;
+    std::vector<SDL_Color> colors;
+
+    std::mt19937 gen(5);
+    int failures = 0;
+
+    // what SetSeriesWindow is showing, Plot gets the same slice of each series
+    size_t windowBegin = 0;
+    size_t windowEnd = SIZE_MAX;
+
+    auto compare = [&] (const char* step) {
+
+        seriesCanvas.Clear(0);
+        seriesPlot.SetSeriesWindow(windowBegin, windowEnd);
+        seriesPlot.DrawSeries();
+        seriesCanvas.Render();
+
+        plotCanvas.Clear(0);
+        for (size_t i = 0; i < data.size(); i++) {
+            auto begin = std::min(windowBegin, data[i].size());
+            auto end = std::max(begin, std::min(windowEnd, data[i].size()));
+
+            plotPlot.Plot(std::vector<double>(data[i].begin() + begin, data[i].begin() + end), colors[i]);
+        }
+        plotCanvas.Render();
+
+        if (HashPixels(seriesCanvas) != HashPixels(plotCanvas)) {
+            std::cout << "DrawSeries doesn't match Plot after " << step << "\n";
+            failures++;
+        }
+    };
+
+    auto walk = [&gen] (size_t count) {
+        std::vector<double> yData(count);
+        std::normal_distribution<double> step(0.0, 1.0);
+        double y = 0.0;
+        for (auto& sample : yData) {
+            sample = (y += step(gen));
+        }
+        return yData;
+    };
+
+    // a mix of series narrower and wider than the plot
+    for (auto count : {300, 200000, 50, 5000}) {
+        SDL_Color color = {(uint8_t) gen(), (uint8_t) gen(), (uint8_t) gen(), 0xff};
+
+        data.push_back(walk(count));
+        colors.push_back(color);
+        ids.push_back(seriesPlot.AddSeries(data.back(), color));
+    }
+
+    compare("adding");
+    compare("drawing again");
+
+    // grows past the plot width, then appends into the pyramid
+    for (auto count : {400, 10, 70000}) {
+        auto more = walk(count);
+        data[0].insert(data[0].end(), more.begin(), more.end());
+        seriesPlot.AppendSeries(ids[0], more.data(), more.size());
+
+        compare("appending");
+    }
+
+    data[2] = walk(3000);
+    seriesPlot.UpdateSeries(ids[2], data[2]);
+    compare("updating");
+
+    data.erase(data.begin() + 1);
+    colors.erase(colors.begin() + 1);
+    seriesPlot.RemoveSeries(ids[1]);
+    compare("removing");
+
+    seriesPlot.Resize(800, 500);
+    plotPlot.Resize(800, 500);
+    seriesCanvas.Resize(800, 500);
+    plotCanvas.Resize(800, 500);
+    compare("resizing");
+
+    // one series narrower than the window, one decimated inside it and one shown sample for sample
+    for (auto window : {std::make_pair(100, 60000), std::make_pair(5000, 5400), std::make_pair(2990, 3100)}) {
+        windowBegin = window.first;
+        windowEnd = window.second;
+        compare("windowing");
+    }
+
+    windowBegin = 0;
+    windowEnd = SIZE_MAX;
+    compare("showing everything again");
+
+    if (seriesPlot.RemoveSeries(ids[1]) || seriesPlot.SeriesCount() != 3) {
+        std::cout << "RemoveSeries removed a series twice\n";
+        failures++;
+    }
+
+    std::cout << "CheckSeries: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchSeries
+// Desc: 32 overlaid series of 1M samples each: Plot on every series every frame vs. DrawSeries with nothing changed
+//       and with a few ticks appended to one of four live series per frame
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchSeries(unsigned int frameCount) {
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        return;
+    }
+
+    SDLPlot plot(bench.renderer, bench.Configuration());
+
+    std::vector<std::vector<double>> data(32);
+    std::vector<SeriesId> ids;
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    for (size_t s = 0; s < data.size(); s++) {
+        data[s].resize(1000000);
+
+        for (size_t i = 0; i < data[s].size(); i++) {
+            data[s][i] = sin(i * 0.0001 * (s + 1)) + 0.1 * sin(i * 0.37);
+        }
+
+        ids.push_back(plot.AddSeries(data[s], color));
+    }
+
+    auto seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            for (auto& series : data) {
+                plot.Plot(series, color);
+            }
+        }
+    });
+
+    std::cout << "Series Plot every series: " << seconds * 1000.0 / frameCount << " ms/frame\n";
+
+    // first DrawSeries builds the pyramids and geometry
+    seconds = TimeSeconds([&] () { plot.DrawSeries(); });
+    std::cout << "Series first DrawSeries: " << seconds * 1000.0 << " ms\n";
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            plot.DrawSeries();
+        }
+    });
+
+    std::cout << "Series DrawSeries unchanged: " << seconds * 1000.0 / frameCount << " ms/frame\n";
+
+    std::vector<double> ticks(100, 0.5);
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            plot.AppendSeries(ids[frame % 4], ticks.data(), ticks.size());
+            plot.DrawSeries();
+        }
+    });
+
+    std::cout << "Series DrawSeries one appended: " << seconds * 1000.0 / frameCount << " ms/frame\n";
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckSeriesView
+// Desc: Views over int32, float and a strided struct field have to draw the same as Plot on the samples copied into
+//       doubles, and a view series grown through UpdateSeries the same as Plot on the whole view. Returns the number
+//       of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckSeriesView() {
+
+    SDLPlotConfiguration config;
+    config.grid = false;
+    config.leftMargin = config.rightMargin = config.topMargin = config.bottomMargin = 50;
+    config.plotWidth = 640;
+    config.plotHeight = 360;
+
+    PixelCanvas viewCanvas(640, 360);
+    PixelCanvas plotCanvas(640, 360);
+
+    SDLPlot viewPlot(&viewCanvas, config);
+    SDLPlot plotPlot(&plotCanvas, config);
+
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+    int failures = 0;
+
+    auto compare = [&] (const char* step, const std::function<void()>& drawView, const std::function<void()>& drawPlot) {
+
+        viewCanvas.Clear(0);
+        drawView();
+        viewCanvas.Render();
+
+        plotCanvas.Clear(0);
+        drawPlot();
+        plotCanvas.Render();
+
+        if (HashPixels(viewCanvas) != HashPixels(plotCanvas)) {
+            std::cout << "SeriesView doesn't match Plot for " << step << "\n";
+            failures++;
+        }
+    };
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    GenerateTickDay(200000, time, quote);
+
+    for (auto count : {300, 200000}) {
+
+        std::vector<double> copy(quote.begin(), quote.begin() + count);
+        std::vector<float> floats(quote.begin(), quote.begin() + count);
+        std::vector<DateTimePricePair> pairs(count);
+
+        for (auto i = 0; i < count; i++) {
+            pairs[i].quote = quote[i];
+        }
+
+        auto int32View = SeriesView(SeriesColumn(quote.data()), count);
+        auto floatView = SeriesView(floats);
+        auto fieldView = SeriesView::Field(pairs.data(), pairs.size(), &DateTimePricePair::quote);
+
+        compare("int32", [&] () { viewPlot.Plot(int32View, color); }, [&] () { plotPlot.Plot(copy, color); });
+        compare("float", [&] () { viewPlot.Plot(floatView, color); }, [&] () { plotPlot.Plot(copy, color); });
+        compare("a struct field", [&] () { viewPlot.Plot(fieldView, color); }, [&] () { plotPlot.Plot(copy, color); });
+
+        auto id = viewPlot.AddSeries(fieldView, color);
+        compare("an added view", [&] () { viewPlot.DrawSeries(); }, [&] () { plotPlot.Plot(copy, color); });
+        viewPlot.RemoveSeries(id);
+    }
+
+    // a column that's being filled in, with timestamps as x so the gaps show
+    auto id = viewPlot.AddSeries(SeriesView(SeriesColumn(quote.data()), 100, SeriesColumn(time.data())), color);
+
+    for (auto count : {100, 600, 5000, 200000}) {
+
+        auto view = SeriesView(SeriesColumn(quote.data()), count, SeriesColumn(time.data()));
+        viewPlot.UpdateSeries(id, view);
+
+        compare("a growing view with x", [&] () { viewPlot.DrawSeries(); }, [&] () { plotPlot.Plot(view, color); });
+    }
+
+    std::cout << "CheckSeriesView: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: ResidentBytes
+// Desc: Resident set size of the process, 0 where there's no /proc
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+size_t ResidentBytes() {
+
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+
+    if (statm >> pages >> resident) {
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+#endif
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchSeriesView
+// Desc: Setup time (AddSeries and the first DrawSeries) and the memory it takes for a count tick quote column, copied
+//       into doubles vs read in place through a view, with and without the timestamp column as x
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchSeriesView(size_t count) {
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        return;
+    }
+
+    SDLPlot plot(bench.renderer, bench.Configuration());
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    GenerateTickDay(count, time, quote);
+
+    std::cout << "SeriesView " << count << " ticks, columns " << count * (sizeof(int64_t) + sizeof(int32_t)) / (1 << 20) << " MB\n";
+
+    auto measure = [&] (const char* name, const std::function<SeriesId()>& add) {
+
+        auto before = ResidentBytes();
+        SeriesId id = 0;
+
+        auto seconds = TimeSeconds([&] () {
+            id = add();
+            plot.DrawSeries();
+        });
+
+        auto after = ResidentBytes();
+
+        std::cout << "SeriesView " << name << ": setup " << seconds * 1000.0 << " ms, " << (after - before) / (1 << 20) << " MB resident\n";
+
+        plot.RemoveSeries(id);
+    };
+
+    measure("copied to doubles", [&] () {
+        return plot.AddSeries(std::vector<double>(quote.begin(), quote.end()), color);
+    });
+
+    measure("view", [&] () {
+        return plot.AddSeries(SeriesView(SeriesColumn(quote.data()), count), color);
+    });
+
+    measure("view with x", [&] () {
+        return plot.AddSeries(SeriesView(SeriesColumn(quote.data()), count, SeriesColumn(time.data())), color);
+    });
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: GenerateTickYear
+// Desc: count ticks over the weekdays of 2017, 08:00 to 22:00 only so there are overnight and weekend gaps, quotes random walking as in
+//       GenerateTickDay
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void GenerateTickYear(size_t count, std::vector<int64_t>& time, std::vector<int32_t>& quote) {
+
+    std::vector<int64_t> days;
+    auto first = DaysFromCivil(2017, 1, 1);
+
+    for (auto day = first; day < DaysFromCivil(2018, 1, 1); day++) {
+        // 1970-01-01 was a Thursday
+        if ((day + 3) % 7 < 5) {
+            days.push_back(day);
+        }
+    }
+
+    auto session = 14 * barHour;
+
+    std::mt19937 gen(11);
+    std::exponential_distribution<double> gap((double) count / (days.size() * session));
+    std::uniform_int_distribution<int> step(-3, 3);
+
+    time.resize(count);
+    quote.resize(count);
+
+    double offset = 0.0;
+    int32_t price = 120000;
+
+    for (size_t i = 0; i < count; i++) {
+        offset = std::min<double>(offset + gap(gen), days.size() * session - 1);
+        price += step(gen);
+
+        auto trading = (int64_t) offset;
+
+        time[i] = days[trading / session] * barDay + 8 * barHour + trading % session;
+        quote[i] = price;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckTimeAxis
+// Desc: TimeIndex against a binary search, calendar ticks and labels against a few known dates, and PlotTimeWindow drawing the same with and
+//       without the index and the pyramid. Returns the number of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckTimeAxis(const std::vector<int64_t>& time, const std::vector<int32_t>& quote) {
+
+    int failures = 0;
+
+    TimeIndex index;
+    index.Build(time.data(), time.size());
+
+    std::mt19937_64 gen(3);
+    std::uniform_int_distribution<int64_t> anyTime(time.front() - barDay, time.back() + barDay);
+
+    for (auto i = 0; i < 100000; i++) {
+        auto t = (i < 3) ? time[i * (time.size() - 1) / 2] : anyTime(gen);
+
+        if (index.LowerBound(t) != TimeLowerBound(time.data(), 0, time.size(), t)) {
+            std::cout << "TimeIndex::LowerBound(" << t << ") doesn't match the binary search\n";
+            failures++;
+            break;
+        }
+    }
+
+    for (auto day = DaysFromCivil(1900, 1, 1); day < DaysFromCivil(2100, 1, 1); day += 17) {
+        int64_t year;
+        unsigned int month;
+        unsigned int dayOfMonth;
+        CivilFromDays(day, year, month, dayOfMonth);
+
+        if (DaysFromCivil(year, month, dayOfMonth) != day) {
+            std::cout << "CivilFromDays(" << day << ") doesn't round trip\n";
+            failures++;
+            break;
+        }
+    }
+
+    struct Expected {
+        int64_t begin;
+        int64_t end;
+        const char* firstLabel;
+    };
+
+    auto march14 = DaysFromCivil(2017, 3, 14) * barDay;
+
+    Expected expected[] = {
+        {march14 + 9 * barHour + 7 * barMinute, march14 + 11 * barHour, "09:15"},
+        {march14 + 1, march14 + 6 * barDay, "Mar 15"},
+        {march14, march14 + 300 * barDay, "Apr 2017"},
+        {march14, march14 + 3000 * barDay, "2018"},
+        {march14 + 9 * barHour + 1, march14 + 9 * barHour + 900, "00:00.250"},
+        {march14 + 9 * barHour + 1, march14 + 9 * barHour + 3 * barSecond, "09:00:01"}
+    };
+
+    std::vector<int64_t> ticks;
+    char text[32];
+
+    for (auto& test : expected) {
+        auto step = CalendarTicks(test.begin, test.end, 8, ticks);
+
+        if (ticks.empty() || ticks.size() > 8) {
+            std::cout << "CalendarTicks gave " << ticks.size() << " ticks\n";
+            failures++;
+            continue;
+        }
+
+        FormatTimeTick(ticks[0], step, text, sizeof(text));
+
+        if (std::string(test.firstLabel) != text || ticks.front() < test.begin || ticks.back() > test.end) {
+            std::cout << "CalendarTicks first label " << text << ", expected " << test.firstLabel << "\n";
+            failures++;
+        }
+    }
+
+    SDLPlotConfiguration config;
+    config.grid = false;
+    config.leftMargin = config.rightMargin = config.topMargin = config.bottomMargin = 50;
+    config.plotWidth = 640;
+    config.plotHeight = 360;
+
+    PixelCanvas searchCanvas(640, 360);
+    PixelCanvas indexCanvas(640, 360);
+
+    SDLPlot searchPlot(&searchCanvas, config);
+    SDLPlot indexPlot(&indexCanvas, config);
+
+    MinMaxPyramid pyramid;
+    pyramid.Build(quote.data(), quote.size());
+
+    auto view = SeriesView(SeriesColumn(quote.data()), quote.size(), SeriesColumn(time.data()));
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    // a few minutes, an afternoon, a week either side of a weekend, a quarter
+    int64_t lengths[] = {5 * barMinute, 6 * barHour, 9 * barDay, 90 * barDay};
+
+    for (auto length : lengths) {
+        auto begin = time[time.size() / 3] - length / 2;
+
+        searchCanvas.Clear(0);
+        auto searched = searchPlot.PlotTimeWindow(view, begin, begin + length, color);
+        searchCanvas.Render();
+
+        indexCanvas.Clear(0);
+        auto indexed = indexPlot.PlotTimeWindow(view, begin, begin + length, color, 1.0f, false, &index, &pyramid);
+        indexCanvas.Render();
+
+        if (searched.begin != indexed.begin || searched.end != indexed.end || searched.min != indexed.min || searched.max != indexed.max ||
+            HashPixels(searchCanvas) != HashPixels(indexCanvas)) {
+            std::cout << "PlotTimeWindow through the index and pyramid doesn't match for a " << length << " ms window\n";
+            failures++;
+        }
+    }
+
+    std::cout << "CheckTimeAxis: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchTimeAxis
+// Desc: Window lookups on a year of count ticks: binary search vs TimeIndex, then the whole PlotTimeWindow with the index and pyramid, for
+//       windows from a minute to a month
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchTimeAxis(size_t count) {
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    GenerateTickYear(count, time, quote);
+
+    if (CheckTimeAxis(time, quote) != 0) {
+        return;
+    }
+
+    TimeIndex index;
+    MinMaxPyramid pyramid;
+
+    auto seconds = TimeSeconds([&] () {
+        index.Build(time.data(), time.size());
+        pyramid.Build(quote.data(), quote.size());
+    });
+
+    std::cout << "TimeAxis " << count << " ticks, index and pyramid built in " << seconds * 1000.0 << " ms\n";
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        return;
+    }
+
+    SDLPlot plot(bench.renderer, bench.Configuration());
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    auto view = SeriesView(SeriesColumn(quote.data()), quote.size(), SeriesColumn(time.data()));
+
+    std::mt19937_64 gen(5);
+    std::uniform_int_distribution<int64_t> anyTime(time.front(), time.back());
+
+    const size_t queryCount = 200000;
+    std::vector<int64_t> starts(queryCount);
+
+    for (auto& start : starts) {
+        start = anyTime(gen);
+    }
+
+    struct Window {
+        const char* name;
+        int64_t length;
+    };
+
+    Window windows[] = {{"minute", barMinute}, {"hour", barHour}, {"day", barDay}, {"month", 30 * barDay}};
+
+    for (auto& window : windows) {
+
+        size_t visible = 0;
+
+        auto search = TimeSeconds([&] () {
+            for (auto start : starts) {
+                auto begin = TimeLowerBound(time.data(), 0, time.size(), start);
+                visible += TimeLowerBound(time.data(), begin, time.size(), start + window.length) - begin;
+            }
+        });
+
+        auto indexed = TimeSeconds([&] () {
+            for (auto start : starts) {
+                visible -= index.LowerBound(start + window.length) - index.LowerBound(start);
+            }
+        });
+
+        if (visible != 0) {
+            std::cout << "TimeAxis: TimeIndex found different windows than the binary search\n";
+        }
+
+        auto plotCount = queryCount / 1000;
+
+        auto plotted = TimeSeconds([&] () {
+            for (size_t i = 0; i < plotCount; i++) {
+                plot.PlotTimeWindow(view, starts[i], starts[i] + window.length, color, 1.0f, false, &index, &pyramid);
+            }
+        });
+
+        std::cout << "TimeAxis " << window.name << " window: binary search " << search * 1e9 / queryCount << " ns, TimeIndex " << indexed * 1e9 / queryCount
+                  << " ns, PlotTimeWindow " << plotted * 1e6 / plotCount << " us\n";
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckViewer
+// Desc: Bursts of synthetic events through PlotViewer: they have to merge into one input, and the window has to zoom, pan, clamp and follow
+//       the way the keys say. Returns the number of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckViewer() {
+
+    int failures = 0;
+
+    PlotViewer viewer;
+    viewer.SetPlotArea(50, 1000);
+
+    ViewerInput input;
+    Expect(failures, "PlotViewer", viewer.Apply(input, 100000) && viewer.Begin() == 0 && viewer.End() == 100000, "doesn't start out showing everything");
+
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+
+    // zoom in twice around the middle, then drag 100 pixels left in 1 pixel steps
+    event.type = SDL_KEYDOWN;
+    event.key.keysym.sym = SDLK_UP;
+    viewer.AddEvent(event, input);
+    viewer.AddEvent(event, input);
+
+    event.type = SDL_MOUSEBUTTONDOWN;
+    event.button.button = SDL_BUTTON_LEFT;
+    viewer.AddEvent(event, input);
+
+    event.type = SDL_MOUSEMOTION;
+    event.motion.xrel = -1;
+
+    for (auto i = 0; i < 100; i++) {
+        viewer.AddEvent(event, input);
+    }
+
+    event.type = SDL_MOUSEBUTTONUP;
+    viewer.AddEvent(event, input);
+
+    event.type = SDL_MOUSEMOTION;
+    Expect(failures, "PlotViewer", !viewer.AddEvent(event, input), "pans after the button is let go");
+
+    Expect(failures, "PlotViewer", input.zoom == 0.8 * 0.8 && input.pan == 100.0, "didn't merge the burst into one input");
+    Expect(failures, "PlotViewer", viewer.Apply(input, 100000), "didn't move for the burst");
+
+    // 64000 samples centred on 50000, then 100 of 1000 pixels later
+    Expect(failures, "PlotViewer", viewer.Begin() == 18000 + 6400 && viewer.End() == 82000 + 6400, "zoomed or panned to the wrong window");
+    Expect(failures, "PlotViewer", !viewer.Following(), "still follows after panning away from the end");
+    Expect(failures, "PlotViewer", !viewer.Grow(200000) && viewer.End() == 88400, "moved for new data while not following");
+
+    ViewerInput end;
+    end.jumpEnd = true;
+    viewer.Apply(end, 200000);
+    Expect(failures, "PlotViewer", viewer.End() == 200000 && viewer.End() - viewer.Begin() == 64000 && viewer.Following(), "End didn't go to the newest sample");
+    Expect(failures, "PlotViewer", viewer.Grow(200500) && viewer.End() == 200500 && viewer.End() - viewer.Begin() == 64000, "didn't follow new data");
+
+    ViewerInput zoomIn;
+    zoomIn.zoom = 1e-9;
+    viewer.Apply(zoomIn, 200500);
+    Expect(failures, "PlotViewer", viewer.End() - viewer.Begin() == viewerMinVisible, "zoomed in past the limit");
+
+    ViewerInput start;
+    start.jumpStart = true;
+    start.zoom = 1e9;
+    viewer.Apply(start, 200500);
+    Expect(failures, "PlotViewer", viewer.Begin() == 0 && viewer.End() == 200500, "zooming out didn't stop at the data");
+
+    ViewerInput nothing;
+    Expect(failures, "PlotViewer", !viewer.Apply(nothing, 200500), "redraws for nothing");
+
+    std::cout << "CheckViewer: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchViewer
+// Desc: Frame time of the interactive viewer on a count sample series: a redraw after a drag, after a zoom and while following new quotes,
+//       against the 16 ms budget
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchViewer(size_t count, unsigned int frameCount) {
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer == nullptr) {
+        return;
+    }
+
+    SDLPlot plot(bench.renderer, bench.Configuration());
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    std::vector<double> yData(count);
+    for (size_t i = 0; i < count; i++) {
+        yData[i] = sin(i * 0.0001) + 0.1 * sin(i * 0.37);
+    }
+
+    auto quotes = plot.AddSeries(std::move(yData), color);
+
+    PlotViewer viewer;
+    viewer.SetPlotArea(50, 1180);
+    viewer.Apply(ViewerInput(), count);
+
+    auto frame = [&] () {
+        size_t begin;
+        size_t end;
+        double min;
+        double max;
+
+        plot.SetSeriesWindow(viewer.Begin(), viewer.End());
+        plot.DrawSeries();
+
+        if (plot.SeriesWindowRange(quotes, begin, end, min, max)) {
+            plot.DrawTickLabels(begin, end - 1, min, max);
+        }
+    };
+
+    auto seconds = TimeSeconds(frame);
+    std::cout << "Viewer " << count << " samples, first frame (builds the pyramid): " << seconds * 1000.0 << " ms\n";
+
+    ViewerInput zoom;
+    zoom.zoom = 0.1;
+    viewer.Apply(zoom, count);
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int i = 0; i < frameCount; i++) {
+            ViewerInput drag;
+            drag.pan = (i % 20 < 10) ? 37.0 : -37.0;
+            viewer.Apply(drag, count);
+            frame();
+        }
+    });
+
+    std::cout << "Viewer drag frame: " << seconds * 1000.0 / frameCount << " ms\n";
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int i = 0; i < frameCount; i++) {
+            ViewerInput wheel;
+            wheel.zoom = (i % 20 < 10) ? 0.8 : 1.25;
+            wheel.zoomAnchor = 0.3;
+            viewer.Apply(wheel, count);
+            frame();
+        }
+    });
+
+    std::cout << "Viewer zoom frame: " << seconds * 1000.0 / frameCount << " ms\n";
+
+    ViewerInput end;
+    end.jumpEnd = true;
+    viewer.Apply(end, count);
+
+    std::vector<double> ticks(100, 0.5);
+
+    // the first append outgrows the vector and copies the whole series, that's once and not per frame
+    plot.AppendSeries(quotes, ticks.data(), ticks.size());
+    count += ticks.size();
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int i = 0; i < frameCount; i++) {
+            plot.AppendSeries(quotes, ticks.data(), ticks.size());
+            count += ticks.size();
+
+            viewer.Grow(count);
+            frame();
+        }
+    });
+
+    std::cout << "Viewer following frame: " << seconds * 1000.0 / frameCount << " ms\n";
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: PipelineLayout
+// Desc: Same layout BenchRenderer::Configuration gives, without needing a renderer
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+SDLPlotConfiguration PipelineLayout(int width, int height) {
+    SDLPlotConfiguration config;
+    config.grid = false;
+    config.leftMargin = 50;
+    config.rightMargin = 50;
+    config.topMargin = 50;
+    config.bottomMargin = 50;
+    config.plotWidth = width;
+    config.plotHeight = height;
+
+    return config;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: WaitForFrame
+// Desc: Takes frames until one satisfies done, polling like the main loop would. False after timeoutSeconds.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+bool WaitForFrame(PlotPipeline& pipeline, double timeoutSeconds, const std::function<bool(const PlotFrame&)>& done) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < timeoutSeconds) {
+
+        if (pipeline.TakeFrame() && done(pipeline.Frame())) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckPipeline
+// Desc: The queue and snapshot handovers between threads, then a csv loaded through PlotPipeline has to come out as the same polylines the
+//       plot would have built from the whole file on one thread. Returns the number of mismatches
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckPipeline() {
+
+    int failures = 0;
+
+    // far more values than slots, so the producer keeps catching up with the consumer
+    SpscQueue<size_t> queue(50);
+    const size_t valueCount = 1000000;
+
+    std::thread producer([&queue, valueCount] () {
+        for (size_t i = 0; i < valueCount;) {
+            auto value = i;
+
+            if (queue.TryPush(value)) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    size_t expected = 0;
+    auto ordered = true;
+
+    while (expected < valueCount) {
+        size_t value;
+
+        if (queue.TryPop(value)) {
+            ordered = ordered && (value == expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+    Expect(failures, "PlotPipeline", ordered, "queue lost, repeated or reordered values");
+
+    size_t value;
+    Expect(failures, "PlotPipeline", !queue.TryPop(value), "queue not empty after everything was taken");
+
+    SnapshotBuffer<int> snapshots;
+    Expect(failures, "PlotPipeline", !snapshots.Take(), "took a snapshot nobody published");
+
+    for (auto i = 1; i <= 3; i++) {
+        snapshots.Back() = i;
+        snapshots.Publish();
+    }
+
+    Expect(failures, "PlotPipeline", snapshots.Take() && snapshots.Front() == 3, "didn't take the newest snapshot");
+    Expect(failures, "PlotPipeline", !snapshots.Take() && snapshots.Front() == 3, "took the same snapshot twice");
+
+    std::string filepath = "check_pipeline.csv";
+    const unsigned int rowCount = 200000;
+
+    if (!WriteTestTickCsv(filepath, rowCount)) {
+        return failures + 1;
+    }
+
+    std::vector<double> yData;
+    for (auto& dateTimePricePair : StreamReadBlock(filepath)) {
+        yData.push_back(dateTimePricePair.quote);
+    }
+
+    auto samePoints = [] (const std::vector<SDL_Point>& a, const std::vector<SDL_Point>& b) {
+        return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(SDL_Point)) == 0);
+    };
+
+    PlotViewport viewport;
+    viewport.layout = PipelineLayout(1280, 720);
+
+    // small chunks so the frames come in while it loads
+    PlotPipeline pipeline;
+    pipeline.Start(filepath, 4096);
+    pipeline.SetViewport(viewport);
+
+    Expect(failures, "PlotPipeline", WaitForFrame(pipeline, 60.0, [rowCount] (const PlotFrame& frame) { return frame.count == rowCount; }), "never finished loading");
+
+    std::vector<M4Column> columns;
+    std::vector<SDL_Point> points;
+
+    double min;
+    double max;
+
+    DecimateM4(yData.data(), yData.size(), 1180, columns);
+    M4ColumnsRange(columns, min, max);
+    ScaleM4Columns(viewport.layout, columns, std::vector<int>(), min, max, points);
+
+    auto& whole = pipeline.Frame();
+    Expect(failures, "PlotPipeline", whole.begin == 0 && whole.end == rowCount && samePoints(whole.points, points), "whole file doesn't match the single threaded polyline");
+
+    // fewer samples than pixel columns, away from the end
+    viewport.begin = 1000;
+    viewport.end = 1500;
+    viewport.following = false;
+    pipeline.SetViewport(viewport);
+
+    Expect(failures, "PlotPipeline", WaitForFrame(pipeline, 10.0, [] (const PlotFrame& frame) { return frame.begin == 1000; }), "never drew the zoomed window");
+
+    auto range = std::minmax_element(yData.begin() + 1000, yData.begin() + 1500);
+    ScaleSamples(viewport.layout, SeriesView(yData), 1000, 1500, *range.first, *range.second, 0.0, 0.0, points);
+
+    // Frame() is a different buffer after every TakeFrame
+    auto& zoomed = pipeline.Frame();
+    Expect(failures, "PlotPipeline", zoomed.end == 1500 && zoomed.min == *range.first && zoomed.max == *range.second && samePoints(zoomed.points, points), "zoomed window doesn't match");
+
+    pipeline.Stop();
+    remove(filepath.c_str());
+
+    std::cout << "CheckPipeline: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchPipeline
+// Desc: How long a rowCount csv would freeze the window if it were loaded on the main thread, against the pipeline: how soon the first frame
+//       shows up, how long the whole file takes, and the most the main thread ever spends on a step while it's loading. A viewport goes
+//       out every 16 ms like someone dragging, and the time until its frame comes back is the interactive latency.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchPipeline(unsigned int rowCount) {
+
+    std::string filepath = "bench_pipeline.csv";
+
+    if (!WriteTestTickCsv(filepath, rowCount)) {
+        return;
+    }
+
+    auto seconds = TimeSeconds([&filepath] () { StreamReadBlock(filepath); });
+    std::cout << "Pipeline " << rowCount << " rows, loading on the main thread blocks it for " << seconds * 1000.0 << " ms\n";
+
+    PlotViewport viewport;
+    viewport.layout = PipelineLayout(1280, 720);
+
+    PlotPipeline pipeline;
+
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] () { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    pipeline.Start(filepath);
+    pipeline.SetViewport(viewport);
+
+    double firstFrame = -1.0;
+    double longestStep = 0.0;
+    double lastViewport = 0.0;
+    double latency = 0.0;
+    unsigned int frameCount = 0;
+    unsigned int viewportCount = 0;
+    unsigned int answered = 0;
+
+    while (elapsed() < 120.0) {
+
+        auto stepStart = elapsed();
+
+        if (pipeline.TakeFrame()) {
+            frameCount++;
+
+            auto& frame = pipeline.Frame();
+
+            if (firstFrame < 0.0 && frame.points.size() > 1) {
+                firstFrame = stepStart;
+            }
+
+            if (!viewport.following && frame.begin == viewport.begin && answered < viewportCount) {
+                latency += stepStart - lastViewport;
+                answered = viewportCount;
+            }
+
+            if (frame.count == rowCount) {
+                break;
+            }
+        }
+
+        // once a bit has loaded, drag a 100k sample window around the start of the file every 16 ms
+        if (stepStart - lastViewport > 0.016 && pipeline.Frame().count > 200000) {
+            viewport.following = false;
+            viewport.begin = (viewportCount % 2 == 0) ? 50000 : 60000;
+            viewport.end = viewport.begin + 100000;
+
+            pipeline.SetViewport(viewport);
+
+            lastViewport = stepStart;
+            viewportCount++;
+        }
+
+        longestStep = std::max(longestStep, elapsed() - stepStart);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::cout << "Pipeline first frame after " << firstFrame * 1000.0 << " ms, all rows after " << elapsed() * 1000.0 << " ms, " << frameCount << " frames\n";
+    std::cout << "Pipeline longest main thread step " << longestStep * 1000.0 << " ms, viewport to frame " << ((answered > 0) ? latency * 1000.0 / answered : 0.0) << " ms avg over " << answered << " of " << viewportCount << "\n";
+
+    pipeline.Stop();
+    remove(filepath.c_str());
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: ReferenceIndicator
+// Desc: The indicators the slow way, each value from scratch over its window, for CheckIndicators. Bollinger is the middle band only.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+std::vector<double> ReferenceIndicator(const IndicatorSpec& spec, const std::vector<double>& prices, std::vector<double>* upper = nullptr) {
+
+    std::vector<double> out(prices.size());
+
+    for (size_t i = 0; i < prices.size(); i++) {
+
+        auto first = (i + 1 >= spec.period) ? i + 1 - spec.period : 0;
+        auto n = static_cast<double>(i + 1 - first);
+
+        double sum = 0.0;
+        double sumSquares = 0.0;
+
+        for (auto j = first; j <= i; j++) {
+            sum += prices[j];
+        }
+
+        for (auto j = first; j <= i; j++) {
+            sumSquares += (prices[j] - sum / n) * (prices[j] - sum / n);
+        }
+
+        switch (spec.type) {
+            case IndicatorType::Sma:
+            case IndicatorType::Bollinger:
+                out[i] = sum / n;
+                if (upper != nullptr) {
+                    upper->push_back(sum / n + spec.width * sqrt(sumSquares / n));
+                }
+                break;
+            case IndicatorType::Ema:
+                out[i] = (i == 0) ? prices[0] : out[i - 1] + 2.0 / (spec.period + 1.0) * (prices[i] - out[i - 1]);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return out;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckIndicators
+// Desc: Each indicator a tick at a time, in uneven batches and in one go has to give the same bits, close to computing every window from
+//       scratch. Then the same through SDLPlot: outputs have to follow appends to their source and share its scale. Returns the number of
+//       mismatches.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckIndicators() {
+
+    int failures = 0;
+
+    std::mt19937 gen(21);
+    std::normal_distribution<double> step(0.0, 0.25);
+
+    const size_t count = 20000;
+
+    // a price far from zero and sessions changing every 1000 ticks
+    std::vector<double> prices(count);
+    std::vector<int64_t> times(count);
+    double price = 4000.0;
+
+    for (size_t i = 0; i < count; i++) {
+        prices[i] = (price += step(gen));
+        times[i] = static_cast<int64_t>(i / 1000) * barDay + static_cast<int64_t>(i % 1000) * barSecond;
+    }
+
+    const IndicatorSpec specs[] = {IndicatorSpec::Sma(50), IndicatorSpec::Ema(20), IndicatorSpec::Bollinger(20, 2.0), IndicatorSpec::Rsi(14), IndicatorSpec::Vwap()};
+    const char* names[] = {"Sma", "Ema", "Bollinger", "Rsi", "Vwap"};
+
+    for (size_t s = 0; s < sizeof(specs) / sizeof(specs[0]); s++) {
+
+        auto& spec = specs[s];
+        auto outputCount = spec.OutputCount();
+
+        std::vector<std::vector<double>> whole(3, std::vector<double>(count));
+        std::vector<std::vector<double>> batched(3, std::vector<double>(count));
+        std::vector<std::vector<double>> streamed(3, std::vector<double>(count));
+
+        double* wholeOut[3] = {whole[0].data(), whole[1].data(), whole[2].data()};
+
+        Indicator indicator(spec);
+        indicator.AddBatch(prices.data(), UnitVolume(), times.data(), 0, count, wholeOut);
+
+        Indicator batches(spec);
+        std::uniform_int_distribution<size_t> batchLength(1, 700);
+
+        for (size_t begin = 0; begin < count;) {
+            auto end = std::min(count, begin + batchLength(gen));
+
+            double* out[3] = {batched[0].data() + begin, batched[1].data() + begin, batched[2].data() + begin};
+            batches.AddBatch(prices.data(), UnitVolume(), times.data(), begin, end, out);
+
+            begin = end;
+        }
+
+        Indicator ticks(spec);
+        double tick[3];
+
+        for (size_t i = 0; i < count; i++) {
+            ticks.Add(prices[i], tick, 1.0, times[i]);
+
+            for (size_t k = 0; k < outputCount; k++) {
+                streamed[k][i] = tick[k];
+            }
+        }
+
+        for (size_t k = 0; k < outputCount; k++) {
+            Expect(failures, "Indicators", memcmp(whole[k].data(), batched[k].data(), count * sizeof(double)) == 0, std::string(names[s]) + " batches differ from one go");
+            Expect(failures, "Indicators", memcmp(whole[k].data(), streamed[k].data(), count * sizeof(double)) == 0, std::string(names[s]) + " ticks differ from one go");
+        }
+
+        Expect(failures, "Indicators", ticks.size() == count && batches.size() == count, std::string(names[s]) + " miscounted samples");
+
+        // the windowed and recursive ones against the slow way
+        if (spec.type == IndicatorType::Sma || spec.type == IndicatorType::Ema || spec.type == IndicatorType::Bollinger) {
+
+            std::vector<double> upper;
+            auto reference = ReferenceIndicator(spec, prices, (spec.type == IndicatorType::Bollinger) ? &upper : nullptr);
+
+            for (size_t i = 0; i < count; i++) {
+                if (fabs(reference[i] - whole[0][i]) > 1e-6 || (!upper.empty() && fabs(upper[i] - whole[1][i]) > 1e-6)) {
+                    Expect(failures, "Indicators", false, std::string(names[s]) + " differs from the reference at " + std::to_string(i));
+                    break;
+                }
+            }
+        }
+
+        if (spec.type == IndicatorType::Rsi) {
+            Expect(failures, "Indicators", std::all_of(whole[0].begin(), whole[0].end(), [] (double value) { return value >= 0.0 && value <= 100.0; }), "Rsi out of 0 to 100");
+        }
+
+        if (spec.type == IndicatorType::Vwap) {
+            double sum = 0.0;
+            for (size_t i = 1000; i < 2000; i++) {
+                sum += prices[i];
+            }
+            Expect(failures, "Indicators", whole[0][1000] == prices[1000] && fabs(whole[0][1999] - sum / 1000.0) < 1e-9, "Vwap didn't restart with the session");
+        }
+    }
+
+    // through the plot: grow the source and the outputs have to be the same as computing over the whole thing
+    SDLPlotConfiguration config;
+    config.grid = false;
+    config.leftMargin = config.rightMargin = config.topMargin = config.bottomMargin = 50;
+    config.plotWidth = 640;
+    config.plotHeight = 360;
+
+    PixelCanvas canvas(640, 360);
+    SDLPlot plot(&canvas, config);
+
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    auto quotes = plot.AddSeries(std::vector<double>(prices.begin(), prices.begin() + 5000), color);
+    auto bands = plot.AddIndicator(quotes, IndicatorSpec::Bollinger(20, 3.0), color);
+    auto rsi = plot.AddIndicator(quotes, IndicatorSpec::Rsi(14), color);
+
+    Expect(failures, "Indicators", bands.size() == 3 && rsi.size() == 1, "AddIndicator made the wrong number of series");
+
+    for (size_t begin = 5000; begin < count; begin += 1500) {
+        plot.AppendSeries(quotes, prices.data() + begin, std::min<size_t>(1500, count - begin));
+    }
+
+    std::vector<std::vector<double>> expected(3, std::vector<double>(count));
+    double* expectedOut[3] = {expected[0].data(), expected[1].data(), expected[2].data()};
+
+    Indicator(IndicatorSpec::Bollinger(20, 3.0)).AddBatch(prices.data(), 0, count, expectedOut);
+
+    for (size_t k = 0; k < bands.size(); k++) {
+
+        size_t seriesCount;
+        double min;
+        double max;
+
+        auto range = std::minmax_element(expected[k].begin(), expected[k].end());
+
+        Expect(failures, "Indicators", plot.SeriesRange(bands[k], seriesCount, min, max) && seriesCount == count && min == *range.first && max == *range.second,
+            "band " + std::to_string(k) + " didn't follow the appends");
+    }
+
+    // the quotes are drawn on a scale wide enough for their bands, the Rsi on one of its own
+    size_t begin;
+    size_t end;
+    double min;
+    double max;
+
+    plot.SetSeriesWindow(0, SIZE_MAX);
+    plot.DrawSeries();
+
+    auto lowest = *std::min_element(expected[2].begin(), expected[2].end());
+    auto highest = *std::max_element(expected[1].begin(), expected[1].end());
+
+    Expect(failures, "Indicators", plot.SeriesWindowRange(quotes, begin, end, min, max) && min == lowest && max == highest, "quotes don't share the bands' scale");
+    Expect(failures, "Indicators", plot.SeriesWindowRange(bands[1], begin, end, min, max) && min == lowest && max == highest, "bands aren't on the quotes' scale");
+    Expect(failures, "Indicators", plot.SeriesWindowRange(rsi[0], begin, end, min, max) && min >= 0.0 && max <= 100.0 && max > 50.0, "Rsi isn't on a scale of its own");
+
+    plot.UpdateSeries(quotes, std::vector<double>(prices.begin(), prices.begin() + 100));
+
+    size_t seriesCount;
+    Expect(failures, "Indicators", plot.SeriesRange(rsi[0], seriesCount, min, max) && seriesCount == 100, "outputs weren't recomputed for new data");
+
+    plot.RemoveSeries(quotes);
+    plot.AppendSeries(rsi[0], prices.data(), 10);
+    Expect(failures, "Indicators", plot.SeriesRange(rsi[0], seriesCount, min, max) && seriesCount == 110, "outputs don't outlive their source");
+
+    std::cout << "CheckIndicators: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchIndicators
+// Desc: Each indicator over count int32 quotes read in place: one batch, a tick at a time, and through SDLPlot where a frame's worth of new ticks
+//       only runs the new ones through instead of the whole series
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchIndicators(size_t count) {
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    GenerateTickYear(count, time, quote);
+
+    const IndicatorSpec specs[] = {IndicatorSpec::Sma(200), IndicatorSpec::Ema(200), IndicatorSpec::Bollinger(200, 2.0), IndicatorSpec::Rsi(14), IndicatorSpec::Vwap()};
+    const char* names[] = {"Sma", "Ema", "Bollinger", "Rsi", "Vwap"};
+
+    std::vector<std::vector<double>> results(3, std::vector<double>(count));
+    double* outputs[3] = {results[0].data(), results[1].data(), results[2].data()};
+
+    double checksum = 0.0;
+
+    for (size_t s = 0; s < sizeof(specs) / sizeof(specs[0]); s++) {
+
+        Indicator indicator(specs[s]);
+
+        auto seconds = TimeSeconds([&] () { indicator.AddBatch(quote.data(), UnitVolume(), time.data(), 0, count, outputs); });
+        checksum += results[0][count - 1];
+
+        std::cout << "Indicators " << names[s] << " batch: " << count / seconds / 1e6 << " M samples/s\n";
+
+        indicator.Reset();
+        double tick[3];
+
+        const size_t tickCount = std::min<size_t>(count, 5000000);
+
+        seconds = TimeSeconds([&] () {
+            for (size_t i = 0; i < tickCount; i++) {
+                indicator.Add(quote[i], tick, 1.0, time[i]);
+            }
+        });
+        checksum += tick[0];
+
+        std::cout << "Indicators " << names[s] << " a tick at a time: " << seconds * 1e9 / tickCount << " ns/tick\n";
+    }
+
+    // a million samples with every indicator on, 100 new ticks a frame
+    const size_t plotCount = 1000000;
+
+    PixelCanvas canvas(1280, 720);
+    SDLPlotConfiguration config;
+    config.grid = false;
+    config.leftMargin = config.rightMargin = config.topMargin = config.bottomMargin = 50;
+    config.plotWidth = 1280;
+    config.plotHeight = 720;
+
+    SDLPlot plot(&canvas, config);
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    auto quotes = plot.AddSeries(std::vector<double>(quote.begin(), quote.begin() + plotCount), color);
+
+    auto seconds = TimeSeconds([&] () {
+        for (auto& spec : specs) {
+            plot.AddIndicator(quotes, spec, color);
+        }
+    });
+
+    std::cout << "Indicators all five over " << plotCount << " samples: " << seconds * 1000.0 << " ms\n";
+
+    std::vector<double> ticks(quote.begin() + plotCount, quote.begin() + plotCount + 100);
+    const unsigned int frameCount = 200;
+
+    // the first append outgrows the vectors, that's once and not per frame
+    plot.AppendSeries(quotes, ticks.data(), ticks.size());
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < frameCount; frame++) {
+            plot.AppendSeries(quotes, ticks.data(), ticks.size());
+        }
+    });
+
+    std::cout << "Indicators all five, 100 ticks appended: " << seconds * 1e6 / frameCount << " us/frame\n";
+
+    seconds = TimeSeconds([&] () {
+        for (unsigned int frame = 0; frame < 5; frame++) {
+            plot.UpdateSeries(quotes, std::vector<double>(quote.begin(), quote.begin() + plotCount));
+        }
+    });
+
+    std::cout << "Indicators all five recomputed from scratch: " << seconds * 1000.0 / 5 << " ms/frame (checksum " << checksum << ")\n";
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckGenerators
+// Desc: The generators have to give the same bits however they're chunked or threaded, the SSE2 and scalar math has to agree, the normals have
+//       to look normal and ticks written to csv have to import back to the same columns. Returns the number of mismatches.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckGenerators() {
+
+    int failures = 0;
+
+    auto same = [] (const void* a, const void* b, size_t bytes) { return memcmp(a, b, bytes) == 0; };
+
+    // the math kernels against the C library
+    CounterRng rng(42);
+    double worstLog = 0.0;
+    double worstSinCos = 0.0;
+
+    for (uint64_t i = 0; i < 1000000; i++) {
+        auto x = 1.0 - rng.Uniform(i);
+        worstLog = std::max(worstLog, fabs(GeneratorLog(x) - log(x)) / std::max(1e-300, fabs(log(x))));
+
+        double sine;
+        double cosine;
+        GeneratorSinCos(x - 1e-17 * (x == 1.0), sine, cosine);
+        worstSinCos = std::max(worstSinCos, std::max(fabs(sine - sin(2.0 * M_PI * x)), fabs(cosine - cos(2.0 * M_PI * x))));
+    }
+
+    Expect(failures, "Generators", worstLog < 1e-15 && worstSinCos < 1e-15, "log or sincos not accurate");
+
+    // normals in one go against odd sized pieces from odd places, which goes through both the SSE2 and scalar paths
+    const size_t count = 1000003;
+    std::vector<double> whole(count);
+    std::vector<double> pieces(count);
+
+    GenerateNormals(rng, 0, count, whole.data());
+
+    std::mt19937 gen(22);
+    std::uniform_int_distribution<size_t> pieceLength(1, 999);
+
+    for (size_t begin = 0; begin < count;) {
+        auto length = std::min(count - begin, pieceLength(gen));
+        GenerateNormals(rng, begin, length, pieces.data() + begin);
+        begin += length;
+    }
+
+    Expect(failures, "Generators", same(whole.data(), pieces.data(), count * sizeof(double)), "normals depend on how they're cut up");
+
+    double sum = 0.0;
+    double squares = 0.0;
+    double fourths = 0.0;
+    size_t beyond3 = 0;
+
+    for (auto z : whole) {
+        sum += z;
+        squares += z * z;
+        fourths += z * z * z * z;
+        beyond3 += fabs(z) > 3.0;
+    }
+
+    auto mean = sum / count;
+    auto variance = squares / count - mean * mean;
+
+    // 3 sigma of a million samples is 0.003 for the mean, about 0.004 for the variance, 0.015 for the kurtosis and 0.00016 for the tail
+    Expect(failures, "Generators", fabs(mean) < 0.005 && fabs(variance - 1.0) < 0.007 && fabs(fourths / count - 3.0) < 0.03 && fabs(beyond3 / (double) count - 0.0027) < 0.0003,
+        "normals don't look normal");
+
+    // AR(1) threaded against a plain loop over the same normals
+    const size_t walkCount = 1000000;
+
+    auto one = GenerateAr1(7, walkCount, 0.8, 0.05, 0.1, 1);
+    auto many = GenerateAr1(7, walkCount, 0.8, 0.05, 0.1, 3);
+
+    Expect(failures, "Generators", same(one.data(), many.data(), walkCount * sizeof(double)), "AR(1) depends on the thread count");
+
+    std::vector<double> z(walkCount);
+    GenerateNormals(CounterRng(7), 0, walkCount, z.data());
+
+    double x = 0.0;
+    double worst = 0.0;
+
+    for (size_t i = 0; i < walkCount; i++) {
+        x = 0.1 + 0.8 * x + 0.05 * z[i];
+        worst = std::max(worst, fabs(x - one[i]));
+    }
+
+    Expect(failures, "Generators", one[0] == 0.1 + 0.05 * z[0] && worst < 1e-12, "AR(1) doesn't follow its recurrence");
+    Expect(failures, "Generators", GenerateRandomWalk(100, 0.8, 0.05, 0.1, 7) == std::vector<double>(one.begin(), one.begin() + 100), "GenerateRandomWalk isn't the AR(1)");
+
+    auto gbm = GenerateGbm(9, walkCount, 100.0, 0.05, 0.2, 1.0 / 252, 1);
+    auto gbmThreaded = GenerateGbm(9, walkCount, 100.0, 0.05, 0.2, 1.0 / 252, 3);
+
+    Expect(failures, "Generators", same(gbm.data(), gbmThreaded.data(), walkCount * sizeof(double)) && gbm[0] == 100.0, "GBM depends on the thread count");
+
+    // ticks through the csv writer and back through the importer
+    TickGenerator ticks(11, 1483315200000ll, 50.0, 1.05, 0.0001);
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    std::vector<int64_t> timeThreaded;
+    std::vector<int32_t> quoteThreaded;
+
+    const size_t tickCount = 300001;
+
+    ticks.Generate(tickCount, time, quote, 1);
+    ticks.Generate(tickCount, timeThreaded, quoteThreaded, 3);
+
+    Expect(failures, "Generators", time == timeThreaded && quote == quoteThreaded, "ticks depend on the thread count");
+    Expect(failures, "Generators", time[0] == 1483315200000ll && quote[0] == 105000 && std::is_sorted(time.begin(), time.end()), "ticks don't start at the start or go back in time");
+
+    // 50 a second on average
+    auto rate = tickCount / ((time.back() - time.front()) / 1000.0);
+    Expect(failures, "Generators", fabs(rate - 50.0) < 1.0, "ticks don't arrive at their rate");
+
+    std::string filepath = "check_generators.csv";
+    std::string columnsPath = "check_generators_columns.csv";
+
+    Expect(failures, "Generators", ticks.WriteCsv(filepath, tickCount, 3) && WriteTickCsv(columnsPath, time.data(), quote.data(), tickCount), "couldn't write the csv files");
+
+    auto rows = StreamReadBlock(filepath);
+    auto columnRows = StreamReadBlock(columnsPath);
+
+    auto matches = rows.size() == tickCount && columnRows.size() == tickCount;
+
+    for (size_t i = 0; i < tickCount && matches; i++) {
+        matches = ToEpochMillis(rows[i]) == time[i] && rows[i].quote == static_cast<unsigned int>(quote[i]) &&
+            ToEpochMillis(columnRows[i]) == time[i] && columnRows[i].quote == static_cast<unsigned int>(quote[i]);
+    }
+
+    Expect(failures, "Generators", matches, "csv doesn't import back to the generated ticks");
+
+    remove(filepath.c_str());
+    remove(columnsPath.c_str());
+
+    std::cout << "CheckGenerators: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchGenerators
+// Desc: Normals from std::mt19937 and std::normal_distribution against the counter based generator on one thread and on every core, the AR(1)
+//       and tick generators, and ticks written straight to csv and read back by the importer
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchGenerators(size_t count, size_t rowCount) {
+
+    std::vector<double> normals(count);
+
+    auto seconds = TimeSeconds([&] () {
+        std::mt19937 gen(1);
+        std::normal_distribution<double> d(0.0, 1.0);
+        for (auto& z : normals) {
+            z = d(gen);
+        }
+    });
+
+    std::cout << "Generators mt19937 normals: " << count / seconds / 1e6 << " M/s\n";
+
+    seconds = TimeSeconds([&] () { GenerateNormals(CounterRng(1), 0, count, normals.data()); });
+    std::cout << "Generators counter normals, 1 thread: " << count / seconds / 1e6 << " M/s\n";
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+
+    for (auto threadCount : {1u, cores}) {
+
+        seconds = TimeSeconds([&] () { normals = GenerateAr1(1, count, 0.8, 0.05, 0.1, threadCount); });
+        std::cout << "Generators AR(1) on " << threadCount << " threads: " << count / seconds / 1e6 << " M samples/s\n";
+
+        if (cores == 1) {
+            break;
+        }
+    }
+
+    normals = std::vector<double>();
+
+    TickGenerator ticks(1, 1483315200000ll, 50.0, 1.05, 0.0001);
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+
+    seconds = TimeSeconds([&] () { ticks.Generate(count, time, quote); });
+    std::cout << "Generators ticks: " << count / seconds / 1e6 << " M ticks/s\n";
+
+    std::string filepath = "bench_generators.csv";
+
+    seconds = TimeSeconds([&] () { ticks.WriteCsv(filepath, rowCount); });
+
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    auto bytes = static_cast<double>(file.tellg());
+    file.close();
+
+    std::cout << "Generators csv " << rowCount << " rows: " << rowCount / seconds / 1e6 << " M rows/s, " << bytes / seconds / 1e6 << " MB/s\n";
+
+    size_t rows = 0;
+    seconds = TimeSeconds([&] () { rows = StreamReadBlock(filepath).size(); });
+
+    std::cout << "Generators csv read back by StreamReadBlock: " << rows << " rows, " << rows / seconds / 1e6 << " M rows/s\n";
+
+    remove(filepath.c_str());
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckProfiler
+// Desc: Events recorded from several threads while another reads them back, counters, percentiles over replayed frames and the trace file
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckProfiler() {
+#ifndef SDLPLOT_PROFILE
+    std::cout << "CheckProfiler: built without SDLPLOT_PROFILE, nothing to check\n";
+    return 0;
+#else
+    int failures = 0;
+
+    static const char* names[] = {"Writer0", "Writer1", "Writer2", "Writer3"};
+    const uint64_t threadCount = 4;
+
+    // every event says who wrote it and when, so one put together from two different writes shows up
+    auto consistent = [] (const ProfileEvent& event) {
+        auto writer = static_cast<uint64_t>(event.duration % 10);
+        return writer < 4 && event.name == names[writer] && event.duration == event.start * 10 + writer;
+    };
+
+    for (auto perThread : {uint64_t(1000), uint64_t(profileEventCapacity)}) {
+
+        std::unique_ptr<Profiler> profiler(new Profiler());
+        std::atomic<bool> done(false);
+
+        // the first frame has no start and isn't summarised
+        profiler->EndFrame(0);
+        std::atomic<size_t> torn(0);
+
+        std::thread reader([&] () {
+            std::vector<ProfileEvent> events;
+            do {
+                profiler->Events(events);
+                for (auto& event : events) {
+                    torn += consistent(event) ? 0 : 1;
+                }
+            } while (!done.load());
+        });
+
+        std::vector<std::thread> writers;
+
+        for (uint64_t t = 0; t < threadCount; t++) {
+            writers.emplace_back([&, t] () {
+                for (uint64_t i = 0; i < perThread; i++) {
+                    profiler->Record(names[t], i, i * 10 + t);
+                    profiler->Count(ProfileCounter::Vertices, t + 1);
+                }
+            });
+        }
+
+        for (auto& writer : writers) {
+            writer.join();
+        }
+
+        done = true;
+        reader.join();
+
+        Expect(failures, "Profiler", torn == 0, "reader saw a torn event");
+
+        std::vector<ProfileEvent> events;
+        profiler->Events(events);
+
+        auto total = perThread * threadCount;
+        Expect(failures, "Profiler", events.size() == std::min<uint64_t>(total, profileEventCapacity), "events lost");
+
+        // each writer's events come back in the order it wrote them
+        uint64_t last[threadCount] = {};
+        bool first[threadCount] = {true, true, true, true};
+        bool ordered = true;
+
+        for (auto& event : events) {
+            if (!consistent(event)) {
+                ordered = false;
+                continue;
+            }
+            auto writer = event.duration % 10;
+            ordered = ordered && (first[writer] || event.start > last[writer]);
+            first[writer] = false;
+            last[writer] = event.start;
+        }
+
+        Expect(failures, "Profiler", ordered, "events out of order or torn after the writers finished");
+
+        profiler->EndFrame(1000);
+
+        ProfileSummary summary;
+        profiler->Summarize(summary);
+        Expect(failures, "Profiler", summary.counters[static_cast<int>(ProfileCounter::Vertices)] == perThread * (1 + 2 + 3 + 4), "counters lost");
+    }
+
+    // frames of 1..100 ms replayed with a 2 ms stage in each
+    {
+        std::unique_ptr<Profiler> profiler(new Profiler());
+        uint64_t now = 0;
+
+        profiler->EndFrame(now);
+
+        for (uint64_t ms = 1; ms <= 100; ms++) {
+            profiler->Record("Stage", now, 2000000);
+            profiler->Count(ProfileCounter::DrawCalls, ms);
+            now += ms * 1000000;
+            profiler->EndFrame(now);
+        }
+
+        ProfileSummary summary;
+        profiler->Summarize(summary);
+
+        Expect(failures, "Profiler", fabs(summary.fps - 100.0 / 5.050) < 1e-9, "fps");
+        Expect(failures, "Profiler", summary.p50 == 51.0 && summary.p95 == 96.0 && summary.p99 == 100.0, "percentiles");
+        Expect(failures, "Profiler", summary.counters[static_cast<int>(ProfileCounter::DrawCalls)] == 100, "last frame's counters");
+
+        auto stage = std::find_if(summary.stages.begin(), summary.stages.end(), [] (const ProfileStage& stage) { return strcmp(stage.name, "Stage") == 0; });
+        Expect(failures, "Profiler", stage != summary.stages.end() && fabs(stage->milliseconds - 2.0) < 1e-9 && fabs(stage->calls - 1.0) < 1e-9, "stage average");
+        Expect(failures, "Profiler", !summary.stages.empty() && strcmp(summary.stages[0].name, "Frame") == 0, "stages not slowest first");
+
+        // the trace has every event and a counter sample per frame
+        std::string filepath = "bench_trace.json";
+        Expect(failures, "Profiler", profiler->WriteChromeTrace(filepath), "writing the trace");
+
+        std::ifstream file(filepath, std::ios::binary);
+        std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        remove(filepath.c_str());
+
+        auto occurrences = [&json] (const std::string& what) {
+            size_t n = 0;
+            for (auto at = json.find(what); at != std::string::npos; at = json.find(what, at + 1)) {
+                n++;
+            }
+            return n;
+        };
+
+        Expect(failures, "Profiler", json.find("{\"displayTimeUnit\"") == 0, "trace header");
+        Expect(failures, "Profiler", json.size() > 4 && json.compare(json.size() - 4, 4, "\n]}\n") == 0, "trace not closed");
+        Expect(failures, "Profiler", occurrences("\"ph\":\"X\"") == 200 && occurrences("\"name\":\"Stage\"") == 100, "trace events");
+        Expect(failures, "Profiler", occurrences("\"ph\":\"C\"") == 101, "trace counters");
+        Expect(failures, "Profiler", occurrences("{") == occurrences("}") && occurrences("[") == occurrences("]"), "trace brackets");
+        Expect(failures, "Profiler", json.find("\"ts\":4950000.000,\"dur\":2000.000") != std::string::npos, "trace times not in us");
+    }
+
+    // the macros go to the shared profiler
+    {
+        auto begin = Profiler::Get().Now();
+        {
+            PROFILE_SCOPE("CheckScope");
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        std::vector<ProfileEvent> events;
+        Profiler::Get().Events(events);
+
+        auto scope = std::find_if(events.begin(), events.end(), [] (const ProfileEvent& event) { return strcmp(event.name, "CheckScope") == 0; });
+        Expect(failures, "Profiler", scope != events.end() && scope->start >= begin && scope->duration >= 2000000, "PROFILE_SCOPE");
+    }
+
+    std::cout << "CheckProfiler: " << failures << " failures\n";
+    return failures;
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchProfiler
+// Desc: What a scope costs on one thread and on every core at once, and what closing a frame and summarising it for the overlay cost
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchProfiler(size_t count) {
+#ifndef SDLPLOT_PROFILE
+    std::cout << "Profiler: built without SDLPLOT_PROFILE, PROFILE_ macros compile to nothing\n";
+#else
+    auto seconds = TimeSeconds([&] () {
+        for (size_t i = 0; i < count; i++) {
+            PROFILE_SCOPE("BenchScope");
+        }
+    });
+
+    std::cout << "Profiler scope, 1 thread: " << seconds * 1e9 / count << " ns\n";
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+
+    if (cores > 1) {
+        seconds = TimeSeconds([&] () {
+            std::vector<std::thread> threads;
+            for (unsigned int t = 0; t < cores; t++) {
+                threads.emplace_back([&] () {
+                    for (size_t i = 0; i < count; i++) {
+                        PROFILE_SCOPE("BenchScope");
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+
+        std::cout << "Profiler scope, " << cores << " threads: " << seconds * 1e9 / count << " ns per scope per thread\n";
+    }
+
+    seconds = TimeSeconds([&] () {
+        for (size_t i = 0; i < count; i++) {
+            PROFILE_COUNT(ProfileCounter::Vertices, 4);
+        }
+    });
+
+    std::cout << "Profiler count: " << seconds * 1e9 / count << " ns\n";
+
+    // a typical frame's worth of scopes, then what the overlay does once per frame
+    const int frameCount = 1000;
+    ProfileSummary summary;
+
+    seconds = TimeSeconds([&] () {
+        for (int frame = 0; frame < frameCount; frame++) {
+            for (int stage = 0; stage < 10; stage++) {
+                PROFILE_SCOPE("BenchStage");
+            }
+            PROFILE_FRAME();
+        }
+    });
+
+    std::cout << "Profiler frame of 10 scopes: " << seconds * 1e6 / frameCount << " us\n";
+
+    seconds = TimeSeconds([&] () { Profiler::Get().Summarize(summary); });
+    std::cout << "Profiler summary for the overlay: " << seconds * 1e3 << " ms, ring full\n";
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: CheckAllocations
+// Desc: Frames that use every part of the draw path, through the software renderer and through PixelCanvas. Once a warm-up pass has seen
+//       every window the frames cycle through, drawing them again must not touch the heap: every scratch buffer is kept between frames.
+//       One series is big enough to be decimated across threads, and both plots are given more than one, so that path is counted too.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int CheckAllocations(unsigned int cycleLength, unsigned int cycleCount) {
+
+    int failures = 0;
+
+    auto walk = GenerateAr1(1, 200000, 0.8, 0.05, 0.1);
+    auto small = GenerateAr1(2, 800, 0.8, 0.05, 0.1);
+    auto big = GenerateAr1(3, 4 * decimateChunkSize + 1, 0.8, 0.05, 0.1);
+
+    MinMaxPyramid pyramid;
+    pyramid.Build(walk.data(), walk.size());
+
+    std::vector<int64_t> time;
+    std::vector<int32_t> quote;
+    TickGenerator(1, 1483315200000ll, 5.0, 1.05, 0.0001).Generate(200000, time, quote);
+
+    std::vector<OhlcBar> bars;
+    AggregateOhlc(time.data(), quote.data(), time.size(), 60000, bars);
+
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    auto drawFrame = [&] (SDLPlot& plot, unsigned int frame) {
+
+        // a window that slides along and changes size, the chrome redrawn every other frame
+        auto step = frame % cycleLength;
+        auto begin = step * walk.size() / (2 * cycleLength);
+        auto end = begin + walk.size() / (step % 3 + 2);
+
+        if (frame % 2) {
+            plot.Invalidate();
+        }
+
+        plot.Draw();
+        plot.Plot(walk, color);
+        plot.Plot(small, color, 2.0f, true);
+        plot.Plot(big, color);
+        plot.PlotRange(walk, pyramid, begin, end, color);
+
+        plot.SetSeriesWindow(begin / 4, end / 4);
+        plot.DrawSeries();
+
+        plot.PlotCandles(bars, color, color);
+        plot.DrawTickLabels(begin, end, -1.0, 1.0);
+        plot.DrawTimeTickLabels(time[begin], time[end - 1], -1.0, 1.0);
+        plot.DrawProfileOverlay();
+    };
+
+    auto run = [&] (const char* name, SDLPlot& plot, const std::function<void()>& present) {
+
+        auto id = plot.AddSeries(walk, color);
+        plot.AddIndicator(id, IndicatorSpec::Bollinger(20, 2.0), color);
+
+        // the frames are ended so a profile build's overlay has a populated history to summarise
+        for (unsigned int frame = 0; frame < cycleLength; frame++) {
+            drawFrame(plot, frame);
+            present();
+            PROFILE_FRAME();
+        }
+
+        auto before = heapAllocations.load();
+
+        for (unsigned int frame = 0; frame < cycleLength * cycleCount; frame++) {
+            drawFrame(plot, frame);
+            present();
+            PROFILE_FRAME();
+        }
+
+        auto allocations = heapAllocations.load() - before;
+
+        std::cout << "CheckAllocations " << name << ": " << allocations << " heap allocations over " << cycleLength * cycleCount << " frames after warm-up\n";
+        failures += (allocations != 0) ? 1 : 0;
+    };
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer != nullptr) {
+
+        SDLPlot plot(bench.renderer, bench.texture, bench.Configuration());
+        bench.texture = nullptr;
+        plot.SetThreadCount(4);
+
+        run("software renderer", plot, [&bench] () {
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+            SDL_RenderFlush(bench.renderer);
+#endif
+        });
+    }
+
+    ThreadPool threadPool(2);
+    PixelCanvas canvas(1280, 720, &threadPool);
+
+    {
+        // decimates across the canvas's pool. Configured here since bench has no surface if SDL couldn't make one
+        SDLPlotConfiguration config;
+        config.grid = false;
+        config.leftMargin = config.rightMargin = config.topMargin = config.bottomMargin = 50;
+        config.plotWidth = 1280;
+        config.plotHeight = 720;
+
+        SDLPlot plot(&canvas, config);
+        run("PixelCanvas", plot, [&canvas] () { canvas.Render(); });
+    }
+
+    std::cout << "CheckAllocations: " << failures << " failures\n";
+    return failures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: BenchCanvas
+// Desc: The same frame through the SDL software renderer and through PixelCanvas on 1, 2, 4... threads
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+void BenchCanvas(unsigned int frameCount) {
+
+    std::vector<std::vector<double>> series;
+    for (auto s = 0; s < 4; s++) {
+        series.emplace_back(s == 0 ? 100000 : 800);
+
+        for (size_t i = 0; i < series.back().size(); i++) {
+            series.back()[i] = sin(i * 0.01 * (s + 1)) + 0.1 * sin(i * 0.37);
+        }
+    }
+
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    auto drawFrame = [&series, &color] (SDLPlot& plot) {
+        plot.Invalidate();
+        plot.Draw();
+
+        for (size_t s = 0; s < series.size(); s++) {
+            plot.Plot(series[s], color, (s == 3) ? 2.0f : 1.0f, s == 3);
+        }
+
+        plot.DrawTickLabels(0, 100000, -1.1, 1.1);
+    };
+
+    BenchRenderer bench(1280, 720);
+
+    if (bench.renderer != nullptr) {
+
+        SDLPlot plot(bench.renderer, bench.texture, bench.Configuration());
+        bench.texture = nullptr;
+
+        auto seconds = TimeSeconds([&] () {
+            for (unsigned int frame = 0; frame < frameCount; frame++) {
+                SDL_SetRenderDrawColor(bench.renderer, 0x2f, 0x2f, 0x2f, 0xff);
+                SDL_RenderClear(bench.renderer);
+                drawFrame(plot);
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+                SDL_RenderFlush(bench.renderer);
+#endif
+            }
+        });
+
+        Report("Frame SDL software renderer", (seconds * 1000.0) / frameCount, "ms");
+    }
+
+    for (unsigned int threads = 1; threads <= std::max(4u, std::thread::hardware_concurrency()); threads *= 2) {
+
+        ThreadPool threadPool(threads);
+        PixelCanvas canvas(1280, 720, &threadPool);
+        SDLPlot plot(&canvas, bench.Configuration());
+
+        auto seconds = TimeSeconds([&] () {
+            for (unsigned int frame = 0; frame < frameCount; frame++) {
+                canvas.Clear(PackCanvasColor(0x2f, 0x2f, 0x2f, 0xff));
+                drawFrame(plot);
+                canvas.Render();
+            }
+        });
+
+        Report("Frame PixelCanvas " + std::to_string(threads) + " threads", (seconds * 1000.0) / frameCount, "ms");
+    }
+
+    // span fill on its own, a full screen of translucent rects
+    std::vector<uint32_t> row(1280);
+    const char* names[] = {"BlendSpan scalar", "BlendSpan SSE2"};
+
+    for (auto simd = 0; simd < 2; simd++) {
+
+#ifndef PIXELCANVAS_SSE2
+        if (simd) {
+            break;
+        }
+#endif
+
+        auto seconds = TimeSeconds([&] () {
+            for (unsigned int i = 0; i < frameCount * 720; i++) {
+#ifdef PIXELCANVAS_SSE2
+                if (simd) {
+                    BlendSpanSSE2(row.data(), row.size(), 0x80402080);
+                    continue;
+                }
+#endif
+                BlendSpanScalar(row.data(), row.size(), 0x80402080);
+            }
+        });
+
+        Report(names[simd], (seconds * 1e9) / (frameCount * 720.0 * row.size()), "ns/pixel");
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: RunBenchmarks
+// Desc: Every check and benchmark the filter lets through. Returns non-zero as soon as a check fails.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int RunBenchmarks(std::string& filepath) {
+
+    if (ShouldRun("FastParse")) {
+        if (CheckFastParseFixed(100000) != 0) {
+            return 1;
+        }
+
+        BenchFastParse(10000000);
+    }
+
+    if (ShouldRun("Import")) {
+        BenchImport(filepath);
+    }
+
+    if (ShouldRun("TickColumns")) {
+        if (CheckTickColumns() != 0) {
+            return 1;
+        }
+
+        BenchTickColumns(filepath);
+    }
+
+    if (ShouldRun("PlotKernel")) {
+        BenchPlotKernel(100000000);
+    }
+
+    if (ShouldRun("Pyramid")) {
+        if (CheckPyramid() != 0) {
+            return 1;
+        }
+
+        BenchPyramid(100000000);
+    }
+
+    if (ShouldRun("Bars")) {
+        std::vector<int64_t> time;
+        std::vector<int32_t> quote;
+        GenerateTickDay(200000, time, quote);
+
+        if (CheckBars(time, quote) != 0) {
+            return 1;
+        }
+
+        BenchBars(20000000);
+        BenchBarBuilder(20000000);
+    }
+
+    if (ShouldRun("Generators")) {
+        if (CheckGenerators() != 0) {
+            return 1;
+        }
+
+        BenchGenerators(50000000, 10000000);
+    }
+
+    if (ShouldRun("Profiler")) {
+        if (CheckProfiler() != 0) {
+            return 1;
+        }
+
+        BenchProfiler(10000000);
+    }
+
+    if (ShouldRun("Pipeline")) {
+        if (CheckPipeline() != 0) {
+            return 1;
+        }
+
+        BenchPipeline(5000000);
+    }
+
+    // everything renders into surfaces through the software renderer, no window is ever opened, so don't wait on a display unless
+    // SDL_VIDEODRIVER asks for one
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0 || TTF_Init() == -1) {
+        std::cout << "SDL init failed, skipping render benchmarks\n";
+        return 0;
+    }
+
+    if (SDL_GetCurrentVideoDriver() != nullptr) {
+        benchVideoDriver = SDL_GetCurrentVideoDriver();
+    }
+
+    if (ShouldRun("Allocations")) {
+        if (CheckAllocations(16, 4) != 0) {
+            return 1;
+        }
+    }
+
+    if (ShouldRun("Plot")) {
+        BenchPlot(100000000);
+    }
+
+    if (ShouldRun("Grid")) {
+        BenchGrid(1000);
+    }
+
+    if (ShouldRun("Frame")) {
+        BenchFrame(100);
+    }
+
+    if (ShouldRun("Canvas")) {
+        if (CheckPixelCanvas() != 0) {
+            return 1;
+        }
+
+        BenchCanvas(50);
+    }
+
+    if (ShouldRun("Candles")) {
+        BenchCandles(100);
+    }
+
+    if (ShouldRun("Series")) {
+        if (CheckSeries() != 0) {
+            return 1;
+        }
+
+        BenchSeries(20);
+    }
+
+    if (ShouldRun("SeriesView")) {
+        if (CheckSeriesView() != 0) {
+            return 1;
+        }
+
+        BenchSeriesView(50000000);
+    }
+
+    if (ShouldRun("TimeAxis")) {
+        BenchTimeAxis(30000000);
+    }
+
+    if (ShouldRun("Viewer")) {
+        if (CheckViewer() != 0) {
+            return 1;
+        }
+
+        BenchViewer(100000000, 200);
+    }
+
+    if (ShouldRun("Indicators")) {
+        if (CheckIndicators() != 0) {
+            return 1;
+        }
+
+        BenchIndicators(20000000);
+    }
+
+    if (ShouldRun("Headless")) {
+        if (CheckHeadless() != 0) {
+            return 1;
+        }
+
+        BenchHeadless(32, 100000);
+    }
+
+    if (ShouldRun("Labels")) {
+        BenchLabels(100, 300);
+    }
+
+    ClearFontCache();
+    TTF_Quit();
+    SDL_Quit();
+
+    return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: main
+// Desc: SDLPlotBench [tick csv file|-] [name filter] [--repeat N] [--json results.json] [--compare baseline.json] [--tolerance 0.1]
+//       Repeated runs keep each result's best. With --compare the exit code is the number of results more than the tolerance slower
+//       than in the baseline.
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+
+    std::string filepath = "bench_ticks.csv";
+    std::string jsonPath;
+    std::string baselinePath;
+    double tolerance = 0.1;
+    int repeatCount = 1;
+
+    std::vector<std::string> positional;
+
+    for (auto i = 1; i < argc; i++) {
+
+        std::string arg = argv[i];
+        auto hasValue = (i + 1 < argc);
+
+        if (arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        } else if (arg == "--compare" && hasValue) {
+            baselinePath = argv[++i];
+        } else if (arg == "--repeat" && hasValue) {
+            repeatCount = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--tolerance" && hasValue) {
+            tolerance = atof(argv[++i]);
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() > 1) {
+        benchFilter = positional[1];
+    }
+
+    // read it up front, a missing baseline shouldn't cost a whole run to find out
+    std::vector<BenchResult> baseline;
+
+    if (!baselinePath.empty() && (baseline = ReadBenchJson(baselinePath)).empty()) {
+        std::cout << "Error: no results in " << baselinePath << "\n";
+        return 1;
+    }
+
+    if (!positional.empty() && positional[0] != "-") {
+        filepath = positional[0];
+    } else if ((ShouldRun("Import") || ShouldRun("TickColumns")) && !WriteTestTickCsv(filepath, 2000000)) {
+        return 1;
+    }
+
+    for (auto run = 0; run < repeatCount; run++) {
+
+        auto result = RunBenchmarks(filepath);
+
+        if (result != 0) {
+            return result;
+        }
+    }
+
+    KeepBestResults();
+
+    if (!jsonPath.empty() && !WriteBenchJson(jsonPath)) {
+        return 1;
+    }
+
+    return baseline.empty() ? 0 : CompareBenchResults(baseline, tolerance);
+}
@@ -4,6 +4,10 @@
 #include <cstring>
 
 #include "PlotUtility.h"
+#include "CsvImport.h"
+#include "HeadlessRender.h"
+#include "PlotViewer.h"
+#include "PlotPipeline.h"
 
 #include "SDLPlot.h"
 #include "SDL.h"
@@ -22,6 +26,9 @@ struct SDLInfo {
     bool isError; 
 
     void CleanUp() {
+        // cached fonts have to go before TTF_Quit and their atlases before the renderer
+        ClearFontCache(); 
+
         SDL_DestroyWindow(this->window);
         SDL_DestroyRenderer(this->renderer);
 
@@ -87,42 +94,84 @@ SDLInfo SetupSDL(int windowWidth, int windowHeight) {
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 // Name: Update
-// Desc:
+// Desc: Draws the latest frame from the pipeline. All the decimation and scaling happened on the worker, this is just submitting it.
 //---------------------------------------------------------------------------------------------------------------------------------------------------
-void Update(const SDLInfo& sdlInfo, std::vector<double>& plotData) {
-    
-    int windowWidth;
-    int windowHeight; 
-    
+void Update(const SDLInfo& sdlInfo, SDLPlot& plot, const PlotFrame& frame, SDL_Color color, bool showProfile) {
+
     SDL_SetRenderDrawColor(sdlInfo.renderer, 0x2f, 0x2f, 0x2f, 0xff);
     SDL_RenderClear(sdlInfo.renderer);
 
-    SDL_GetWindowSize(sdlInfo.window, &windowWidth, &windowHeight); 
+    // grid, axes and titles, redrawn only if the size changed
+    plot.Draw(); 
 
-    auto texture = SDL_CreateTexture(sdlInfo.renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, windowWidth, windowHeight);
+    plot.PlotPoints(frame.points, color); 
 
-    SDLPlotConfiguration config; 
-    config.leftMargin = 50; 
-    config.rightMargin = 50;
-    config.topMargin = 50;
-    config.bottomMargin = 50; 
-    config.plotWidth = windowWidth;
-    config.plotHeight = windowHeight; 
+    if (frame.end - frame.begin >= 2) {
+        plot.DrawTickLabels(frame.begin, frame.end - 1, frame.min, frame.max); 
+    }
 
-    SDLPlot plot(sdlInfo.renderer, texture, config); 
-    plot.Draw(); 
+    if (showProfile) {
+        plot.DrawProfileOverlay(); 
+    }
+
+    {
+        PROFILE_SCOPE("Present"); 
+        SDL_RenderPresent(sdlInfo.renderer);
+    }
 
-    // detach render target
-    SDL_SetRenderTarget(sdlInfo.renderer, nullptr); 
+    PROFILE_FRAME(); 
+}
 
-    // now render texture to the screen
-    SDL_RenderCopyEx(sdlInfo.renderer, texture, nullptr, nullptr, 0, nullptr, SDL_FLIP_NONE); 
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+// Name: RunHeadless
+// Desc: SDLPlot --headless [--size WxH] [--threads N] [--format png|ppm] [--backend sdl|canvas] [--out dir] file.csv...
+//---------------------------------------------------------------------------------------------------------------------------------------------------
+int RunHeadless(int argc, char* argv[]) {
 
-    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
-    plot.Plot(plotData, color); 
+    HeadlessConfig config; 
+    std::vector<std::string> csvFiles; 
+
+    for (auto i = 2; i < argc; i++) {
+        
+        std::string arg = argv[i]; 
+        auto hasValue = (i + 1 < argc); 
+
+        if (arg == "--size" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &config.width, &config.height) != 2 || config.width < 1 || config.height < 1) {
+                std::cout << "Error: --size expects WIDTHxHEIGHT\n"; 
+                return 1; 
+            }
+        } else if (arg == "--threads" && hasValue) {
+            config.threadCount = atoi(argv[++i]); 
+        } else if (arg == "--format" && hasValue) {
+            config.format = argv[++i]; 
+        } else if (arg == "--backend" && hasValue) {
+            config.backend = argv[++i]; 
+        } else if (arg == "--out" && hasValue) {
+            config.outputDirectory = argv[++i]; 
+        } else {
+            csvFiles.push_back(arg); 
+        }
+    }
+
+    if (csvFiles.empty() || (config.format != "png" && config.format != "ppm") || (config.backend != "sdl" && config.backend != "canvas")) {
+        std::cout << "Usage: SDLPlot --headless [--size WxH] [--threads N] [--format png|ppm] [--backend sdl|canvas] [--out dir] file.csv...\n"; 
+        return 1; 
+    }
+
+    // no video subsystem, nothing here touches a display
+    if (SDL_Init(0) != 0 || TTF_Init() == -1) {
+        std::cout << "Error initialising SDL: " << SDL_GetError() << "\n"; 
+        return 1; 
+    }
+
+    auto rendered = RenderChartsHeadless(csvFiles, config); 
+
+    ClearFontCache(); 
+    TTF_Quit(); 
+    SDL_Quit(); 
 
-    SDL_RenderPresent(sdlInfo.renderer);
-    SDL_DestroyTexture(texture);  
+    return (rendered == csvFiles.size()) ? 0 : 1; 
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------
@@ -131,6 +180,13 @@ void Update(const SDLInfo& sdlInfo, std::vector<double>& plotData) {
 //---------------------------------------------------------------------------------------------------------------------------------------------------
 int main(int argc, char* argv[]) {
 
+    if (argc > 1 && std::string(argv[1]) == "--headless") {
+        return RunHeadless(argc, argv); 
+    }
+
+    // SDLPlot [tick csv file] - with a file it's loaded in the background and followed for new quotes after that
+    const char* csvPath = (argc > 1) ? argv[1] : nullptr; 
+
     int windowWidth = 640;
     int windowHeight = 480; 
 
@@ -140,27 +196,97 @@ int main(int argc, char* argv[]) {
         return 0; 
     }
 
-    auto plotData = GenerateRandomWalk(600, 0.8, 0.05, 0.1); 
-    Update(sdlInfo, plotData); 
+    PlotPipeline pipeline; 
 
-    // Main loop
-    while(1) {
+    if (csvPath == nullptr || !pipeline.Start(csvPath)) {
+        pipeline.Start(GenerateRandomWalk(600, 0.8, 0.05, 0.1)); 
+    }
 
-        SDL_Event event;
-        
-        if(SDL_PollEvent(&event)) {
+    SDLPlotConfiguration config; 
+    config.leftMargin = 50; 
+    config.rightMargin = 50;
+    config.topMargin = 50;
+    config.bottomMargin = 50; 
+    config.plotWidth = windowWidth;
+    config.plotHeight = windowHeight; 
 
-            if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                Update(sdlInfo, plotData); 
-            }
+    SDLPlot plot(sdlInfo.renderer, config); 
 
-            if (event.type == SDL_QUIT) {
-                break; 
-            }
+    SDL_Color color = {0x00, 0xff, 0x00, 0xff};
+
+    PlotViewer viewer; 
+    PlotViewport viewport; 
+
+    auto resized = true; 
+    auto showProfile = false; 
+
+    // Main loop, one frame per pass: everything queued up goes into one redraw, and nothing is drawn unless the worker sent a new frame 
+    // or the window needs repainting
+    while (true) {
+
+        ViewerInput input; 
+        SDL_Event event; 
+
+        // sleep until there's input or the worker has a frame for us
+        if (SDL_WaitEventTimeout(&event, 500)) {
+            do {
+                if (event.type != pipeline.FrameEvent()) {
+                    viewer.AddEvent(event, input); 
+                }
+#ifdef SDLPLOT_PROFILE
+                // F3 shows and hides the profiler overlay
+                if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+                    showProfile = !showProfile; 
+                    input.redraw = true; 
+                }
+#endif
+            } while (SDL_PollEvent(&event)); 
+        }
+
+        if (input.quit) {
+            break; 
         }
+
+        if (input.redraw || resized) {
+            int width; 
+            int height; 
+
+            SDL_GetWindowSize(sdlInfo.window, &width, &height); 
+            plot.Resize(width, height); 
+
+            auto& layout = plot.Configuration(); 
+            viewer.SetPlotArea(layout.leftMargin, layout.plotWidth - layout.leftMargin - layout.rightMargin); 
+
+            viewport.layout = layout; 
+        }
+
+        auto newFrame = pipeline.TakeFrame(); 
+        auto& frame = pipeline.Frame(); 
+
+        // the worker slides a following window along by itself, Grow only keeps the viewer in step with it
+        auto moved = viewer.Apply(input, frame.count); 
+        viewer.Grow(frame.count); 
+
+        if (moved || resized) {
+            viewport.begin = viewer.Begin(); 
+            viewport.end = viewer.End(); 
+            viewport.following = viewer.Following(); 
+
+            pipeline.SetViewport(viewport); 
+        }
+
+        // a moved window is drawn when its frame comes back, a resize straight away with the old one until then
+        if (newFrame || input.redraw || resized) {
+            Update(sdlInfo, plot, frame, color, showProfile); 
+        }
+
+        resized = false; 
     }
+
+#ifdef SDLPLOT_PROFILE
+    // open in chrome://tracing or ui.perfetto.dev
+    Profiler::Get().WriteChromeTrace("sdlplot_trace.json"); 
+#endif
     
     return 0; 
 }
-
-
@@ -0,0 +1,196 @@
+// SeriesView.h
+#ifndef SERIESVIEW_H
+#define SERIESVIEW_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "Decimation.h"
+
+// SeriesType
+// What a SeriesView's elements are
+enum class SeriesType {
+    Int32,
+    UInt32,
+    Int64,
+    Float,
+    Double
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SeriesTypeOf
+// Desc: SeriesType for a C++ type, for the SeriesView constructors
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T> struct SeriesTypeOf;
+template <> struct SeriesTypeOf<int32_t> { static const SeriesType type = SeriesType::Int32; };
+template <> struct SeriesTypeOf<uint32_t> { static const SeriesType type = SeriesType::UInt32; };
+template <> struct SeriesTypeOf<int64_t> { static const SeriesType type = SeriesType::Int64; };
+template <> struct SeriesTypeOf<float> { static const SeriesType type = SeriesType::Float; };
+template <> struct SeriesTypeOf<double> { static const SeriesType type = SeriesType::Double; };
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SeriesColumn
+// Desc: count elements of type, stride bytes apart, starting at data. Doesn't own anything.
+//---------------------------------------------------------------------------------------------------------------------
+struct SeriesColumn {
+    const void* data;
+    size_t stride;
+    SeriesType type;
+
+    SeriesColumn() : data(nullptr), stride(0), type(SeriesType::Double) {}
+
+    template <typename T>
+    SeriesColumn(const T* data, size_t stride = sizeof(T)) : data(data), stride(stride), type(SeriesTypeOf<T>::type) {}
+
+    bool Empty() const { return this->data == nullptr; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SeriesView
+// Desc: A series the plot reads in place: y values and optionally an x value per sample (e.g. a timestamp column),
+//       both possibly strided so a field of an array of structs works as well as a column. Whoever owns the memory
+//       has to keep it alive and unchanged, apart from appending, for as long as the plot uses the view.
+//---------------------------------------------------------------------------------------------------------------------
+struct SeriesView {
+    SeriesColumn y;
+    SeriesColumn x;
+    size_t count;
+
+    SeriesView() : count(0) {}
+    SeriesView(SeriesColumn y, size_t count, SeriesColumn x = SeriesColumn()) : y(y), x(x), count(count) {}
+
+    template <typename T>
+    explicit SeriesView(const std::vector<T>& y) : y(y.data()), count(y.size()) {}
+
+    bool HasX() const { return !this->x.Empty(); }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Field
+    // Desc: A field of every struct in an array, e.g. SeriesView::Field(ticks, count, &DateTimePricePair::quote)
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Struct, typename T>
+    static SeriesView Field(const Struct* structs, size_t count, T Struct::* member) {
+        return SeriesView(SeriesColumn(&(structs->*member), sizeof(Struct)), count);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: SameData
+    // Desc: Same memory read the same way, ignoring count, so other can only have grown
+    //-----------------------------------------------------------------------------------------------------------------
+    bool SameData(const SeriesView& other) const {
+        return this->y.data == other.y.data && this->y.stride == other.y.stride && this->y.type == other.y.type &&
+            this->x.data == other.x.data && this->x.stride == other.x.stride && this->x.type == other.x.type;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: StridedSamples
+// Desc: samples[i] as a double for elements stride bytes apart. Contiguous columns are handed out as plain pointers
+//       instead, so loops over them still vectorize.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+struct StridedSamples {
+    const unsigned char* base;
+    size_t stride;
+
+    double operator[](size_t i) const {
+        T value;
+        memcpy(&value, this->base + i * this->stride, sizeof(T));
+        return static_cast<double>(value);
+    }
+
+    // the samples from offset on, like adding to a pointer
+    StridedSamples operator+(size_t offset) const {
+        StridedSamples moved = {this->base + offset * this->stride, this->stride};
+        return moved;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: VisitColumn
+// Desc: Calls func with the column as something indexable (a const T* or a StridedSamples<T>) so the element type
+//       and stride are only looked at once, not per sample. Returns whatever func does.
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T, typename Func>
+auto VisitColumnAs(const SeriesColumn& column, Func&& func) -> decltype(func(static_cast<const T*>(nullptr))) {
+
+    if (column.stride == sizeof(T) && reinterpret_cast<uintptr_t>(column.data) % alignof(T) == 0) {
+        return func(static_cast<const T*>(column.data));
+    }
+
+    StridedSamples<T> samples = {static_cast<const unsigned char*>(column.data), column.stride};
+    return func(samples);
+}
+
+template <typename Func>
+auto VisitColumn(const SeriesColumn& column, Func&& func) -> decltype(func(static_cast<const double*>(nullptr))) {
+
+    switch (column.type) {
+        case SeriesType::Int32: return VisitColumnAs<int32_t>(column, func);
+        case SeriesType::UInt32: return VisitColumnAs<uint32_t>(column, func);
+        case SeriesType::Int64: return VisitColumnAs<int64_t>(column, func);
+        case SeriesType::Float: return VisitColumnAs<float>(column, func);
+        default: return VisitColumnAs<double>(column, func);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ColumnRange
+// Desc: min/max of column[begin, end), through the SSE2 kernels for contiguous columns
+//---------------------------------------------------------------------------------------------------------------------
+inline void ColumnRange(const SeriesColumn& column, size_t begin, size_t end, double& min, double& max) {
+
+    VisitColumn(column, [begin, end, &min, &max] (const auto& samples) {
+
+        min = samples[begin];
+        max = samples[begin];
+
+        SampleRange(samples, begin + 1, end, min, max);
+    });
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ColumnAt
+// Desc: One element as a double, for the odd read outside a loop
+//---------------------------------------------------------------------------------------------------------------------
+inline double ColumnAt(const SeriesColumn& column, size_t i) {
+    return VisitColumn(column, [i] (const auto& samples) -> double { return samples[i]; });
+}
+
+// ColumnTimes
+// An x column read as timestamps one at a time, for kernels that only look at the odd one, like where sessions start
+struct ColumnTimes {
+    const SeriesColumn* column;
+
+    int64_t operator[](size_t i) const { return static_cast<int64_t>(ColumnAt(*this->column, i)); }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ColumnLowerBound
+// Desc: First index in [begin, end) whose value isn't below value, for an x column in ascending order
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t ColumnLowerBound(const SeriesColumn& column, size_t begin, size_t end, double value) {
+
+    return VisitColumn(column, [begin, end, value] (const auto& samples) -> size_t {
+
+        auto low = begin;
+        auto high = end;
+
+        while (low < high) {
+            auto middle = low + (high - low) / 2;
+
+            if (samples[middle] < value) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        return low;
+    });
+}
+
+#endif // SERIESVIEW_H
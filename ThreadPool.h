@@ -0,0 +1,173 @@
+// ThreadPool.h
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ThreadPool
+// Desc: Threads that stay parked between jobs so per frame work doesn't pay for starting threads. The calling thread
+//       takes part in every ParallelFor, so a pool of threadCount runs threadCount - 1 threads of its own.
+//---------------------------------------------------------------------------------------------------------------------
+class ThreadPool {
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    // the job being run, only touched under mutex apart from next. It's the caller's func and a function that knows its
+    // type rather than a std::function, so handing a lambda to ParallelFor doesn't allocate
+    void (*call)(const void*, size_t);
+    const void* job;
+    size_t jobCount;
+    std::atomic<size_t> next;
+
+    unsigned int busy;
+    unsigned long long generation;
+    bool stopping;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ThreadPool
+    // Desc: threadCount 0 for one per core
+    //-----------------------------------------------------------------------------------------------------------------
+    ThreadPool(unsigned int threadCount = 0) : call(nullptr), job(nullptr), jobCount(0), next(0), busy(0), generation(0), stopping(false) {
+
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (unsigned int i = 1; i < threadCount; i++) {
+            this->threads.emplace_back([this] () { this->Worker(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ~ThreadPool
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    ~ThreadPool() {
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+
+        this->wake.notify_all();
+
+        for (auto& thread : this->threads) {
+            thread.join();
+        }
+    }
+
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(this->threads.size()) + 1; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: ParallelFor
+    // Desc: Calls func(i) for every i in [0, count) spread over the pool and returns once they've all finished. The
+    //       order the indices run in isn't defined. func is anything func(i) works on; nothing is copied or allocated.
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Func>
+    void ParallelFor(size_t count, const Func& func) {
+
+        if (this->threads.empty() || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                func(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            this->call = &ThreadPool::Call<Func>;
+            this->job = &func;
+            this->jobCount = count;
+            this->next = 0;
+            this->busy = static_cast<unsigned int>(this->threads.size());
+            this->generation++;
+        }
+
+        this->wake.notify_all();
+
+        this->RunJob(&ThreadPool::Call<Func>, &func, count);
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done.wait(lock, [this] () { return this->busy == 0; });
+
+        this->call = nullptr;
+        this->job = nullptr;
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Worker
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void Worker() {
+
+        unsigned long long seen = 0;
+
+        while (true) {
+
+            void (*call)(const void*, size_t);
+            const void* job;
+            size_t jobCount;
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->wake.wait(lock, [this, seen] () { return this->stopping || this->generation != seen; });
+
+                if (this->stopping) {
+                    return;
+                }
+
+                seen = this->generation;
+                call = this->call;
+                job = this->job;
+                jobCount = this->jobCount;
+            }
+
+            this->RunJob(call, job, jobCount);
+
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            if (--this->busy == 0) {
+                this->done.notify_one();
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: RunJob
+    // Desc: Takes indices until there are none left
+    //-----------------------------------------------------------------------------------------------------------------
+    void RunJob(void (*call)(const void*, size_t), const void* job, size_t count) {
+        for (auto i = this->next++; i < count; i = this->next++) {
+            call(job, i);
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Call
+    // Desc: Calls job, a Func, with index i
+    //-----------------------------------------------------------------------------------------------------------------
+    template <typename Func>
+    static void Call(const void* job, size_t i) {
+        (*static_cast<const Func*>(job))(i);
+    }
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,375 @@
+// TickColumns.h
+#ifndef TICKCOLUMNS_H
+#define TICKCOLUMNS_H
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "CsvImport.h"
+#include "MappedFile.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: DaysFromCivil
+// Desc: Days since 1970-01-01 for a proleptic gregorian date
+//---------------------------------------------------------------------------------------------------------------------
+inline int64_t DaysFromCivil(int64_t year, unsigned int month, unsigned int day) {
+    year -= (month <= 2);
+
+    auto era = (year >= 0 ? year : year - 399) / 400;
+    auto yearOfEra = static_cast<unsigned int>(year - era * 400);
+    auto dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: CivilFromDays
+// Desc: Inverse of DaysFromCivil
+//---------------------------------------------------------------------------------------------------------------------
+inline void CivilFromDays(int64_t days, int64_t& year, unsigned int& month, unsigned int& day) {
+    days += 719468;
+
+    auto era = (days >= 0 ? days : days - 146096) / 146097;
+    auto dayOfEra = static_cast<unsigned int>(days - era * 146097);
+    auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    auto dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    auto monthIndex = (5 * dayOfYear + 2) / 153;
+
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ToEpochMillis
+// Desc: Milliseconds since the unix epoch, the timestamps are taken as UTC
+//---------------------------------------------------------------------------------------------------------------------
+inline int64_t ToEpochMillis(const DateTimePricePair& dateTimePricePair) {
+    auto days = DaysFromCivil(dateTimePricePair.year, dateTimePricePair.month, dateTimePricePair.day);
+    auto seconds = days * 86400 + dateTimePricePair.hour * 3600 + dateTimePricePair.minute * 60 + dateTimePricePair.second;
+
+    return seconds * 1000 + dateTimePricePair.millisec;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: Checksum64
+// Desc: Cheap 64 bit checksum over a block of memory, 8 bytes at a time
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t Checksum64(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+
+    auto bytes = static_cast<const unsigned char*>(data);
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+// TickFileHeader
+// Sidecar layout: header, then the time column (int64 epoch millis) and the quote column (int32) at the offsets
+// recorded here. Everything is written in the byte order of the machine that wrote it.
+struct TickFileHeader {
+    char magic[8];
+
+    uint32_t version;
+    uint32_t headerSize;
+
+    uint64_t count;
+    uint64_t sourceSize;        // size of the csv the columns came from, 0 if they didn't come from one
+    uint64_t sourceHash;        // SourceFingerprint of that csv, so an edit that keeps the size doesn't go unnoticed
+
+    uint64_t timeOffset;
+    uint64_t quoteOffset;
+
+    uint64_t checksum;          // Checksum64 over the time column followed by the quote column
+};
+
+const char tickFileMagic[8] = {'S', 'D', 'L', 'T', 'I', 'C', 'K', 0};
+const uint32_t tickFileVersion = 2;
+
+// bytes at each end of a csv that SourceFingerprint hashes
+const size_t sourceFingerprintBytes = 64 * 1024;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: SourceFingerprint
+// Desc: Checksum64 over the first and last sourceFingerprintBytes of a size byte file that's open in filestream. Tick
+//       files are appended to and rewritten rather than patched in the middle, so that's enough to tell a sidecar is
+//       stale without reading the whole csv. 0 if the file can't be read.
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t SourceFingerprint(std::ifstream& filestream, uint64_t size) {
+
+    std::vector<char> buffer(static_cast<size_t>(std::min<uint64_t>(size, sourceFingerprintBytes)));
+
+    filestream.clear();
+    filestream.seekg(0);
+    filestream.read(buffer.data(), buffer.size());
+
+    auto hash = Checksum64(buffer.data(), buffer.size());
+
+    filestream.seekg(size - buffer.size());
+    filestream.read(buffer.data(), buffer.size());
+
+    hash = Checksum64(buffer.data(), buffer.size(), hash);
+
+    return filestream ? hash : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: TickColumns
+// Desc: Struct of arrays tick store, one epoch millisecond column and one quote column. The columns either live in
+//       the vectors below or point straight into a mapped sidecar file after Load.
+//---------------------------------------------------------------------------------------------------------------------
+class TickColumns {
+
+    std::vector<int64_t> timeStorage;
+    std::vector<int32_t> quoteStorage;
+
+    std::unique_ptr<MappedFile> mapping;
+
+    const int64_t* mappedTime;
+    const int32_t* mappedQuote;
+    size_t mappedCount;
+
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+
+public:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: TickColumns
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    TickColumns() : mappedTime(nullptr), mappedQuote(nullptr), mappedCount(0), sourceSize(0), sourceHash(0) {}
+
+    TickColumns(TickColumns&&) = default;
+    TickColumns& operator=(TickColumns&&) = default;
+
+    const int64_t* Time() const { return this->mapping ? this->mappedTime : this->timeStorage.data(); }
+    const int32_t* Quote() const { return this->mapping ? this->mappedQuote : this->quoteStorage.data(); }
+
+    size_t size() const { return this->mapping ? this->mappedCount : this->timeStorage.size(); }
+    bool IsMapped() const { return static_cast<bool>(this->mapping); }
+
+    uint64_t SourceSize() const { return this->sourceSize; }
+    uint64_t SourceHash() const { return this->sourceHash; }
+
+    void SetSource(uint64_t size, uint64_t hash) { 
+        this->sourceSize = size; 
+        this->sourceHash = hash; 
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: reserve
+    // Desc:
+    //-----------------------------------------------------------------------------------------------------------------
+    void reserve(size_t count) {
+        this->Unmap();
+
+        this->timeStorage.reserve(count);
+        this->quoteStorage.reserve(count);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: push_back
+    // Desc: Lets the csv importer fill the columns directly
+    //-----------------------------------------------------------------------------------------------------------------
+    void push_back(const DateTimePricePair& dateTimePricePair) {
+        this->Unmap();
+
+        this->timeStorage.push_back(ToEpochMillis(dateTimePricePair));
+        this->quoteStorage.push_back(static_cast<int32_t>(dateTimePricePair.quote));
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Append
+    // Desc: Copies every row of other onto the end of these columns
+    //-----------------------------------------------------------------------------------------------------------------
+    void Append(const TickColumns& other) {
+        this->Unmap();
+
+        this->timeStorage.insert(this->timeStorage.end(), other.Time(), other.Time() + other.size());
+        this->quoteStorage.insert(this->quoteStorage.end(), other.Quote(), other.Quote() + other.size());
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Save
+    // Desc: Writes the columns out as a versioned sidecar file that Load can map back in
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Save(const std::string& filepath) const {
+
+        std::ofstream filestream(filepath, std::ios::binary | std::ios::trunc);
+
+        if (!filestream.is_open()) {
+            std::cout << "Error opening file.";
+            return false;
+        }
+
+        auto count = this->size();
+
+        TickFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, tickFileMagic, sizeof(header.magic));
+
+        header.version = tickFileVersion;
+        header.headerSize = sizeof(TickFileHeader);
+        header.count = count;
+        header.sourceSize = this->sourceSize;
+        header.sourceHash = this->sourceHash;
+
+        // keep both columns 8 byte aligned so they can be used in place once mapped
+        header.timeOffset = (sizeof(TickFileHeader) + 7) & ~7ull;
+        header.quoteOffset = (header.timeOffset + count * sizeof(int64_t) + 7) & ~7ull;
+
+        header.checksum = Checksum64(this->Time(), count * sizeof(int64_t));
+        header.checksum = Checksum64(this->Quote(), count * sizeof(int32_t), header.checksum);
+
+        const char padding[8] = {0};
+
+        filestream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        filestream.write(padding, header.timeOffset - sizeof(header));
+        filestream.write(reinterpret_cast<const char*>(this->Time()), count * sizeof(int64_t));
+        filestream.write(padding, header.quoteOffset - (header.timeOffset + count * sizeof(int64_t)));
+        filestream.write(reinterpret_cast<const char*>(this->Quote()), count * sizeof(int32_t));
+
+        return static_cast<bool>(filestream);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Load
+    // Desc: Maps a sidecar written by Save and points the columns into it. Nothing is parsed or copied; the checksum
+    //       pass is the only thing that touches every page so it can be skipped for trusted files.
+    //-----------------------------------------------------------------------------------------------------------------
+    bool Load(const std::string& filepath, bool verifyChecksum = true) {
+
+        std::unique_ptr<MappedFile> file(new MappedFile());
+
+        if (!file->Open(filepath) || file->Size() < sizeof(TickFileHeader)) {
+            return false;
+        }
+
+        TickFileHeader header;
+        memcpy(&header, file->Data(), sizeof(header));
+
+        if (memcmp(header.magic, tickFileMagic, sizeof(header.magic)) != 0 || header.version != tickFileVersion || header.headerSize != sizeof(TickFileHeader)) {
+            std::cout << "Unrecognised tick file " << filepath << "\n";
+            return false;
+        }
+
+        // divided rather than multiplied so a corrupt count or offset can't wrap around and pass
+        uint64_t size = file->Size();
+
+        if (header.timeOffset % 8 != 0 || header.quoteOffset % 8 != 0 ||
+            header.timeOffset > size || header.count > (size - header.timeOffset) / sizeof(int64_t) || 
+            header.quoteOffset > size || header.count > (size - header.quoteOffset) / sizeof(int32_t)) {
+            std::cout << "Truncated tick file " << filepath << "\n";
+            return false;
+        }
+
+        auto timeBytes = header.count * sizeof(int64_t);
+        auto quoteBytes = header.count * sizeof(int32_t);
+
+        auto time = reinterpret_cast<const int64_t*>(file->Data() + header.timeOffset);
+        auto quote = reinterpret_cast<const int32_t*>(file->Data() + header.quoteOffset);
+
+        if (verifyChecksum) {
+            auto checksum = Checksum64(time, timeBytes);
+            checksum = Checksum64(quote, quoteBytes, checksum);
+
+            if (checksum != header.checksum) {
+                std::cout << "Tick file checksum mismatch " << filepath << "\n";
+                return false;
+            }
+        }
+
+        this->timeStorage.clear();
+        this->quoteStorage.clear();
+
+        this->mapping = std::move(file);
+        this->mappedTime = time;
+        this->mappedQuote = quote;
+        this->mappedCount = header.count;
+        this->sourceSize = header.sourceSize;
+        this->sourceHash = header.sourceHash;
+
+        return true;
+    }
+
+private:
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Unmap
+    // Desc: Copies mapped columns into our own storage before they're modified
+    //-----------------------------------------------------------------------------------------------------------------
+    void Unmap() {
+
+        if (!this->mapping) {
+            return;
+        }
+
+        this->timeStorage.assign(this->mappedTime, this->mappedTime + this->mappedCount);
+        this->quoteStorage.assign(this->mappedQuote, this->mappedQuote + this->mappedCount);
+
+        this->mapping.reset();
+        this->mappedTime = nullptr;
+        this->mappedQuote = nullptr;
+        this->mappedCount = 0;
+    }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: AppendRows
+// Desc: Lets MappedReadParallel merge per chunk TickColumns
+//---------------------------------------------------------------------------------------------------------------------
+void AppendRows(TickColumns& dst, TickColumns& src) {
+    dst.Append(src);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: ImportTickColumns
+// Desc: Opens a day of ticks as columns. If a sidecar (filepath + ".ticks") from the same csv exists it's mapped in,
+//       otherwise the csv is parsed straight into columns and the sidecar is written for next time. The sidecar counts
+//       as from the same csv when the csv's size and SourceFingerprint both match what it recorded.
+//---------------------------------------------------------------------------------------------------------------------
+TickColumns ImportTickColumns(std::string& filepath, bool writeSidecar = true) {
+
+    auto sidecarPath = filepath + ".ticks";
+
+    std::ifstream csvStream(filepath, std::ios::binary | std::ios::ate);
+    auto csvSize = csvStream.is_open() ? static_cast<uint64_t>(csvStream.tellg()) : 0;
+    auto csvHash = csvStream.is_open() ? SourceFingerprint(csvStream, csvSize) : 0;
+
+    TickColumns columns;
+    std::ifstream sidecarStream(sidecarPath);
+
+    if (sidecarStream.is_open() && columns.Load(sidecarPath, false) && columns.SourceSize() == csvSize && columns.SourceHash() == csvHash) {
+        return columns;
+    }
+
+    columns = MappedReadParallel<TickColumns>(filepath);
+    columns.SetSource(csvSize, csvHash);
+
+    if (writeSidecar && columns.size() > 0) {
+        columns.Save(sidecarPath);
+    }
+
+    return columns;
+}
+
+#endif // TICKCOLUMNS_H
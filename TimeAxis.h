@@ -0,0 +1,260 @@
+// TimeAxis.h
+#ifndef TIMEAXIS_H
+#define TIMEAXIS_H
+
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "TickColumns.h"
+#include "Bars.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: TimeLowerBound
+// Desc: First index in [begin, end) of an ascending time column at or after t
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t TimeLowerBound(const int64_t* time, size_t begin, size_t end, int64_t t) {
+    return std::lower_bound(time + begin, time + end, t) - time;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: TimeIndex
+// Desc: Buckets of equal time span over an ascending time column, each remembering where it starts. A lookup is a
+//       division to find the bucket and a binary search inside it, so it costs about the same on a year of ticks as on
+//       a day. Gaps in the data just leave empty buckets. Doesn't own the column, which has to outlive it.
+//---------------------------------------------------------------------------------------------------------------------
+class TimeIndex {
+
+    const int64_t* time;
+    size_t count;
+
+    int64_t first;
+    int64_t span;
+
+    // bucketStart[b] is the first sample at or after first + b * span, with count on the end
+    std::vector<size_t> bucketStart;
+
+public:
+
+    TimeIndex() : time(nullptr), count(0), first(0), span(1) {}
+
+    size_t size() const { return this->count; }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: Build
+    // Desc: One pass over time[0, count), about samplesPerBucket samples to a bucket if they were spread evenly
+    //-----------------------------------------------------------------------------------------------------------------
+    void Build(const int64_t* time, size_t count, size_t samplesPerBucket = 64) {
+
+        this->time = time;
+        this->count = count;
+        this->bucketStart.clear();
+
+        if (count == 0) {
+            return;
+        }
+
+        auto bucketCount = std::max<size_t>(1, count / std::max<size_t>(1, samplesPerBucket));
+
+        // one more than an exact fit so the last sample always lands inside the last bucket
+        this->first = time[0];
+        this->span = (time[count - 1] - time[0]) / static_cast<int64_t>(bucketCount) + 1;
+
+        this->bucketStart.resize(bucketCount + 1);
+
+        size_t i = 0;
+
+        for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+
+            auto start = this->first + static_cast<int64_t>(bucket) * this->span;
+
+            while (i < count && time[i] < start) {
+                i++;
+            }
+
+            this->bucketStart[bucket] = i;
+        }
+
+        this->bucketStart[bucketCount] = count;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // Name: LowerBound
+    // Desc: Same as TimeLowerBound over the whole column
+    //-----------------------------------------------------------------------------------------------------------------
+    size_t LowerBound(int64_t t) const {
+
+        if (this->count == 0 || t <= this->first) {
+            return 0;
+        }
+
+        auto bucket = static_cast<size_t>((t - this->first) / this->span);
+
+        if (bucket + 1 >= this->bucketStart.size()) {
+            return this->count;
+        }
+
+        return TimeLowerBound(this->time, this->bucketStart[bucket], this->bucketStart[bucket + 1], t);
+    }
+};
+
+// TimeUnit
+// Calendar unit a TimeStep counts in
+enum class TimeUnit {
+    Millisecond,
+    Second,
+    Minute,
+    Hour,
+    Day,
+    Week,
+    Month,
+    Year
+};
+
+// TimeStep
+// Distance between two time axis ticks, e.g. {TimeUnit::Minute, 15}
+struct TimeStep {
+    TimeUnit unit;
+    int multiple;
+};
+
+// the steps a time axis is allowed, finest first
+const TimeStep timeSteps[] = {
+    {TimeUnit::Millisecond, 1}, {TimeUnit::Millisecond, 10}, {TimeUnit::Millisecond, 100}, {TimeUnit::Millisecond, 250},
+    {TimeUnit::Second, 1}, {TimeUnit::Second, 5}, {TimeUnit::Second, 15}, {TimeUnit::Second, 30},
+    {TimeUnit::Minute, 1}, {TimeUnit::Minute, 5}, {TimeUnit::Minute, 15}, {TimeUnit::Minute, 30},
+    {TimeUnit::Hour, 1}, {TimeUnit::Hour, 3}, {TimeUnit::Hour, 6}, {TimeUnit::Hour, 12},
+    {TimeUnit::Day, 1}, {TimeUnit::Day, 2}, {TimeUnit::Week, 1},
+    {TimeUnit::Month, 1}, {TimeUnit::Month, 3}, {TimeUnit::Month, 6},
+    {TimeUnit::Year, 1}, {TimeUnit::Year, 2}, {TimeUnit::Year, 5}, {TimeUnit::Year, 10}, {TimeUnit::Year, 50}, {TimeUnit::Year, 100}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: TimeStepLength
+// Desc: Length of a step in ms, months and years on average
+//---------------------------------------------------------------------------------------------------------------------
+inline int64_t TimeStepLength(const TimeStep& step) {
+
+    switch (step.unit) {
+        case TimeUnit::Millisecond: return step.multiple;
+        case TimeUnit::Second: return step.multiple * barSecond;
+        case TimeUnit::Minute: return step.multiple * barMinute;
+        case TimeUnit::Hour: return step.multiple * barHour;
+        case TimeUnit::Day: return step.multiple * barDay;
+        case TimeUnit::Week: return step.multiple * 7 * barDay;
+        case TimeUnit::Month: return step.multiple * 2629746000ll;
+        default: return step.multiple * 31556952000ll;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: CalendarTicks
+// Desc: Tick times in [tBegin, tEnd] on calendar boundaries (midnight, the 1st of the month, Monday for weeks), using
+//       the finest step that gives no more than maxTicks of them. Returns the step so the labels can be formatted to
+//       match.
+//---------------------------------------------------------------------------------------------------------------------
+inline TimeStep CalendarTicks(int64_t tBegin, int64_t tEnd, int maxTicks, std::vector<int64_t>& ticks) {
+
+    ticks.clear();
+
+    auto stepCount = sizeof(timeSteps) / sizeof(timeSteps[0]);
+    auto step = timeSteps[stepCount - 1];
+
+    for (size_t i = 0; i < stepCount; i++) {
+        if ((tEnd - tBegin) / TimeStepLength(timeSteps[i]) < std::max(1, maxTicks)) {
+            step = timeSteps[i];
+            break;
+        }
+    }
+
+    if (step.unit == TimeUnit::Month || step.unit == TimeUnit::Year) {
+
+        // whole months since year 0, rounded up to the step
+        int64_t year;
+        unsigned int month;
+        unsigned int day;
+        CivilFromDays(BarStart(tBegin, barDay) / barDay, year, month, day);
+
+        auto monthStep = (step.unit == TimeUnit::Year) ? 12 * step.multiple : step.multiple;
+        auto months = year * 12 + (month - 1);
+
+        months = ((months + monthStep - 1) / monthStep) * monthStep;
+
+        for (;; months += monthStep) {
+
+            auto t = DaysFromCivil(months / 12, static_cast<unsigned int>(months % 12) + 1, 1) * barDay;
+
+            if (t > tEnd) {
+                break;
+            }
+
+            if (t >= tBegin) {
+                ticks.push_back(t);
+            }
+        }
+
+        return step;
+    }
+
+    auto length = TimeStepLength(step);
+
+    // 1970-01-01 was a Thursday, weeks start on the Monday before it
+    auto origin = (step.unit == TimeUnit::Week) ? -3 * barDay : 0;
+    auto t = BarStart(tBegin - origin, length) + origin;
+
+    for (t = (t < tBegin) ? t + length : t; t <= tEnd; t += length) {
+        ticks.push_back(t);
+    }
+
+    return step;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Name: FormatTimeTick
+// Desc: Label for a tick from CalendarTicks: the year for year steps, "Mar 2017" for months, "Mar 14" for days and
+//       weeks, the time of day below that with midnights labelled with the day instead
+//---------------------------------------------------------------------------------------------------------------------
+inline void FormatTimeTick(int64_t time, const TimeStep& step, char* text, size_t size) {
+
+    static const char* monthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    auto dayStart = BarStart(time, barDay);
+    auto ms = time - dayStart;
+
+    int64_t year;
+    unsigned int month;
+    unsigned int day;
+    CivilFromDays(dayStart / barDay, year, month, day);
+
+    auto hour = static_cast<int>(ms / barHour);
+    auto minute = static_cast<int>((ms / barMinute) % 60);
+    auto second = static_cast<int>((ms / barSecond) % 60);
+
+    switch (step.unit) {
+        case TimeUnit::Year:
+            snprintf(text, size, "%lld", static_cast<long long>(year));
+            break;
+        case TimeUnit::Month:
+            snprintf(text, size, "%s %lld", monthNames[month - 1], static_cast<long long>(year));
+            break;
+        case TimeUnit::Day:
+        case TimeUnit::Week:
+            snprintf(text, size, "%s %u", monthNames[month - 1], day);
+            break;
+        default:
+            if (ms == 0) {
+                snprintf(text, size, "%s %u", monthNames[month - 1], day);
+            } else if (step.unit == TimeUnit::Hour || step.unit == TimeUnit::Minute) {
+                snprintf(text, size, "%02d:%02d", hour, minute);
+            } else if (step.unit == TimeUnit::Second) {
+                snprintf(text, size, "%02d:%02d:%02d", hour, minute, second);
+            } else {
+                snprintf(text, size, "%02d:%02d.%03d", minute, second, static_cast<int>(ms % barSecond));
+            }
+            break;
+    }
+}
+
+#endif // TIMEAXIS_H